@@ -0,0 +1,132 @@
+#include "cd_reader.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+auto festation::CDReader::open(const std::filesystem::path& path) -> std::expected<void, CdFileError>
+{
+    auto discImage = IDiscImage::createUnique(path);
+
+    if (!discImage) {
+        return std::unexpected(discImage.error());
+    }
+
+    close();
+    m_discImage = std::move(*discImage);
+
+    if (m_readAheadSectors > 0) {
+        m_readAheadCache = std::make_unique<SectorReadAheadCache>(*m_discImage, m_readAheadSectors);
+    }
+
+    return {};
+}
+
+auto festation::CDReader::close() -> void
+{
+    if (m_readAheadCache) {
+        ReadAheadStats stats = m_readAheadCache->getStats();
+        LOG_INFO("CD read-ahead: {} hits, {} misses, {} sectors prefetched", stats.hits, stats.misses, stats.prefetchedSectors);
+    }
+
+    m_readAheadCache.reset();
+    m_currentSectorOwner.reset();
+    m_discImage.reset();
+}
+
+auto festation::CDReader::setReadAheadSectors(size_t sectorsCount) -> void
+{
+    m_readAheadSectors = sectorsCount;
+    m_readAheadCache.reset();
+
+    if (m_discImage && m_readAheadSectors > 0) {
+        m_readAheadCache = std::make_unique<SectorReadAheadCache>(*m_discImage, m_readAheadSectors);
+    }
+}
+
+auto festation::CDReader::prefetch(size_t lda) -> void
+{
+    if (m_readAheadCache) {
+        m_readAheadCache->prefetch(lda);
+    }
+}
+
+auto festation::CDReader::getReadAheadStats() const -> ReadAheadStats
+{
+    return m_readAheadCache ? m_readAheadCache->getStats() : ReadAheadStats{};
+}
+
+auto festation::CDReader::readCdSector(size_t lda, size_t sectorSize) -> std::expected<std::span<const std::byte>, CdFileError>
+{
+    if (!m_discImage) {
+        return std::unexpected(CdFileError::NoDiscError);
+    }
+
+    auto sector = readDiscSector(lda);
+
+    if (!sector) {
+        return std::unexpected(sector.error());
+    }
+
+    m_currentSectorOwner = sector->owner;
+    const bool wholeSector = sectorSize == CD_SECTOR_SIZES[1];
+
+    switch (sector->format)
+    {
+    case FileTrackType::MODE1_2048:
+        if (wholeSector)
+            return buildSectorWithHeader(lda, *sector);
+
+        return sector->data.first(sectorSize);
+    case FileTrackType::MODE2_2336:
+    case FileTrackType::CDI_2336:
+        if (wholeSector)
+            return buildSectorWithHeader(lda, *sector);
+
+        return sector->data.subspan(CD_SECTOR_SUBHEADER_SIZE, sectorSize);
+    case FileTrackType::MODE1_2352:
+        if (wholeSector)
+            return sector->data.subspan(CD_SECTOR_SYNC_SIZE, sectorSize);
+
+        /** @brief Mode 1 has no subheader, user data follows the header */
+        return sector->data.subspan(CD_SECTOR_SYNC_SIZE + CD_SECTOR_HEADER_SIZE, sectorSize);
+    case FileTrackType::AUDIO:
+    case FileTrackType::CDG:
+    case FileTrackType::MODE2_2352:
+    case FileTrackType::CDI_2352:
+        if (wholeSector)
+            return sector->data.subspan(CD_SECTOR_SYNC_SIZE, sectorSize);
+
+        return sector->data.subspan(CD_SECTOR_SYNC_SIZE + CD_SECTOR_HEADER_SIZE + CD_SECTOR_SUBHEADER_SIZE, sectorSize);
+    }
+
+    return std::unexpected(CdFileError::UnsupportedFormatError);
+}
+
+auto festation::CDReader::readDiscSector(size_t lda) -> std::expected<DiscSector, CdFileError>
+{
+    if (m_readAheadCache) {
+        if (auto cachedSector = m_readAheadCache->lookup(lda)) {
+            return *cachedSector;
+        }
+    }
+
+    return m_discImage->readSector(lda);
+}
+
+auto festation::CDReader::buildSectorWithHeader(size_t lda, const DiscSector& sector) -> std::span<const std::byte>
+{
+    const MSFFormat msf = convertLDAtoMSF(lda);
+    const bool isMode1 = sector.format == FileTrackType::MODE1_2048;
+
+    m_scratchSector.fill(std::byte{0});
+    m_scratchSector[0] = std::byte{convertBinaryToBCD(msf.minutes)};
+    m_scratchSector[1] = std::byte{convertBinaryToBCD(msf.seconds)};
+    m_scratchSector[2] = std::byte{convertBinaryToBCD(msf.sector)};
+    m_scratchSector[3] = std::byte{static_cast<uint8_t>(isMode1 ? 1 : 2)};
+
+    const size_t copySize = std::min(sector.data.size(), m_scratchSector.size() - CD_SECTOR_HEADER_SIZE);
+    std::memcpy(m_scratchSector.data() + CD_SECTOR_HEADER_SIZE, sector.data.data(), copySize);
+
+    return m_scratchSector;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "cdrom_common.hpp"
+#include "disc_image.hpp"
+#include "sector_read_ahead_cache.hpp"
+
+#include <array>
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace festation {
+    class CDReader {
+    public:
+        auto open(const std::filesystem::path& path) -> std::expected<void, CdFileError>;
+        auto close() -> void;
+
+        auto isDiscLoaded() const -> bool { return m_discImage != nullptr; }
+        auto getDiscImage() const -> IDiscImage* { return m_discImage.get(); }
+
+        /** @brief Number of sectors kept ahead of the read head by the I/O thread (0 disables it) */
+        auto setReadAheadSectors(size_t sectorsCount) -> void;
+        auto prefetch(size_t lda) -> void;
+        auto getReadAheadStats() const -> ReadAheadStats;
+
+        /**
+         * @brief Returns the part of the sector the drive hands to the host for the given Setmode size:
+         * 0x800 (data only) or 0x924 (everything but the sync pattern).
+         * The view points into the mapped image, it's only copied when the image lacks the requested bytes.
+         */
+        auto readCdSector(size_t lda, size_t sectorSize) -> std::expected<std::span<const std::byte>, CdFileError>;
+
+    private:
+        auto readDiscSector(size_t lda) -> std::expected<DiscSector, CdFileError>;
+        auto buildSectorWithHeader(size_t lda, const DiscSector& sector) -> std::span<const std::byte>;
+
+    private:
+        std::unique_ptr<IDiscImage> m_discImage;
+        /** @brief Declared after the image so its I/O thread is joined before the image goes away */
+        std::unique_ptr<SectorReadAheadCache> m_readAheadCache;
+        size_t m_readAheadSectors{};
+        /** @brief Keeps the sector last handed out alive until the next read */
+        std::shared_ptr<const void> m_currentSectorOwner;
+        /** @brief Only used for cooked images (2048/2336 bytes) read with the full 0x924 size */
+        std::array<std::byte, CD_SECTOR_SIZES[1]> m_scratchSector{};
+    };
+};
@@ -1,20 +1,33 @@
 #include "cdrom.hpp"
+#include "savestate/state_serializer.hpp"
 #include "utils/logger.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <utility>
 
 /** @brief Average seek time of 1/60th of a second in CPU cycles (should be dynamic to emulate it properly) */
 static constexpr uint64_t FIXED_SEEK_TIME = 33868800 / 60;
 
+/** @brief ~1 second of data at double speed (150 sectors/s), bounded to ~350KB of host memory */
+static constexpr size_t READ_AHEAD_SECTORS = 150;
+
+static constexpr uint32_t CDROM_STATE_VERSION = 2;
+
 festation::CdromDrive::CdromDrive(InterruptsHandler& intrHndRef, Scheduler& scheduler)
     : m_interruptsHandler(intrHndRef), m_scheduler(scheduler)
 {
-    m_regs.HINTSTS.reserved = 0x7;
-    m_regs.HSTS.PRMEMPT = 1;
-    m_regs.HSTS.PRMWRDY = 1;
+    reset();
+
+    m_cdReader.setReadAheadSectors(READ_AHEAD_SECTORS);
+
+    m_scheduler.setEventHandler(EventType::CdromInt1, [this](uint64_t) { onInt1Event(); });
+    m_scheduler.setEventHandler(EventType::CdromInt2, [this](uint64_t) { onInt2Event(); });
+    m_scheduler.setEventHandler(EventType::CdromInt3, [this](uint64_t command) { onInt3Event(static_cast<uint8_t>(command)); });
+    m_scheduler.setEventHandler(EventType::CdromInt5, [this](uint64_t) { onInt5Event(); });
 
     // TEMP
     // m_internalStatusCode.shellOpen = 1;
@@ -25,6 +38,26 @@ festation::CdromDrive::~CdromDrive()
 
 }
 
+auto festation::CdromDrive::reset() -> void
+{
+    for (EventType type : { EventType::CdromInt1, EventType::CdromInt2, EventType::CdromInt3, EventType::CdromInt4, EventType::CdromInt5 }) {
+        m_scheduler.cancelEvents(type);
+    }
+
+    m_regs = {};
+    m_regs.HINTSTS.reserved = 0x7;
+    m_regs.HSTS.PRMEMPT = 1;
+    m_regs.HSTS.PRMWRDY = 1;
+
+    m_internalStatusCode = {};
+    m_seekTargetBCD = {};
+    m_lda = 0;
+    m_mode = {};
+    m_currentSectorBuffer = 0;
+    m_isSectorReady = false;
+    m_dataFifo = {};
+}
+
 auto festation::CdromDrive::read8(uint32_t address) -> uint8_t
 {
     switch (address)
@@ -123,6 +156,7 @@ auto festation::CdromDrive::write8(uint32_t address, uint8_t value) -> void
         switch (m_regs.HSTS.RA)
         {
         case 0:
+            writeRequestRegister(value);
             break;
         case 1:
             m_regs.HCLRCTL.raw = value;
@@ -140,6 +174,77 @@ auto festation::CdromDrive::write8(uint32_t address, uint8_t value) -> void
     }
 }
 
+auto festation::CdromDrive::insertDisc(const std::filesystem::path& path) -> bool
+{
+    auto result = m_cdReader.open(path);
+
+    if (!result) {
+        LOG_ERROR("CDROM: couldn't load disc image {} (error {})", path.string(), std::to_underlying(result.error()));
+        return false;
+    }
+
+    m_dataFifo = {};
+    m_isSectorReady = false;
+    m_regs.HSTS.DRQSTS = 0;
+    return true;
+}
+
+auto festation::CdromDrive::readDiscFile(std::string_view path) -> std::expected<std::vector<uint8_t>, CdFileError>
+{
+    Iso9660Reader reader(m_cdReader);
+    return reader.readFile(path);
+}
+
+auto festation::CdromDrive::findDiscFile(std::string_view path) -> std::expected<DiscFileLocation, CdFileError>
+{
+    Iso9660Reader reader(m_cdReader);
+    return reader.findFile(path);
+}
+
+auto festation::CdromDrive::readDiscSectors(size_t lda, std::span<uint8_t> destination) -> std::expected<void, CdFileError>
+{
+    const size_t sectorSize = CD_SECTOR_SIZES[0];
+
+    for (size_t offset = 0; offset < destination.size(); offset += sectorSize) {
+        auto sector = m_cdReader.readCdSector(lda + offset / sectorSize, sectorSize);
+
+        if (!sector)
+            return std::unexpected(sector.error());
+
+        const size_t copySize = std::min({ sector->size(), sectorSize, destination.size() - offset });
+        std::memcpy(destination.data() + offset, sector->data(), copySize);
+    }
+
+    return {};
+}
+
+auto festation::CdromDrive::serialize(StateSerializer& serializer) -> void
+{
+    uint32_t version = CDROM_STATE_VERSION;
+
+    if (!serializer.beginSection(makeSectionTag("CDRM"), version))
+        return;
+
+    serializer.doValue(m_regs);
+    serializer.doValue(m_internalStatusCode);
+    serializer.doValue(m_seekTargetBCD);
+    serializer.doValue(m_lda);
+    serializer.doValue(m_mode);
+    serializer.doArray(m_sectorBuffers);
+    serializer.doValue(m_currentSectorBuffer);
+    serializer.doBool(m_isSectorReady);
+    serializer.doValue(m_dataFifo);
+
+    if (serializer.isLoading()) {
+        m_dataFifo.sectorBuffer &= 1;
+        m_dataFifo.size = std::min(m_dataFifo.size, m_sectorBuffers[m_dataFifo.sectorBuffer].data.size());
+        m_currentSectorBuffer &= 1;
+        m_cdReader.prefetch(m_lda);
+    }
+
+    serializer.endSection();
+}
+
 auto festation::CdromDrive::decodeCommand() -> void
 {
     uint8_t cmd = m_regs.COMMAND;
@@ -203,14 +308,7 @@ auto festation::CdromDrive::processNopCmd() -> void
     m_regs.RESULT.append(m_internalStatusCode.raw);
     m_internalStatusCode.shellOpen = 0;
     
-    m_scheduler.scheduleEvent({ EventType::CdromInt3, int3Delay, [this]() {
-        LOG_DEBUG("CDROM: INT3 response");
-        m_regs.HINTSTS.INTSTS = CDROM_INT3_ACKNOWLEDGE;
-
-        if (isInterrupt()) {
-            m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-        }
-    }});
+    m_scheduler.scheduleEvent(EventType::CdromInt3, int3Delay, m_regs.COMMAND);
 }
 
 auto festation::CdromDrive::processSetlocCmd() -> void
@@ -239,28 +337,14 @@ auto festation::CdromDrive::processSetlocCmd() -> void
 
         m_regs.RESULT.append(m_internalStatusCode.raw);
 
-        m_scheduler.scheduleEvent({ EventType::CdromInt3, firstIntDelay, [this]() {
-            LOG_DEBUG("CDROM: INT3 response");
-            m_regs.HINTSTS.INTSTS = CDROM_INT3_ACKNOWLEDGE;
-
-            if (isInterrupt()) {
-                m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-            }
-        }});
+        m_scheduler.scheduleEvent(EventType::CdromInt3, firstIntDelay, m_regs.COMMAND);
     }
     else {
         m_internalStatusCode.error = 1;
         m_regs.RESULT.append(m_internalStatusCode.raw);
         m_regs.RESULT.append(0x10);
 
-        m_scheduler.scheduleEvent({ EventType::CdromInt5, firstIntDelay, [this]() {
-            LOG_DEBUG("CDROM: INT5 response");
-            m_regs.HINTSTS.INTSTS = CDROM_INT5_DISK_ERROR;
-
-            if (isInterrupt()) {
-                m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-            }
-        }});
+        m_scheduler.scheduleEvent(EventType::CdromInt5, firstIntDelay);
     }
 }
 
@@ -272,17 +356,11 @@ auto festation::CdromDrive::processReadNCmd() -> void
     m_internalStatusCode.raw &= 0x1F;
     m_regs.RESULT.append(m_internalStatusCode.raw);
     m_internalStatusCode.read = 1;
-    
-    m_scheduler.scheduleEvent({ EventType::CdromInt3, int3Delay, [this]() {
-        LOG_DEBUG("CDROM: INT3 response");
-        m_regs.HINTSTS.INTSTS = CDROM_INT3_ACKNOWLEDGE;
 
-        if (isInterrupt()) {
-            m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-        }
-
-        checkAndScheduleReadINT1();
-    }});
+    /** @brief Host-side only, INT1 timing below doesn't depend on it */
+    m_cdReader.prefetch(m_lda);
+    
+    m_scheduler.scheduleEvent(EventType::CdromInt3, int3Delay, m_regs.COMMAND);
 }
 
 auto festation::CdromDrive::processSetmodeCmd() -> void
@@ -298,18 +376,9 @@ auto festation::CdromDrive::processSetmodeCmd() -> void
         m_mode.sectorSize = sectorSize;
     }
 
-    m_sectorBlock.data.resize(CD_SECTOR_SIZES[m_mode.sectorSize]);
-
     m_regs.RESULT.append(m_internalStatusCode.raw);
     
-    m_scheduler.scheduleEvent({ EventType::CdromInt3, int3Delay, [this]() {
-        LOG_DEBUG("CDROM: INT3 response");
-        m_regs.HINTSTS.INTSTS = CDROM_INT3_ACKNOWLEDGE;
-
-        if (isInterrupt()) {
-            m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-        }
-    }});
+    m_scheduler.scheduleEvent(EventType::CdromInt3, int3Delay, m_regs.COMMAND);
 }
 
 auto festation::CdromDrive::processSeekLCmd() -> void
@@ -322,33 +391,13 @@ auto festation::CdromDrive::processSeekLCmd() -> void
     uint8_t seconds = convertBCDtoBinary(m_seekTargetBCD.seconds); 
     uint8_t sector = convertBCDtoBinary(m_seekTargetBCD.sector);
     m_lda = convertMSFtoLDA(minutes, seconds, sector);
+    m_cdReader.prefetch(m_lda);
 
     m_internalStatusCode.raw &= 0x1F;
     m_regs.RESULT.append(m_internalStatusCode.raw);
     m_internalStatusCode.seek = 1;
 
-    m_scheduler.scheduleEvent({ EventType::CdromInt3, int3Delay, [this]() {
-        LOG_DEBUG("CDROM: INT3 response");
-        m_regs.HINTSTS.INTSTS = CDROM_INT3_ACKNOWLEDGE;
-
-        if (isInterrupt()) {
-            m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-        }
-
-        constexpr uint64_t int2Delay = FIXED_SEEK_TIME;
-
-        m_internalStatusCode.raw &= 0x1F;
-        m_regs.RESULT.append(m_internalStatusCode.raw);
-
-        m_scheduler.scheduleEvent({ EventType::CdromInt2, int2Delay, [this]() {
-            LOG_DEBUG("CDROM: INT2 response");
-            m_regs.HINTSTS.INTSTS = CDROM_INT2_COMPLETE;
-
-            if (isInterrupt()) {
-                m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-            }
-        }});
-    }});
+    m_scheduler.scheduleEvent(EventType::CdromInt3, int3Delay, m_regs.COMMAND);
 }
 
 auto festation::CdromDrive::processBiosVersionCmd() -> void
@@ -362,14 +411,7 @@ auto festation::CdromDrive::processBiosVersionCmd() -> void
     m_regs.RESULT.append(0x19);
     m_regs.RESULT.append(0xC0);
 
-    m_scheduler.scheduleEvent({ EventType::CdromInt3, int3Delay, [this]() {
-        LOG_DEBUG("CDROM: INT3 response");
-        m_regs.HINTSTS.INTSTS = CDROM_INT3_ACKNOWLEDGE;
-
-        if (isInterrupt()) {
-            m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-        }
-    }});
+    m_scheduler.scheduleEvent(EventType::CdromInt3, int3Delay, m_regs.COMMAND);
 }
 
 auto festation::CdromDrive::processGetIdCmd() -> void
@@ -379,14 +421,61 @@ auto festation::CdromDrive::processGetIdCmd() -> void
 
     m_regs.RESULT.append(m_internalStatusCode.raw);
 
-    m_scheduler.scheduleEvent({ EventType::CdromInt3, int3Delay, [this]() {
-        LOG_DEBUG("CDROM: INT3 response");
-        m_regs.HINTSTS.INTSTS = CDROM_INT3_ACKNOWLEDGE;
+    m_scheduler.scheduleEvent(EventType::CdromInt3, int3Delay, m_regs.COMMAND);
+}
 
-        if (isInterrupt()) {
-            m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-        }
+auto festation::CdromDrive::onInt1Event() -> void
+{
+    LOG_DEBUG("CDROM: INT1 response");
 
+    if (!loadNextSector()) {
+        // Reading stops with a seek error, the game gets INT5 instead of the previous sector again
+        m_internalStatusCode.read = 0;
+        m_internalStatusCode.error = 1;
+        m_internalStatusCode.seekError = 1;
+        m_regs.RESULT.append(m_internalStatusCode.raw);
+        m_regs.RESULT.append(0x04);
+        raiseInterrupt(CDROM_INT5_DISK_ERROR);
+        return;
+    }
+
+    m_regs.RESULT.append(m_internalStatusCode.raw);
+    raiseInterrupt(CDROM_INT1_DATA_READY);
+
+    if (m_internalStatusCode.read) {
+        checkAndScheduleReadINT1();
+    }
+}
+
+auto festation::CdromDrive::onInt2Event() -> void
+{
+    LOG_DEBUG("CDROM: INT2 response");
+    raiseInterrupt(CDROM_INT2_COMPLETE);
+}
+
+auto festation::CdromDrive::onInt3Event(uint8_t command) -> void
+{
+    LOG_DEBUG("CDROM: INT3 response");
+    raiseInterrupt(CDROM_INT3_ACKNOWLEDGE);
+
+    /** @brief Second responses of the commands that have one */
+    switch (command)
+    {
+    case 0x06:
+        checkAndScheduleReadINT1();
+        break;
+    case 0x15:
+    {
+        constexpr uint64_t int2Delay = FIXED_SEEK_TIME;
+
+        m_internalStatusCode.raw &= 0x1F;
+        m_regs.RESULT.append(m_internalStatusCode.raw);
+
+        m_scheduler.scheduleEvent(EventType::CdromInt2, int2Delay);
+    }
+        break;
+    case 0x1A:
+    {
         constexpr uint64_t int2Delay = 0x4A00;
 
         m_regs.RESULT.append(m_internalStatusCode.raw);
@@ -398,15 +487,31 @@ auto festation::CdromDrive::processGetIdCmd() -> void
         m_regs.RESULT.append(0x45);
         m_regs.RESULT.append(0x41);
 
-        m_scheduler.scheduleEvent({ EventType::CdromInt2, int2Delay, [this]() {
-            LOG_DEBUG("CDROM: INT2 response");
-            m_regs.HINTSTS.INTSTS = CDROM_INT2_COMPLETE;
+        m_scheduler.scheduleEvent(EventType::CdromInt2, int2Delay);
+    }
+        break;
+    default:
+        break;
+    }
+}
 
-            if (isInterrupt()) {
-                m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-            }
-        }});
-    }});
+auto festation::CdromDrive::onInt5Event() -> void
+{
+    LOG_DEBUG("CDROM: INT5 response");
+    raiseInterrupt(CDROM_INT5_DISK_ERROR);
+}
+
+auto festation::CdromDrive::raiseInterrupt(CdromInterruptType type) -> void
+{
+    m_regs.HINTSTS.INTSTS = type;
+
+    if (m_interruptObserver) {
+        m_interruptObserver(type);
+    }
+
+    if (isInterrupt()) {
+        m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
+    }
 }
 
 auto festation::CdromDrive::isInterrupt() const -> bool
@@ -418,33 +523,78 @@ auto festation::CdromDrive::checkAndScheduleReadINT1() -> void
 { 
     constexpr uint64_t int1Delay = 0x4A00;
 
-    m_regs.RESULT.append(m_internalStatusCode.raw);
+    m_scheduler.scheduleEvent(EventType::CdromInt1, int1Delay);
+}
 
-    m_scheduler.scheduleEvent({ EventType::CdromInt1, int1Delay, [this]() {
-        LOG_DEBUG("CDROM: INT1 response");
-        m_regs.HINTSTS.INTSTS = CDROM_INT1_DATA_READY;
+auto festation::CdromDrive::loadNextSector() -> bool
+{
+    auto result = m_cdReader.readCdSector(m_lda, CD_SECTOR_SIZES[m_mode.sectorSize]);
 
-        if (isInterrupt()) {
-            m_interruptsHandler.setInterruptSource(InterruptSource::CdromSrc);
-        }
+    if (!result) {
+        LOG_WARN("CDROM: can't read sector {}", m_lda);
+        return false;
+    }
 
-        if (m_internalStatusCode.read) {
-            checkAndScheduleReadINT1();
-        }
-    }});
+    m_lda++;
+
+    m_currentSectorBuffer ^= 1;
+    SectorBuffer& sectorBuffer = m_sectorBuffers[m_currentSectorBuffer];
+
+    sectorBuffer.size = std::min(result->size(), sectorBuffer.data.size());
+    std::memcpy(sectorBuffer.data.data(), result->data(), sectorBuffer.size);
+    m_isSectorReady = true;
+
+    return true;
 }
 
-auto festation::CdromDrive::readSectorByte() -> uint8_t
+auto festation::CdromDrive::writeRequestRegister(uint8_t value) -> void
 {
-    if (m_sectorBlock.nextByte == 0) {
-        auto result = m_cdReader.readCdSector(m_lda++, m_sectorBlock.data);
+    m_regs.HCHPCTL.raw = value;
 
-        if (!result) {
-            /** @todo */
-            LOG_ERROR("Error reading a CD sector");
-            assert(false);
-        }
+    if (!m_regs.HCHPCTL.BFRD) {
+        m_dataFifo = {};
+        m_regs.HSTS.DRQSTS = 0;
+        return;
+    }
+
+    if (!m_isSectorReady) {
+        LOG_WARN("CDROM: data requested but no sector is ready");
+        return;
     }
 
-    return std::to_integer<uint8_t>(m_sectorBlock.data[m_sectorBlock.nextByte++]);
+    const SectorBuffer& sectorBuffer = m_sectorBuffers[m_currentSectorBuffer];
+
+    m_dataFifo = {
+        .sectorBuffer = m_currentSectorBuffer,
+        .size = sectorBuffer.size,
+        .readIndex = 0,
+    };
+
+    m_isSectorReady = false;
+    m_regs.HSTS.DRQSTS = 1;
+}
+
+auto festation::CdromDrive::readDataFifo(std::span<uint8_t> destination) -> void
+{
+    const std::byte* fifoData = m_sectorBuffers[m_dataFifo.sectorBuffer].data.data();
+    const size_t available = m_dataFifo.size - m_dataFifo.readIndex;
+    const size_t bytesCount = std::min(available, destination.size());
+
+    std::memcpy(destination.data(), fifoData + m_dataFifo.readIndex, bytesCount);
+    std::memset(destination.data() + bytesCount, 0, destination.size() - bytesCount);
+
+    m_dataFifo.readIndex += bytesCount;
+    m_regs.HSTS.DRQSTS = m_dataFifo.readIndex < m_dataFifo.size;
+}
+
+auto festation::CdromDrive::readSectorByte() -> uint8_t
+{
+    if (m_dataFifo.readIndex >= m_dataFifo.size) {
+        return 0;
+    }
+
+    uint8_t value = std::to_integer<uint8_t>(m_sectorBuffers[m_dataFifo.sectorBuffer].data[m_dataFifo.readIndex++]);
+    m_regs.HSTS.DRQSTS = m_dataFifo.readIndex < m_dataFifo.size;
+
+    return value;
 }
@@ -2,6 +2,7 @@
 
 #include "cd_reader.hpp"
 #include "cdrom_common.hpp"
+#include "iso9660_reader.hpp"
 #include "interrupts/interrupts.hpp"
 #include "scheduler/scheduler.hpp"
 
@@ -9,9 +10,16 @@
 #include <cstdint>
 #include <array>
 #include <cstring>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string_view>
 #include <vector>
 
 namespace festation {
+    class StateSerializer;
+
     enum CdromInterruptType {
         CDROM_INT0_NO_INTR,
         CDROM_INT1_DATA_READY,
@@ -32,6 +40,26 @@ namespace festation {
         auto read16(uint32_t address) -> uint16_t;
         auto read32(uint32_t address) -> uint32_t;
         auto write8(uint32_t address, uint8_t value) -> void;
+
+        /** @brief Bulk drain of the data FIFO (DMA3), words past the end of the sector read as 0 */
+        auto readDataFifo(std::span<uint8_t> destination) -> void;
+
+        auto insertDisc(const std::filesystem::path& path) -> bool;
+        /** @brief Drive back to its power on state (pending responses dropped), the inserted disc stays */
+        auto reset() -> void;
+        auto getReadAheadStats() const -> ReadAheadStats { return m_cdReader.getReadAheadStats(); }
+
+        /** @brief Whole file from the disc's ISO 9660 filesystem, read with no drive timing (fast boot) */
+        auto readDiscFile(std::string_view path) -> std::expected<std::vector<uint8_t>, CdFileError>;
+        auto findDiscFile(std::string_view path) -> std::expected<DiscFileLocation, CdFileError>;
+        /** @brief 2048 bytes of user data per sector, read with no drive timing (HLE kernel CD calls) */
+        auto readDiscSectors(size_t lda, std::span<uint8_t> destination) -> std::expected<void, CdFileError>;
+
+        /** @brief Called on every interrupt raised by the drive (movie recording/playback sync) */
+        auto setInterruptObserver(std::function<void(CdromInterruptType)> observer) -> void { m_interruptObserver = std::move(observer); }
+
+        /** @brief The disc itself isn't part of the state, the same image must be inserted before loading */
+        auto serialize(StateSerializer& serializer) -> void;
     
     private:
         auto decodeCommand() -> void;
@@ -43,8 +71,17 @@ namespace festation {
         auto processBiosVersionCmd() -> void;
         auto processGetIdCmd() -> void;
 
+        auto onInt1Event() -> void;
+        auto onInt2Event() -> void;
+        auto onInt3Event(uint8_t command) -> void;
+        auto onInt5Event() -> void;
+        auto raiseInterrupt(CdromInterruptType type) -> void;
+
         auto isInterrupt() const -> bool;
         auto checkAndScheduleReadINT1() -> void;
+        /** @brief False when the sector can't be read (past the end of the disc), the buffers are left as they were */
+        auto loadNextSector() -> bool;
+        auto writeRequestRegister(uint8_t value) -> void;
         auto readSectorByte() -> uint8_t;
 
     private:
@@ -204,13 +241,30 @@ namespace festation {
             uint8_t raw;
         } m_mode{};
 
-        struct SectorBlock {
-            std::vector<std::byte> data;
-            size_t nextByte;
-        } m_sectorBlock{};
+        /**
+         * @brief Drive side sector buffers, the drive writes a sector into the next one on every INT1
+         * while the host may still be reading the previous one from the data FIFO.
+         */
+        struct SectorBuffer {
+            std::array<std::byte, CD_SECTOR_SIZES[1]> data;
+            size_t size;
+        };
+
+        std::array<SectorBuffer, 2> m_sectorBuffers{};
+        size_t m_currentSectorBuffer{};
+        bool m_isSectorReady{};
+
+        /** @brief Whole sector loaded at once on a BFRD request, drained by the data port or DMA3 */
+        struct DataFifo {
+            size_t sectorBuffer;
+            size_t size;
+            size_t readIndex;
+        } m_dataFifo{};
 
         CDReader m_cdReader{};
 
+        std::function<void(CdromInterruptType)> m_interruptObserver{};
+
         InterruptsHandler& m_interruptsHandler;
         Scheduler& m_scheduler;
     };
@@ -1,15 +1,30 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace festation {
     static constexpr std::array<size_t, 2> CD_SECTOR_SIZES = { 0x800, 0x924 };
+
+    /** @brief Full sector as stored on the disc: sync (12) + header (4) + subheader (8) + data + EDC/ECC */
+    static constexpr size_t CD_RAW_SECTOR_SIZE = 2352;
+    static constexpr size_t CD_SECTOR_SYNC_SIZE = 12;
+    static constexpr size_t CD_SECTOR_HEADER_SIZE = 4;
+    static constexpr size_t CD_SECTOR_SUBHEADER_SIZE = 8;
+    static constexpr size_t CD_SECTORS_PER_SECOND = 75;
+    static constexpr size_t CD_LEAD_IN_SECTORS = 150;
     
     enum class CdFileError {
         FileExistsError,
         FileOpeningError,
         MissingBinFileError,
-        CueParsingError
+        CueParsingError,
+        UnsupportedFormatError,
+        SectorOutOfRangeError,
+        DecompressionError,
+        NoDiscError,
+        InvalidFilesystemError
     };
 
     struct MSFFormat {
@@ -28,14 +43,41 @@ namespace festation {
         return ((numberBCD & 0xF) <= 9) && (((numberBCD >> 4) & 0xF) <= 9);
     }
 
+    inline constexpr auto convertBinaryToBCD(uint8_t number) -> uint8_t
+    {
+        return ((number / 10) << 4) | (number % 10);
+    }
+
+    /** @brief Plain sector count of an MSF position (CUE INDEX entries are relative to their file) */
+    inline constexpr auto convertMSFtoSectors(uint8_t minutes, uint8_t seconds, uint8_t sector) -> size_t
+    {
+        return ((minutes * 60) + seconds) * CD_SECTORS_PER_SECOND + sector;
+    }
+
+    inline constexpr auto convertMSFtoSectors(const MSFFormat& msf) -> size_t
+    {
+        return convertMSFtoSectors(msf.minutes, msf.seconds, msf.sector);
+    }
+
     inline constexpr auto convertMSFtoLDA(uint8_t minutes, uint8_t seconds, uint8_t sector) -> size_t
     {
         /** @brief We substract 150 because data tracks start at second 2 of a CD (00:02:00), equivalent of 150 sectors */
-        return (((minutes * 60) + seconds) * 75 + sector) - 150;
+        return convertMSFtoSectors(minutes, seconds, sector) - CD_LEAD_IN_SECTORS;
     }
 
     inline constexpr auto convertMSFtoLDA(const MSFFormat& msf) -> size_t
     {
         return convertMSFtoLDA(msf.minutes, msf.seconds, msf.sector);
     }
+
+    inline constexpr auto convertLDAtoMSF(size_t lda) -> MSFFormat
+    {
+        size_t sectors = lda + CD_LEAD_IN_SECTORS;
+
+        return {
+            .minutes = static_cast<uint8_t>(sectors / (60 * CD_SECTORS_PER_SECOND)),
+            .seconds = static_cast<uint8_t>((sectors / CD_SECTORS_PER_SECOND) % 60),
+            .sector = static_cast<uint8_t>(sectors % CD_SECTORS_PER_SECOND),
+        };
+    }
 };
@@ -0,0 +1,412 @@
+#include "chd_image.hpp"
+#include "utils/logger.hpp"
+
+#include <libchdr/chd.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+namespace festation {
+    /** @brief CD frames in a CHD are always 2352 bytes of sector data followed by 96 bytes of subcode */
+    static constexpr uint32_t CHD_CD_FRAME_SIZE = 2448;
+    /** @brief Every track is padded to a multiple of 4 frames inside the CHD */
+    static constexpr uint32_t CHD_CD_TRACK_PADDING = 4;
+
+    static constexpr size_t HUNK_CACHE_CAPACITY = 64;
+    static constexpr uint32_t PREFETCH_HUNKS = 8;
+    static constexpr unsigned MAX_WORKERS = 4;
+
+    static constexpr std::array<std::byte, CHD_CD_FRAME_SIZE> ZERO_FRAME{};
+
+    static auto parseChdTrackType(std::string_view type) -> std::expected<FileTrackType, CdFileError>
+    {
+        if (type == "AUDIO")
+            return FileTrackType::AUDIO;
+        if (type == "MODE1" || type == "MODE1/2048")
+            return FileTrackType::MODE1_2048;
+        if (type == "MODE1_RAW" || type == "MODE1/2352")
+            return FileTrackType::MODE1_2352;
+        if (type == "MODE2" || type == "MODE2/2336" || type == "MODE2_FORM_MIX")
+            return FileTrackType::MODE2_2336;
+        if (type == "MODE2_RAW" || type == "MODE2/2352" || type == "CDI/2352")
+            return FileTrackType::MODE2_2352;
+
+        return std::unexpected(CdFileError::UnsupportedFormatError);
+    }
+};
+
+festation::ChdImage::~ChdImage()
+{
+    if (m_chd) {
+        HunkCacheStats stats = getCacheStats();
+        LOG_INFO("CHD hunk cache: {} hits, {} misses, {} hunks prefetched", stats.hits, stats.misses, stats.prefetchedHunks);
+    }
+
+    for (auto& worker : m_workers) {
+        worker.request_stop();
+    }
+
+    m_cacheChanged.notify_all();
+    m_workers.clear();
+
+    for (chd_file* workerChd : m_workerChds) {
+        chd_close(workerChd);
+    }
+
+    if (m_chd) {
+        chd_close(m_chd);
+    }
+}
+
+auto festation::ChdImage::open(const std::filesystem::path& chdPath) -> std::expected<void, CdFileError>
+{
+    if (!std::filesystem::exists(chdPath)) {
+        return std::unexpected(CdFileError::FileExistsError);
+    }
+
+    m_path = chdPath;
+
+    if (chd_open(chdPath.string().c_str(), CHD_OPEN_READ, nullptr, &m_chd) != CHDERR_NONE) {
+        m_chd = nullptr;
+        return std::unexpected(CdFileError::FileOpeningError);
+    }
+
+    const chd_header* header = chd_get_header(m_chd);
+    m_hunkBytes = header->hunkbytes;
+    m_hunksCount = header->totalhunks;
+    m_framesPerHunk = m_hunkBytes / CHD_CD_FRAME_SIZE;
+
+    if (m_framesPerHunk == 0 || m_hunkBytes % CHD_CD_FRAME_SIZE != 0) {
+        LOG_ERROR("CHD {} isn't a CD image (hunk size {})", chdPath.filename().string(), m_hunkBytes);
+        return std::unexpected(CdFileError::UnsupportedFormatError);
+    }
+
+    if (auto result = parseTracksMetadata(); !result) {
+        return result;
+    }
+
+    const unsigned workersCount = std::clamp(std::thread::hardware_concurrency() / 2, 1u, MAX_WORKERS);
+
+    for (unsigned i = 0; i < workersCount; i++) {
+        chd_file* workerChd{};
+
+        if (chd_open(chdPath.string().c_str(), CHD_OPEN_READ, nullptr, &workerChd) != CHDERR_NONE)
+            break;
+
+        m_workerChds.push_back(workerChd);
+        m_workers.emplace_back([this, workerChd](std::stop_token stopToken) {
+            workerLoop(stopToken, workerChd);
+        });
+    }
+
+    LOG_INFO("Loaded CHD image {} ({} tracks, {} sectors, {} hunks of {} bytes, {} decompression workers)",
+        chdPath.filename().string(), m_tracks.size(), m_ldaToExtent.size(), m_hunksCount, m_hunkBytes, m_workers.size());
+
+    return {};
+}
+
+auto festation::ChdImage::readSector(size_t lda) -> std::expected<DiscSector, CdFileError>
+{
+    if (lda >= m_ldaToExtent.size()) {
+        return std::unexpected(CdFileError::SectorOutOfRangeError);
+    }
+
+    const SectorExtent& extent = m_extents[m_ldaToExtent[lda]];
+
+    if (extent.startFrame == NO_FRAME) {
+        return DiscSector{
+            .data = std::span(ZERO_FRAME).first(extent.storedSectorSize),
+            .format = extent.type,
+            .trackNumber = extent.trackNumber,
+        };
+    }
+
+    const uint32_t frame = extent.startFrame + static_cast<uint32_t>(lda - extent.startLda);
+    const uint32_t hunkIndex = frame / m_framesPerHunk;
+
+    std::shared_ptr<const HunkBuffer> hunk = getHunk(hunkIndex);
+
+    if (!hunk) {
+        return std::unexpected(CdFileError::DecompressionError);
+    }
+
+    queuePrefetch(hunkIndex);
+
+    const size_t frameOffset = (frame % m_framesPerHunk) * CHD_CD_FRAME_SIZE;
+
+    return DiscSector{
+        .data = std::span(*hunk).subspan(frameOffset, extent.storedSectorSize),
+        .format = extent.type,
+        .trackNumber = extent.trackNumber,
+        .owner = std::move(hunk),
+    };
+}
+
+auto festation::ChdImage::getCacheStats() const -> HunkCacheStats
+{
+    std::scoped_lock lock(m_cacheMutex);
+    return m_stats;
+}
+
+auto festation::ChdImage::parseTracksMetadata() -> std::expected<void, CdFileError>
+{
+    std::array<char, 256> metadata{};
+    size_t discLda = 0;
+    uint32_t physicalFrame = 0;
+
+    for (uint32_t index = 0; ; index++) {
+        int trackNumber{};
+        int frames{};
+        int pregap{};
+        int postgap{};
+        std::array<char, 32> type{};
+        std::array<char, 32> subtype{};
+        std::array<char, 32> pregapType{};
+        std::array<char, 32> pregapSubtype{};
+
+        metadata.fill(0);
+
+        if (chd_get_metadata(m_chd, CDROM_TRACK_METADATA2_TAG, index, metadata.data(), metadata.size() - 1,
+                nullptr, nullptr, nullptr) == CHDERR_NONE) {
+            int parsed = std::sscanf(metadata.data(), "TRACK:%d TYPE:%31s SUBTYPE:%31s FRAMES:%d PREGAP:%d PGTYPE:%31s PGSUB:%31s POSTGAP:%d",
+                &trackNumber, type.data(), subtype.data(), &frames, &pregap, pregapType.data(), pregapSubtype.data(), &postgap);
+
+            if (parsed != 8) {
+                return std::unexpected(CdFileError::CueParsingError);
+            }
+        }
+        else if (chd_get_metadata(m_chd, CDROM_TRACK_METADATA_TAG, index, metadata.data(), metadata.size() - 1,
+                nullptr, nullptr, nullptr) == CHDERR_NONE) {
+            int parsed = std::sscanf(metadata.data(), "TRACK:%d TYPE:%31s SUBTYPE:%31s FRAMES:%d",
+                &trackNumber, type.data(), subtype.data(), &frames);
+
+            if (parsed != 4) {
+                return std::unexpected(CdFileError::CueParsingError);
+            }
+        }
+        else {
+            break;
+        }
+
+        auto trackType = parseChdTrackType(type.data());
+
+        if (!trackType) {
+            LOG_ERROR("CHD: unsupported track type {} on track {}", type.data(), trackNumber);
+            return std::unexpected(trackType.error());
+        }
+
+        const uint32_t storedSectorSize = static_cast<uint32_t>(getStoredSectorSize(*trackType));
+        /** @brief A 'V' pregap type means the pregap frames are stored in the CHD as part of FRAMES */
+        const bool isPregapStored = pregapType[0] == 'V';
+
+        /** @brief Track 1 pregap is the 2 seconds lead-in the LDA space already skips */
+        if (pregap > 0 && !isPregapStored && trackNumber > 1) {
+            addExtent({
+                .startLda = discLda,
+                .startFrame = NO_FRAME,
+                .sectorsCount = static_cast<uint32_t>(pregap),
+                .storedSectorSize = storedSectorSize,
+                .type = *trackType,
+                .trackNumber = static_cast<uint8_t>(trackNumber),
+            });
+
+            discLda += pregap;
+        }
+
+        size_t skippedFrames = 0;
+
+        if (isPregapStored && trackNumber == 1) {
+            skippedFrames = pregap;
+        }
+
+        const size_t indexOneOffset = isPregapStored ? pregap : 0;
+
+        m_tracks.push_back({
+            .number = static_cast<uint8_t>(trackNumber),
+            .type = *trackType,
+            .startLda = discLda + indexOneOffset - skippedFrames,
+            .sectorsCount = frames - indexOneOffset,
+        });
+
+        addExtent({
+            .startLda = discLda,
+            .startFrame = static_cast<uint32_t>(physicalFrame + skippedFrames),
+            .sectorsCount = static_cast<uint32_t>(frames - skippedFrames),
+            .storedSectorSize = storedSectorSize,
+            .type = *trackType,
+            .trackNumber = static_cast<uint8_t>(trackNumber),
+        });
+
+        discLda += frames - skippedFrames;
+        physicalFrame += (frames + CHD_CD_TRACK_PADDING - 1) / CHD_CD_TRACK_PADDING * CHD_CD_TRACK_PADDING;
+    }
+
+    if (m_tracks.empty()) {
+        return std::unexpected(CdFileError::UnsupportedFormatError);
+    }
+
+    return {};
+}
+
+auto festation::ChdImage::addExtent(const SectorExtent& extent) -> void
+{
+    if (extent.sectorsCount == 0)
+        return;
+
+    assert(extent.startLda == m_ldaToExtent.size());
+    assert(m_extents.size() < std::numeric_limits<uint16_t>::max());
+
+    const uint16_t extentIndex = static_cast<uint16_t>(m_extents.size());
+    m_extents.push_back(extent);
+    m_ldaToExtent.insert(m_ldaToExtent.end(), extent.sectorsCount, extentIndex);
+}
+
+auto festation::ChdImage::getHunk(uint32_t hunkIndex) -> std::shared_ptr<const HunkBuffer>
+{
+    std::unique_lock lock(m_cacheMutex);
+
+    while (true) {
+        if (auto it = m_cachedHunks.find(hunkIndex); it != m_cachedHunks.end()) {
+            m_stats.hits++;
+            m_lruOrder.splice(m_lruOrder.begin(), m_lruOrder, it->second.lruPosition);
+            return it->second.buffer;
+        }
+
+        /** @brief A worker is already on it, decompressing it twice would only waste time */
+        if (!m_inFlightHunks.contains(hunkIndex))
+            break;
+
+        m_cacheChanged.wait(lock);
+    }
+
+    m_stats.misses++;
+    m_inFlightHunks.insert(hunkIndex);
+    lock.unlock();
+
+    std::shared_ptr<const HunkBuffer> hunk{};
+
+    {
+        std::scoped_lock chdLock(m_chdMutex);
+        hunk = decompressHunk(m_chd, hunkIndex);
+    }
+
+    insertHunk(hunkIndex, hunk);
+    return hunk;
+}
+
+auto festation::ChdImage::decompressHunk(chd_file* chd, uint32_t hunkIndex) const -> std::shared_ptr<const HunkBuffer>
+{
+    auto hunk = std::make_shared<HunkBuffer>(m_hunkBytes);
+
+    if (chd_read(chd, hunkIndex, hunk->data()) != CHDERR_NONE) {
+        LOG_ERROR("CHD: failed to decompress hunk {}", hunkIndex);
+        return nullptr;
+    }
+
+    /** @brief CHD stores CD audio samples big endian */
+    const uint32_t firstFrame = hunkIndex * m_framesPerHunk;
+
+    for (const SectorExtent& extent : m_extents) {
+        if (extent.type != FileTrackType::AUDIO || extent.startFrame == NO_FRAME)
+            continue;
+
+        for (uint32_t frame = 0; frame < m_framesPerHunk; frame++) {
+            const uint32_t absoluteFrame = firstFrame + frame;
+
+            if (absoluteFrame < extent.startFrame || absoluteFrame >= extent.startFrame + extent.sectorsCount)
+                continue;
+
+            std::byte* sample = hunk->data() + frame * CHD_CD_FRAME_SIZE;
+
+            for (size_t i = 0; i < CD_RAW_SECTOR_SIZE; i += 2) {
+                std::swap(sample[i], sample[i + 1]);
+            }
+        }
+    }
+
+    return hunk;
+}
+
+auto festation::ChdImage::insertHunk(uint32_t hunkIndex, std::shared_ptr<const HunkBuffer> hunk) -> void
+{
+    {
+        std::scoped_lock lock(m_cacheMutex);
+        m_inFlightHunks.erase(hunkIndex);
+
+        if (hunk && !m_cachedHunks.contains(hunkIndex)) {
+            /** @brief Evicted buffers stay alive while a DiscSector still references them */
+            if (m_cachedHunks.size() >= HUNK_CACHE_CAPACITY) {
+                m_cachedHunks.erase(m_lruOrder.back());
+                m_lruOrder.pop_back();
+            }
+
+            m_lruOrder.push_front(hunkIndex);
+            m_cachedHunks.emplace(hunkIndex, CachedHunk{ std::move(hunk), m_lruOrder.begin() });
+        }
+    }
+
+    m_cacheChanged.notify_all();
+}
+
+auto festation::ChdImage::queuePrefetch(uint32_t hunkIndex) -> void
+{
+    if (m_workers.empty())
+        return;
+
+    {
+        std::scoped_lock lock(m_cacheMutex);
+
+        /** @brief Consecutive sectors of the same hunk don't need to requeue anything */
+        if (hunkIndex == m_lastPrefetchOrigin)
+            return;
+
+        m_lastPrefetchOrigin = hunkIndex;
+        m_prefetchQueue.clear();
+
+        for (uint32_t next = hunkIndex + 1; next <= hunkIndex + PREFETCH_HUNKS && next < m_hunksCount; next++) {
+            if (!m_cachedHunks.contains(next) && !m_inFlightHunks.contains(next)) {
+                m_prefetchQueue.push_back(next);
+            }
+        }
+
+        if (m_prefetchQueue.empty())
+            return;
+    }
+
+    m_cacheChanged.notify_all();
+}
+
+auto festation::ChdImage::workerLoop(std::stop_token stopToken, chd_file* chd) -> void
+{
+    while (!stopToken.stop_requested()) {
+        uint32_t hunkIndex{};
+
+        {
+            std::unique_lock lock(m_cacheMutex);
+
+            bool pending = m_cacheChanged.wait(lock, stopToken, [this]() {
+                return !m_prefetchQueue.empty();
+            });
+
+            if (!pending)
+                return;
+
+            hunkIndex = m_prefetchQueue.front();
+            m_prefetchQueue.pop_front();
+
+            if (m_cachedHunks.contains(hunkIndex) || m_inFlightHunks.contains(hunkIndex))
+                continue;
+
+            m_inFlightHunks.insert(hunkIndex);
+            m_stats.prefetchedHunks++;
+        }
+
+        insertHunk(hunkIndex, decompressHunk(chd, hunkIndex));
+    }
+}
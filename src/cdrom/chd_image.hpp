@@ -0,0 +1,104 @@
+#pragma once
+
+#include "disc_image.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct _chd_file;
+
+namespace festation {
+    struct HunkCacheStats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t prefetchedHunks;
+    };
+
+    /**
+     * @brief Compressed (MAME CHD) disc image. Hunks are decompressed into an LRU cache,
+     * a worker pool keeps decompressing the hunks right after the one being read.
+     */
+    class ChdImage : public IDiscImage {
+    public:
+        ChdImage() = default;
+        ~ChdImage();
+
+        ChdImage(const ChdImage&) = delete;
+        ChdImage& operator=(const ChdImage&) = delete;
+
+        auto open(const std::filesystem::path& chdPath) -> std::expected<void, CdFileError>;
+
+        auto readSector(size_t lda) -> std::expected<DiscSector, CdFileError> override;
+
+        auto getTracks() const -> std::span<const DiscTrack> override { return m_tracks; }
+        auto getSectorsCount() const -> size_t override { return m_ldaToExtent.size(); }
+
+        auto getCacheStats() const -> HunkCacheStats;
+
+    private:
+        using HunkBuffer = std::vector<std::byte>;
+
+        /** @brief Contiguous run of sectors of the same track. Pregaps not stored in the CHD have no frames */
+        struct SectorExtent {
+            size_t startLda;
+            uint32_t startFrame;
+            uint32_t sectorsCount;
+            uint32_t storedSectorSize;
+            FileTrackType type;
+            uint8_t trackNumber;
+        };
+
+        static constexpr uint32_t NO_FRAME = UINT32_MAX;
+
+        auto parseTracksMetadata() -> std::expected<void, CdFileError>;
+        auto addExtent(const SectorExtent& extent) -> void;
+
+        auto getHunk(uint32_t hunkIndex) -> std::shared_ptr<const HunkBuffer>;
+        auto decompressHunk(_chd_file* chd, uint32_t hunkIndex) const -> std::shared_ptr<const HunkBuffer>;
+        auto insertHunk(uint32_t hunkIndex, std::shared_ptr<const HunkBuffer> hunk) -> void;
+        auto queuePrefetch(uint32_t hunkIndex) -> void;
+        auto workerLoop(std::stop_token stopToken, _chd_file* chd) -> void;
+
+    private:
+        std::filesystem::path m_path;
+        /** @brief libchdr handles aren't thread safe, each worker opens its own */
+        _chd_file* m_chd{};
+        std::mutex m_chdMutex;
+        uint32_t m_hunkBytes{};
+        uint32_t m_hunksCount{};
+        uint32_t m_framesPerHunk{};
+
+        std::vector<SectorExtent> m_extents;
+        std::vector<uint16_t> m_ldaToExtent;
+        std::vector<DiscTrack> m_tracks;
+
+        struct CachedHunk {
+            std::shared_ptr<const HunkBuffer> buffer;
+            std::list<uint32_t>::iterator lruPosition;
+        };
+
+        mutable std::mutex m_cacheMutex;
+        std::condition_variable_any m_cacheChanged;
+        std::unordered_map<uint32_t, CachedHunk> m_cachedHunks;
+        /** @brief Most recently used first */
+        std::list<uint32_t> m_lruOrder;
+        std::unordered_set<uint32_t> m_inFlightHunks;
+        std::deque<uint32_t> m_prefetchQueue;
+        uint32_t m_lastPrefetchOrigin{ NO_FRAME };
+        HunkCacheStats m_stats{};
+
+        std::vector<_chd_file*> m_workerChds;
+        std::vector<std::jthread> m_workers;
+    };
+};
@@ -0,0 +1,196 @@
+#include "cue_bin_image.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <ranges>
+
+namespace festation {
+    /** @brief Backing storage for sectors that exist on the disc but not in the image (PREGAP) */
+    static constexpr std::array<std::byte, 2448> ZERO_SECTOR{};
+};
+
+auto festation::CueBinImage::open(const std::filesystem::path& cuePath) -> std::expected<void, CdFileError>
+{
+    auto filesInfo = parseCueFile(cuePath);
+
+    if (!filesInfo) {
+        return std::unexpected(filesInfo.error());
+    }
+
+    const std::filesystem::path baseDirectory = cuePath.parent_path();
+    size_t discLda = 0;
+
+    for (const BinFileInfo& fileInfo : *filesInfo) {
+        MappedFile binFile;
+
+        if (!binFile.open(baseDirectory / fileInfo.filename)) {
+            LOG_ERROR("Missing BIN file {} referenced by {}", fileInfo.filename, cuePath.string());
+            return std::unexpected(CdFileError::MissingBinFileError);
+        }
+
+        const uint32_t fileIndex = static_cast<uint32_t>(m_binFiles.size());
+        const size_t fileSize = binFile.size();
+        m_binFiles.push_back(std::move(binFile));
+
+        /** @brief INDEX positions are relative to the start of their own file */
+        uint64_t trackFileOffset = 0;
+
+        for (size_t trackIndex = 0; trackIndex < fileInfo.tracks.size(); trackIndex++) {
+            const FileTrackInfo& track = fileInfo.tracks[trackIndex];
+
+            // INDEX 00 (when there) up to INDEX 01 and any later ones, each at or past the previous
+            const bool hasOrderedIndices = std::ranges::is_sorted(track.indices, std::less{},
+                [](const TrackIndexInfo& index) { return convertMSFtoSectors(index.address); });
+
+            if (track.indices.empty() || !hasOrderedIndices) {
+                LOG_ERROR("Track {} of {} has its INDEX entries out of order", track.id, cuePath.string());
+                return std::unexpected(CdFileError::CueParsingError);
+            }
+
+            const size_t sectorSize = getStoredSectorSize(track.type);
+            const size_t firstIndexSector = convertMSFtoSectors(track.indices.front().address);
+
+            auto index01 = std::ranges::find(track.indices, 1uz, &TrackIndexInfo::id);
+            const size_t index01Sector = (index01 != track.indices.end()) ? convertMSFtoSectors(index01->address) : firstIndexSector;
+
+            if (trackIndex == 0) {
+                trackFileOffset = firstIndexSector * sectorSize;
+            }
+
+            const size_t fileSectorsLeft = (fileSize > trackFileOffset) ? (fileSize - trackFileOffset) / sectorSize : 0;
+            size_t sectorsCount = fileSectorsLeft;
+
+            if (trackIndex + 1 < fileInfo.tracks.size() && !fileInfo.tracks[trackIndex + 1].indices.empty()) {
+                const size_t nextTrackSector = convertMSFtoSectors(fileInfo.tracks[trackIndex + 1].indices.front().address);
+                sectorsCount = (nextTrackSector > firstIndexSector) ? nextTrackSector - firstIndexSector : 0;
+            }
+
+            // INDEX 01 must come before the next track starts, and the track must be in the file
+            if (index01Sector - firstIndexSector >= sectorsCount || sectorsCount > fileSectorsLeft) {
+                LOG_ERROR("Track {} of {} doesn't fit between its INDEX 01 and the next track or the end of {}",
+                    track.id, cuePath.string(), fileInfo.filename);
+                return std::unexpected(CdFileError::CueParsingError);
+            }
+
+            if (track.pregap) {
+                const size_t pregapSectors = convertMSFtoSectors(track.pregap->address);
+
+                addExtent({
+                    .startLda = discLda,
+                    .fileIndex = NO_FILE,
+                    .fileOffset = 0,
+                    .storedSectorSize = static_cast<uint32_t>(sectorSize),
+                    .type = track.type,
+                    .trackNumber = static_cast<uint8_t>(track.id),
+                }, pregapSectors);
+
+                discLda += pregapSectors;
+            }
+
+            m_tracks.push_back({
+                .number = static_cast<uint8_t>(track.id),
+                .type = track.type,
+                .startLda = discLda + (index01Sector - firstIndexSector),
+                .sectorsCount = sectorsCount - (index01Sector - firstIndexSector),
+            });
+
+            addExtent({
+                .startLda = discLda,
+                .fileIndex = fileIndex,
+                .fileOffset = trackFileOffset,
+                .storedSectorSize = static_cast<uint32_t>(sectorSize),
+                .type = track.type,
+                .trackNumber = static_cast<uint8_t>(track.id),
+            }, sectorsCount);
+
+            discLda += sectorsCount;
+            trackFileOffset += sectorsCount * sectorSize;
+        }
+    }
+
+    LOG_INFO("Loaded disc image {} ({} files, {} tracks, {} sectors)", cuePath.filename().string(),
+        m_binFiles.size(), m_tracks.size(), m_ldaToExtent.size());
+
+    return {};
+}
+
+auto festation::CueBinImage::openSingleTrack(const std::filesystem::path& binPath, FileTrackType type) -> std::expected<void, CdFileError>
+{
+    if (!std::filesystem::exists(binPath)) {
+        return std::unexpected(CdFileError::FileExistsError);
+    }
+
+    MappedFile binFile;
+
+    if (!binFile.open(binPath)) {
+        return std::unexpected(CdFileError::FileOpeningError);
+    }
+
+    const size_t sectorSize = getStoredSectorSize(type);
+    const size_t sectorsCount = binFile.size() / sectorSize;
+    m_binFiles.push_back(std::move(binFile));
+
+    m_tracks.push_back({
+        .number = 1,
+        .type = type,
+        .startLda = 0,
+        .sectorsCount = sectorsCount,
+    });
+
+    addExtent({
+        .startLda = 0,
+        .fileIndex = 0,
+        .fileOffset = 0,
+        .storedSectorSize = static_cast<uint32_t>(sectorSize),
+        .type = type,
+        .trackNumber = 1,
+    }, sectorsCount);
+
+    return {};
+}
+
+auto festation::CueBinImage::readSector(size_t lda) -> std::expected<DiscSector, CdFileError>
+{
+    if (lda >= m_ldaToExtent.size()) {
+        return std::unexpected(CdFileError::SectorOutOfRangeError);
+    }
+
+    const SectorExtent& extent = m_extents[m_ldaToExtent[lda]];
+
+    if (extent.fileIndex == NO_FILE) {
+        return DiscSector{
+            .data = std::span(ZERO_SECTOR).first(extent.storedSectorSize),
+            .format = extent.type,
+            .trackNumber = extent.trackNumber,
+        };
+    }
+
+    const std::span<const std::byte> fileData = m_binFiles[extent.fileIndex].data();
+    const uint64_t offset = extent.fileOffset + (lda - extent.startLda) * extent.storedSectorSize;
+
+    if (offset + extent.storedSectorSize > fileData.size()) {
+        return std::unexpected(CdFileError::SectorOutOfRangeError);
+    }
+
+    return DiscSector{
+        .data = fileData.subspan(offset, extent.storedSectorSize),
+        .format = extent.type,
+        .trackNumber = extent.trackNumber,
+    };
+}
+
+auto festation::CueBinImage::addExtent(const SectorExtent& extent, size_t sectorsCount) -> void
+{
+    if (sectorsCount == 0)
+        return;
+
+    assert(extent.startLda == m_ldaToExtent.size());
+    assert(m_extents.size() < std::numeric_limits<uint16_t>::max());
+
+    const uint16_t extentIndex = static_cast<uint16_t>(m_extents.size());
+    m_extents.push_back(extent);
+    m_ldaToExtent.insert(m_ldaToExtent.end(), sectorsCount, extentIndex);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "disc_image.hpp"
+#include "utils/mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <vector>
+
+namespace festation {
+    class CueBinImage : public IDiscImage {
+    public:
+        auto open(const std::filesystem::path& cuePath) -> std::expected<void, CdFileError>;
+
+        /** @brief Headerless image made of a single data track (plain .bin/.img/.iso dumps) */
+        auto openSingleTrack(const std::filesystem::path& binPath, FileTrackType type) -> std::expected<void, CdFileError>;
+
+        auto readSector(size_t lda) -> std::expected<DiscSector, CdFileError> override;
+
+        auto getTracks() const -> std::span<const DiscTrack> override { return m_tracks; }
+        auto getSectorsCount() const -> size_t override { return m_ldaToExtent.size(); }
+
+    private:
+        /** @brief Contiguous run of sectors sharing file, format and track. PREGAP runs are not stored in any file */
+        struct SectorExtent {
+            size_t startLda;
+            uint32_t fileIndex;
+            uint64_t fileOffset;
+            uint32_t storedSectorSize;
+            FileTrackType type;
+            uint8_t trackNumber;
+        };
+
+        static constexpr uint32_t NO_FILE = UINT32_MAX;
+
+        auto addExtent(const SectorExtent& extent, size_t sectorsCount) -> void;
+
+    private:
+        std::vector<MappedFile> m_binFiles;
+        std::vector<SectorExtent> m_extents;
+        /** @brief One entry per sector so a lookup is a single index no matter how many files or tracks there are */
+        std::vector<uint16_t> m_ldaToExtent;
+        std::vector<DiscTrack> m_tracks;
+    };
+};
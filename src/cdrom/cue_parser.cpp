@@ -3,8 +3,10 @@
 
 #include <array>
 #include <cassert>
+#include <cctype>
 #include <charconv>
 #include <fstream>
+#include <iomanip>
 #include <ranges>
 #include <sstream>
 #include <string>
@@ -55,7 +57,7 @@ static auto operator>>(std::istream& iss, festation::FileTrackType& trackType) -
         trackType = festation::FileTrackType::CDI_2352;
     }
     else {
-        std::unreachable();
+        iss.setstate(std::ios::failbit);
     }
 
     return iss;
@@ -115,6 +117,10 @@ auto festation::parseCueFile(const std::filesystem::path& cuePath) -> std::expec
 
             iss >> _trackToken >> id >> trackType;
 
+            if (iss.fail()) {
+                return std::unexpected(CdFileError::CueParsingError);
+            }
+
             trackInfo.id = id;
             trackInfo.type = trackType;
 
@@ -0,0 +1,45 @@
+#include "disc_image.hpp"
+#include "chd_image.hpp"
+#include "cue_bin_image.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+auto festation::IDiscImage::createUnique(const std::filesystem::path& path) -> std::expected<std::unique_ptr<IDiscImage>, CdFileError>
+{
+    std::string extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char chr) { return std::tolower(chr); });
+
+    if (extension == ".chd") {
+        auto chdImage = std::make_unique<ChdImage>();
+
+        if (auto result = chdImage->open(path); !result) {
+            return std::unexpected(result.error());
+        }
+
+        return chdImage;
+    }
+
+    auto image = std::make_unique<CueBinImage>();
+    std::expected<void, CdFileError> result{};
+
+    if (extension == ".cue") {
+        result = image->open(path);
+    }
+    else if (extension == ".bin" || extension == ".img") {
+        result = image->openSingleTrack(path, FileTrackType::MODE2_2352);
+    }
+    else if (extension == ".iso") {
+        result = image->openSingleTrack(path, FileTrackType::MODE1_2048);
+    }
+    else {
+        return std::unexpected(CdFileError::UnsupportedFormatError);
+    }
+
+    if (!result) {
+        return std::unexpected(result.error());
+    }
+
+    return image;
+}
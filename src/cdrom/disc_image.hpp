@@ -0,0 +1,64 @@
+#pragma once
+
+#include "cdrom_common.hpp"
+#include "cue_parser.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace festation {
+    /** @brief Sector as stored in the image, its layout depends on the track format (2048, 2336, 2352 or 2448 bytes) */
+    struct DiscSector {
+        std::span<const std::byte> data;
+        FileTrackType format;
+        uint8_t trackNumber;
+        /** @brief Keeps cached (e.g. decompressed) data alive while the view is in use, empty for mapped images */
+        std::shared_ptr<const void> owner{};
+    };
+
+    struct DiscTrack {
+        uint8_t number;
+        FileTrackType type;
+        /** @brief LDA of INDEX 01 */
+        size_t startLda;
+        size_t sectorsCount;
+    };
+
+    class IDiscImage {
+    public:
+        virtual ~IDiscImage() = default;
+
+        /** @brief Returned view is valid while the image is open and the sector (its owner) is held. Called from the read-ahead thread too */
+        virtual auto readSector(size_t lda) -> std::expected<DiscSector, CdFileError> = 0;
+
+        virtual auto getTracks() const -> std::span<const DiscTrack> = 0;
+        virtual auto getSectorsCount() const -> size_t = 0;
+
+        static auto createUnique(const std::filesystem::path& path) -> std::expected<std::unique_ptr<IDiscImage>, CdFileError>;
+    };
+
+    inline constexpr auto getStoredSectorSize(FileTrackType type) -> size_t
+    {
+        switch (type)
+        {
+        case FileTrackType::MODE1_2048:
+            return 2048;
+        case FileTrackType::MODE2_2336:
+        case FileTrackType::CDI_2336:
+            return 2336;
+        case FileTrackType::CDG:
+            return 2448;
+        case FileTrackType::AUDIO:
+        case FileTrackType::MODE1_2352:
+        case FileTrackType::MODE2_2352:
+        case FileTrackType::CDI_2352:
+            return CD_RAW_SECTOR_SIZE;
+        }
+
+        return CD_RAW_SECTOR_SIZE;
+    }
+};
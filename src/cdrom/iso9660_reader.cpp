@@ -0,0 +1,160 @@
+#include "iso9660_reader.hpp"
+#include "cd_reader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <span>
+
+namespace festation {
+    static constexpr size_t ISO_SECTOR_SIZE = CD_SECTOR_SIZES[0];
+    static constexpr size_t PRIMARY_VOLUME_DESCRIPTOR_LDA = 16;
+    static constexpr size_t ROOT_RECORD_OFFSET = 156;
+    static constexpr uint8_t RECORD_FLAG_DIRECTORY = 0x02;
+
+    static auto readLittleEndian32(std::span<const uint8_t> data, size_t offset) -> uint32_t
+    {
+        uint32_t value;
+        std::memcpy(&value, data.data() + offset, sizeof(uint32_t));
+        return value;
+    }
+
+    /** @brief ISO names are upper case and files carry a ";1" version the caller may leave out */
+    static auto isSameName(std::string_view recordName, std::string_view name) -> bool
+    {
+        if (!name.contains(';')) {
+            recordName = recordName.substr(0, recordName.find(';'));
+        }
+
+        return std::ranges::equal(recordName, name, [](char a, char b) {
+            return std::toupper(static_cast<unsigned char>(a)) == std::toupper(static_cast<unsigned char>(b));
+        });
+    }
+};
+
+festation::Iso9660Reader::Iso9660Reader(CDReader& reader)
+    : m_reader(reader)
+{
+}
+
+auto festation::Iso9660Reader::readFile(std::string_view path) -> std::expected<std::vector<uint8_t>, CdFileError>
+{
+    auto record = findRecord(path);
+
+    if (!record)
+        return std::unexpected(record.error());
+
+    return readExtent(*record);
+}
+
+auto festation::Iso9660Reader::findFile(std::string_view path) -> std::expected<DiscFileLocation, CdFileError>
+{
+    auto record = findRecord(path);
+
+    if (!record)
+        return std::unexpected(record.error());
+
+    return DiscFileLocation{ .lda = record->lda, .size = record->size };
+}
+
+auto festation::Iso9660Reader::findRecord(std::string_view path) -> std::expected<DirectoryRecord, CdFileError>
+{
+    auto record = readRootRecord();
+
+    while (record && !path.empty()) {
+        const size_t separator = path.find_first_of("\\/");
+        const std::string_view name = path.substr(0, separator);
+        path = (separator == std::string_view::npos) ? std::string_view{} : path.substr(separator + 1);
+
+        if (name.empty())
+            continue;
+
+        if (!record->isDirectory)
+            return std::unexpected(CdFileError::FileExistsError);
+
+        record = findRecord(*record, name);
+    }
+
+    if (!record)
+        return std::unexpected(record.error());
+
+    if (record->isDirectory)
+        return std::unexpected(CdFileError::FileExistsError);
+
+    return record;
+}
+
+auto festation::Iso9660Reader::readRootRecord() -> std::expected<DirectoryRecord, CdFileError>
+{
+    auto sector = m_reader.readCdSector(PRIMARY_VOLUME_DESCRIPTOR_LDA, ISO_SECTOR_SIZE);
+
+    if (!sector)
+        return std::unexpected(sector.error());
+
+    const std::span<const uint8_t> descriptor{ reinterpret_cast<const uint8_t*>(sector->data()), sector->size() };
+
+    if (descriptor.size() < ISO_SECTOR_SIZE || descriptor[0] != 0x01 || std::memcmp(&descriptor[1], "CD001", 5) != 0)
+        return std::unexpected(CdFileError::InvalidFilesystemError);
+
+    return DirectoryRecord{
+        .lda = readLittleEndian32(descriptor, ROOT_RECORD_OFFSET + 2),
+        .size = readLittleEndian32(descriptor, ROOT_RECORD_OFFSET + 10),
+        .isDirectory = true,
+    };
+}
+
+auto festation::Iso9660Reader::findRecord(const DirectoryRecord& directory, std::string_view name) -> std::expected<DirectoryRecord, CdFileError>
+{
+    auto entries = readExtent(directory);
+
+    if (!entries)
+        return std::unexpected(entries.error());
+
+    const std::span<const uint8_t> data = *entries;
+    size_t offset = 0;
+
+    while (offset < data.size()) {
+        const uint8_t recordLength = data[offset];
+
+        /** @brief Records never cross sectors, the rest of the sector is zero padded */
+        if (recordLength == 0) {
+            offset = (offset / ISO_SECTOR_SIZE + 1) * ISO_SECTOR_SIZE;
+            continue;
+        }
+
+        if (recordLength < 34 || offset + recordLength > data.size())
+            return std::unexpected(CdFileError::InvalidFilesystemError);
+
+        const uint8_t nameLength = data[offset + 32];
+        const std::string_view recordName{ reinterpret_cast<const char*>(&data[offset + 33]), std::min<size_t>(nameLength, recordLength - 33) };
+
+        if (isSameName(recordName, name)) {
+            return DirectoryRecord{
+                .lda = readLittleEndian32(data, offset + 2),
+                .size = readLittleEndian32(data, offset + 10),
+                .isDirectory = (data[offset + 25] & RECORD_FLAG_DIRECTORY) != 0,
+            };
+        }
+
+        offset += recordLength;
+    }
+
+    return std::unexpected(CdFileError::FileExistsError);
+}
+
+auto festation::Iso9660Reader::readExtent(const DirectoryRecord& record) -> std::expected<std::vector<uint8_t>, CdFileError>
+{
+    std::vector<uint8_t> data(record.size);
+
+    for (size_t offset = 0; offset < data.size(); offset += ISO_SECTOR_SIZE) {
+        auto sector = m_reader.readCdSector(record.lda + offset / ISO_SECTOR_SIZE, ISO_SECTOR_SIZE);
+
+        if (!sector)
+            return std::unexpected(sector.error());
+
+        const size_t copySize = std::min({ sector->size(), ISO_SECTOR_SIZE, data.size() - offset });
+        std::memcpy(data.data() + offset, sector->data(), copySize);
+    }
+
+    return data;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "cdrom_common.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string_view>
+#include <vector>
+
+namespace festation {
+    class CDReader;
+
+    struct DiscFileLocation {
+        uint32_t lda;
+        uint32_t size;
+    };
+
+    /** @brief Just enough ISO 9660 to fetch files by path from a data disc (SYSTEM.CNF, boot EXE) */
+    class Iso9660Reader {
+    public:
+        explicit Iso9660Reader(CDReader& reader);
+
+        /** @brief Path relative to the root, '\' or '/' separated, case insensitive and with an optional ";1" version */
+        auto readFile(std::string_view path) -> std::expected<std::vector<uint8_t>, CdFileError>;
+        auto findFile(std::string_view path) -> std::expected<DiscFileLocation, CdFileError>;
+
+    private:
+        struct DirectoryRecord {
+            uint32_t lda;
+            uint32_t size;
+            bool isDirectory;
+        };
+
+        auto findRecord(std::string_view path) -> std::expected<DirectoryRecord, CdFileError>;
+        auto readRootRecord() -> std::expected<DirectoryRecord, CdFileError>;
+        auto findRecord(const DirectoryRecord& directory, std::string_view name) -> std::expected<DirectoryRecord, CdFileError>;
+        auto readExtent(const DirectoryRecord& record) -> std::expected<std::vector<uint8_t>, CdFileError>;
+
+    private:
+        CDReader& m_reader;
+    };
+};
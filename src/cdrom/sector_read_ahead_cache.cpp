@@ -0,0 +1,142 @@
+#include "sector_read_ahead_cache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+festation::SectorReadAheadCache::SectorReadAheadCache(IDiscImage& discImage, size_t sectorsCount)
+    : m_discImage(discImage), m_slots(sectorsCount)
+{
+    assert(sectorsCount > 0);
+
+    m_ioThread = std::jthread([this](std::stop_token stopToken) {
+        ioThreadLoop(stopToken);
+    });
+}
+
+festation::SectorReadAheadCache::~SectorReadAheadCache()
+{
+    m_ioThread.request_stop();
+    m_wakeUp.notify_all();
+}
+
+auto festation::SectorReadAheadCache::prefetch(size_t lda) -> void
+{
+    {
+        std::scoped_lock lock(m_mutex);
+        m_windowStart = lda;
+    }
+
+    m_wakeUp.notify_one();
+}
+
+auto festation::SectorReadAheadCache::lookup(size_t lda) -> std::optional<DiscSector>
+{
+    std::optional<DiscSector> result{};
+
+    {
+        std::scoped_lock lock(m_mutex);
+        m_pinnedSlot = NO_SECTOR;
+
+        const size_t slotIndex = getSlotIndex(lda);
+        const Slot& slot = m_slots[slotIndex];
+
+        if (slot.lda == lda && slot.size > 0) {
+            m_stats.hits++;
+            m_pinnedSlot = slotIndex;
+
+            result = DiscSector{
+                .data = std::span(slot.data).first(slot.size),
+                .format = slot.format,
+                .trackNumber = slot.trackNumber,
+            };
+        }
+        else {
+            m_stats.misses++;
+        }
+
+        /** @brief Follow the read head so streaming keeps the window full */
+        m_windowStart = lda;
+    }
+
+    m_wakeUp.notify_one();
+    return result;
+}
+
+auto festation::SectorReadAheadCache::getStats() const -> ReadAheadStats
+{
+    std::scoped_lock lock(m_mutex);
+    return m_stats;
+}
+
+auto festation::SectorReadAheadCache::ioThreadLoop(std::stop_token stopToken) -> void
+{
+    std::array<std::byte, MAX_STORED_SECTOR_SIZE> sectorData{};
+
+    while (!stopToken.stop_requested()) {
+        size_t lda{};
+
+        {
+            std::unique_lock lock(m_mutex);
+            std::optional<size_t> sectorToLoad{};
+
+            bool pending = m_wakeUp.wait(lock, stopToken, [&]() {
+                sectorToLoad = findSectorToLoad();
+                return sectorToLoad.has_value();
+            });
+
+            if (!pending)
+                return;
+
+            lda = *sectorToLoad;
+        }
+
+        /** @brief The actual disc access (page faults, network storage...) happens without holding the lock */
+        auto sector = m_discImage.readSector(lda);
+        size_t size{};
+
+        if (sector) {
+            size = std::min(sector->data.size(), sectorData.size());
+            std::memcpy(sectorData.data(), sector->data.data(), size);
+        }
+
+        std::scoped_lock lock(m_mutex);
+        const size_t slotIndex = getSlotIndex(lda);
+
+        if (!isInWindow(lda) || slotIndex == m_pinnedSlot)
+            continue;
+
+        Slot& slot = m_slots[slotIndex];
+        slot.lda = lda;
+        slot.size = size;
+
+        if (sector) {
+            std::memcpy(slot.data.data(), sectorData.data(), size);
+            slot.format = sector->format;
+            slot.trackNumber = sector->trackNumber;
+            m_stats.prefetchedSectors++;
+        }
+    }
+}
+
+auto festation::SectorReadAheadCache::findSectorToLoad() const -> std::optional<size_t>
+{
+    if (m_windowStart == NO_SECTOR)
+        return std::nullopt;
+
+    const size_t windowEnd = std::min(m_windowStart + m_slots.size(), m_discImage.getSectorsCount());
+
+    for (size_t lda = m_windowStart; lda < windowEnd; lda++) {
+        const size_t slotIndex = getSlotIndex(lda);
+
+        if (m_slots[slotIndex].lda != lda && slotIndex != m_pinnedSlot)
+            return lda;
+    }
+
+    return std::nullopt;
+}
+
+auto festation::SectorReadAheadCache::isInWindow(size_t lda) const -> bool
+{
+    return m_windowStart != NO_SECTOR && lda >= m_windowStart && lda < m_windowStart + m_slots.size();
+}
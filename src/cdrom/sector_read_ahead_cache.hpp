@@ -0,0 +1,72 @@
+#pragma once
+
+#include "disc_image.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace festation {
+    struct ReadAheadStats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t prefetchedSectors;
+    };
+
+    /**
+     * @brief Fixed-size window of sectors filled by an I/O thread ahead of the drive's read head.
+     * Only host-side latency changes: a miss falls back to a synchronous read of the same data,
+     * so emulated timing doesn't depend on whether the sector was prefetched or not.
+     */
+    class SectorReadAheadCache {
+    public:
+        SectorReadAheadCache(IDiscImage& discImage, size_t sectorsCount);
+        ~SectorReadAheadCache();
+
+        SectorReadAheadCache(const SectorReadAheadCache&) = delete;
+        SectorReadAheadCache& operator=(const SectorReadAheadCache&) = delete;
+
+        /** @brief Moves the window to [lda, lda + capacity) and wakes up the I/O thread */
+        auto prefetch(size_t lda) -> void;
+
+        /** @brief Returned view stays valid until the next lookup */
+        auto lookup(size_t lda) -> std::optional<DiscSector>;
+
+        auto getStats() const -> ReadAheadStats;
+        auto getCapacity() const -> size_t { return m_slots.size(); }
+
+    private:
+        static constexpr size_t MAX_STORED_SECTOR_SIZE = 2448;
+        static constexpr size_t NO_SECTOR = SIZE_MAX;
+
+        struct Slot {
+            std::array<std::byte, MAX_STORED_SECTOR_SIZE> data;
+            size_t lda{ NO_SECTOR };
+            size_t size{};
+            FileTrackType format{};
+            uint8_t trackNumber{};
+        };
+
+        auto ioThreadLoop(std::stop_token stopToken) -> void;
+        auto findSectorToLoad() const -> std::optional<size_t>;
+        auto isInWindow(size_t lda) const -> bool;
+        auto getSlotIndex(size_t lda) const -> size_t { return lda % m_slots.size(); }
+
+    private:
+        IDiscImage& m_discImage;
+        std::vector<Slot> m_slots;
+        size_t m_windowStart{ NO_SECTOR };
+        /** @brief Slot handed out by the last lookup, the I/O thread never overwrites it */
+        size_t m_pinnedSlot{ NO_SECTOR };
+        ReadAheadStats m_stats{};
+
+        mutable std::mutex m_mutex;
+        std::condition_variable_any m_wakeUp;
+        std::jthread m_ioThread;
+    };
+};
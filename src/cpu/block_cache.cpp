@@ -0,0 +1,231 @@
+#include "block_cache.hpp"
+#include "instruction_timing.hpp"
+#include "psx_system.hpp"
+#include "memory/memory_map_masks.hpp"
+
+#include <cstring>
+#include <optional>
+
+namespace festation
+{
+    static constexpr uint32_t INSTRUCTION_SIZE = 4;
+    /** @brief Whole cache is dropped past this, code that keeps moving around just gets decoded again */
+    static constexpr size_t MAX_CACHED_BLOCKS = 0x10000;
+
+    static bool isControlTransfer(const InstructionDescriptor& descriptor)
+    {
+        switch (descriptor.format)
+        {
+        case OperandFormat::Target:
+        case OperandFormat::RsRtOffset:
+        case OperandFormat::RsOffset:
+            return true;
+        default:
+            return descriptor.handler == &executeRs<jr> || descriptor.handler == &executeRsRd<jalr>;
+        }
+    }
+
+    static bool isLoad(uint8_t opcode)
+    {
+        return opcode >= 0x20 && opcode <= 0x26;
+    }
+
+    /** @brief Only writes registers: ALU ops, lui and loads (no stores, HI/LO, coprocessors nor syscall/break) */
+    static bool isIdleLoopOp(uint32_t instruction)
+    {
+        const uint8_t opcode = getInstOpcode(instruction);
+
+        if (opcode == 0x00)
+        {
+            const uint8_t function = getInstFunctionOperation(instruction);
+            return function <= 0x07 || (function >= 0x20 && function <= 0x2B);
+        }
+
+        return (opcode >= 0x08 && opcode <= 0x0F) || isLoad(opcode);
+    }
+
+    /** @brief Target of a branch or j/jal at address, register jumps don't have one */
+    static std::optional<uint32_t> getStaticJumpTarget(const InstructionDescriptor& descriptor, uint32_t instruction, uint32_t address)
+    {
+        const uint32_t nextAddress = address + INSTRUCTION_SIZE;
+
+        switch (descriptor.format)
+        {
+        case OperandFormat::Target:
+            return (nextAddress & 0xF0000000) | (getInstAddress(instruction) << 2);
+        case OperandFormat::RsRtOffset:
+        case OperandFormat::RsOffset:
+            return nextAddress + (static_cast<uint32_t>(signExtend(getInstImmediate(instruction))) << 2);
+        default:
+            return std::nullopt;
+        }
+    }
+
+    static bool isMemoryAccess(uint8_t opcode)
+    {
+        return opcode >= 0x20;
+    }
+
+    /** @brief add/sub/addi overflow, loads/stores may be misaligned */
+    static bool mayTrap(uint8_t opcode, uint8_t function)
+    {
+        if (opcode == 0x00)
+            return function == 0x20 || function == 0x22;
+
+        return opcode == 0x08 || isMemoryAccess(opcode);
+    }
+
+    static uint8_t getOpFlags(const InstructionDescriptor& descriptor, uint32_t instruction)
+    {
+        const uint8_t opcode = getInstOpcode(instruction);
+        const uint8_t function = getInstFunctionOperation(instruction);
+        const reg_t rd = getInstDestRegEncoding<EncodingType::REGISTER>(instruction);
+        const reg_t rt = getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction);
+        uint8_t flags = mayTrap(opcode, function) ? MAY_TRAP : 0;
+
+        switch (descriptor.format)
+        {
+        case OperandFormat::RdRtShift:
+        case OperandFormat::RdRtRs:
+        case OperandFormat::RdRsRt:
+        case OperandFormat::RsRd:
+        case OperandFormat::Rd:
+            flags |= (rd == 0) ? CLEARS_ZERO_REGISTER : 0;
+            break;
+        case OperandFormat::RtRsImm:
+        case OperandFormat::RtImm:
+            flags |= (rt == 0) ? CLEARS_ZERO_REGISTER : 0;
+            break;
+        case OperandFormat::Code:
+            flags |= MAY_TRAP;
+            break;
+        case OperandFormat::Group:
+        case OperandFormat::None:
+            flags |= MAY_TRAP | CLEARS_ZERO_REGISTER;
+            break;
+        default:
+            break;
+        }
+
+        const bool isStore = (opcode >= 0x28 && opcode <= 0x2E) || (opcode >= 0x38 && opcode <= 0x3B);
+
+        if (isStore || opcode == 0x10)
+            flags |= MAY_CHANGE_IRQ;
+
+        if (isMemoryAccess(opcode))
+            flags |= SYNCS_TIME;
+
+        if (opcode == 0x00 && SPECIAL_OPCODE_TIMINGS[function].timingClass != InstructionTimingClass::Simple)
+            flags |= HILO_TIMING;
+
+        return flags;
+    }
+};
+
+const festation::CodeBlock* festation::BlockCache::getBlock(uint32_t pc, PSXSystem& system)
+{
+    if (!isCacheableAddress(pc))
+        return nullptr;
+
+    if (blocks.size() >= MAX_CACHED_BLOCKS)
+        blocks.clear();
+
+    auto [entry, isNew] = blocks.try_emplace(pc);
+    CodeBlock& block = entry->second;
+
+    if (isNew || (block.isInMainRAM && !isUnchanged(block, system.getMainRAM())))
+        compileBlock(block, pc, system);
+
+    return &block;
+}
+
+void festation::BlockCache::clear()
+{
+    blocks.clear();
+}
+
+bool festation::BlockCache::isCacheableAddress(uint32_t pc)
+{
+    const uint32_t physicalPc = pc & PHYSICAL_MEMORY_MASK;
+
+    // KSEG2 only holds the cache control registers
+    if ((pc & (INSTRUCTION_SIZE - 1)) != 0 || pc >= 0xC0000000)
+        return false;
+
+    return physicalPc <= MAIN_RAM_END || (physicalPc >= BIOS_ROM_START && physicalPc <= BIOS_ROM_END);
+}
+
+bool festation::BlockCache::isUnchanged(const CodeBlock& block, std::span<const uint8_t> mainRAM)
+{
+    const uint32_t offset = block.startPc & MAIN_RAM_SIZE_MASK;
+    return std::memcmp(&mainRAM[offset], block.code.data(), block.code.size() * sizeof(uint32_t)) == 0;
+}
+
+void festation::BlockCache::compileBlock(CodeBlock& block, uint32_t pc, PSXSystem& system)
+{
+    const uint32_t physicalPc = pc & PHYSICAL_MEMORY_MASK;
+
+    block.startPc = pc;
+    block.isInMainRAM = physicalPc <= MAIN_RAM_END;
+    block.uncachedFetchCycles = getUncachedFetchCycles(pc);
+    block.code.clear();
+    block.ops.clear();
+
+    const uint32_t regionMask = block.isInMainRAM ? MAIN_RAM_SIZE_MASK : BIOS_ROM_SIZE_MASK;
+    uint32_t address = pc;
+    bool isDelaySlot = false;
+    bool consumesLoadIntoZero = false;
+    bool hasOnlyIdleLoopOps = true;
+    std::optional<uint32_t> jumpTarget;
+
+    while (true)
+    {
+        const uint32_t instruction = system.read32(address);
+        const InstructionDescriptor& descriptor = getInstructionDescriptor(instruction);
+        const uint8_t opcode = getInstOpcode(instruction);
+        const uint8_t baseCycles = (opcode == 0x00) ?
+            SPECIAL_OPCODE_TIMINGS[getInstFunctionOperation(instruction)].baseCycles : PRIMARY_OPCODE_TIMINGS[opcode].baseCycles;
+
+        uint8_t flags = getOpFlags(descriptor, instruction);
+        flags |= consumesLoadIntoZero ? CLEARS_ZERO_REGISTER : 0;
+        flags |= isDelaySlot ? DELAY_SLOT : 0;
+
+        block.code.push_back(instruction);
+        block.ops.push_back({ descriptor.handler, instruction, ThreadedOpKind::Simple, flags, baseCycles });
+
+        // The delay slot closes the block, even if it's a branch itself (its jump is left to the next block)
+        if (isDelaySlot)
+        {
+            hasOnlyIdleLoopOps &= isIdleLoopOp(instruction);
+            break;
+        }
+
+        isDelaySlot = isControlTransfer(descriptor);
+
+        if (isDelaySlot)
+            jumpTarget = getStaticJumpTarget(descriptor, instruction, address);
+        else
+            hasOnlyIdleLoopOps &= isIdleLoopOp(instruction);
+
+        consumesLoadIntoZero = isLoad(opcode) && getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction) == 0;
+        address += INSTRUCTION_SIZE;
+
+        // Blocks don't run past the end of RAM (mirrors) or BIOS, and only stop between a branch and its
+        // delay slot there (the interpreter runs the delay slot then)
+        if ((address & regionMask) == 0 || (!isDelaySlot && block.ops.size() >= MAX_BLOCK_INSTRUCTIONS))
+            break;
+    }
+
+    block.endPc = pc + static_cast<uint32_t>(block.ops.size() - 1) * INSTRUCTION_SIZE;
+    block.isIdleLoop = hasOnlyIdleLoopOps && jumpTarget == pc && (block.ops.back().flags & DELAY_SLOT) &&
+        block.ops.size() <= MAX_IDLE_LOOP_INSTRUCTIONS;
+
+    // Interrupts raised since the last block are taken after its first instruction, as the interpreter does
+    block.ops.front().flags |= MAY_CHANGE_IRQ | CLEARS_ZERO_REGISTER;
+
+    for (ThreadedOp& op : block.ops) {
+        op.kind = (op.flags != 0) ? ThreadedOpKind::Checked : ThreadedOpKind::Simple;
+    }
+
+    block.ops.push_back({ nullptr, 0, ThreadedOpKind::End, 0, 0 });
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "instruction_dispatch.hpp"
+#include "memory/memory_map_masks.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace festation
+{
+    class PSXSystem;
+
+    /** @brief Which threaded interpreter label runs an op */
+    enum class ThreadedOpKind : uint8_t
+    {
+        Simple,     // Just the handler, nothing else to do after it
+        Checked,    // Handler plus the bookkeeping its flags ask for
+        End,        // Past the last instruction of the block
+    };
+
+    enum ThreadedOpFlags : uint8_t
+    {
+        CLEARS_ZERO_REGISTER = 1 << 0,  // May write $zero (directly or consuming a load into it)
+        MAY_TRAP = 1 << 1,              // May raise an exception, moving the PC away
+        MAY_CHANGE_IRQ = 1 << 2,        // Stores (I_STAT/I_MASK, devices) and COP0 ops (SR), may also schedule events
+        HILO_TIMING = 1 << 3,           // mult/div/mfhi/mflo, their cycles depend on the multiplier state
+        DELAY_SLOT = 1 << 4,            // Runs the delayed jump of the branch before it
+        SYNCS_TIME = 1 << 5,            // Loads/stores, devices must see the scheduler at this instruction's time
+    };
+
+    /**
+     * @brief Reads that don't change the device and whose value only changes when a scheduler event runs:
+     * memory, I_STAT/I_MASK, GPUSTAT, DMA registers, CD-ROM status and pad status. Timer counters are out,
+     * they change every few cycles.
+     */
+    constexpr bool isIdlePollAddress(uint32_t address)
+    {
+        const uint32_t physicalAddress = address & PHYSICAL_MEMORY_MASK;
+
+        if (physicalAddress <= MAIN_RAM_END || (physicalAddress >= SCRATCHPAD_START && physicalAddress <= SCRATCHPAD_END) ||
+            (physicalAddress >= BIOS_ROM_START && physicalAddress <= BIOS_ROM_END))
+            return true;
+
+        return (physicalAddress >= 0x1F801070 && physicalAddress <= 0x1F801077) ||   // I_STAT, I_MASK
+            (physicalAddress >= 0x1F801080 && physicalAddress <= 0x1F8010FF) ||      // DMA
+            (physicalAddress >= 0x1F801814 && physicalAddress <= 0x1F801817) ||      // GPUSTAT
+            physicalAddress == 0x1F801800 ||                                        // CD-ROM status
+            (physicalAddress >= 0x1F801044 && physicalAddress <= 0x1F801047);        // JOY_STAT
+    }
+
+    /** @brief Instruction decoded once: its final handler (SPECIAL/REGIMM already resolved) and what it needs around it */
+    struct ThreadedOp
+    {
+        InstructionHandler handler;
+        uint32_t instruction;
+        ThreadedOpKind kind;
+        uint8_t flags;
+        uint8_t baseCycles;
+    };
+
+    /**
+     * @brief Straight-line code from startPc up to a branch/jump and its delay slot (or MAX_BLOCK_INSTRUCTIONS),
+     * followed by an End op. The first op is always Checked, so interrupts raised between blocks are taken.
+     */
+    struct CodeBlock
+    {
+        uint32_t startPc;
+        uint32_t endPc;                     // Address of the last instruction
+        uint32_t uncachedFetchCycles;       // Per instruction, when not going through the instruction cache
+        bool isInMainRAM;                   // RAM blocks are checked against memory before running, BIOS ones can't change
+        bool isIdleLoop;                    // Branches back to its start and only computes registers out of loads (polling, spinning)
+        std::vector<uint32_t> code;
+        std::vector<ThreadedOp> ops;
+    };
+
+    /**
+     * @brief Pre-decoded blocks of RAM and BIOS code by start address (virtual, KSEG0 and KSEG1 copies fetch at
+     * different costs). Instead of tracking every writer of RAM (CPU, DMA, HLE, EXE loading), a RAM block's words
+     * are compared with memory whenever it's looked up, and it's decoded again if they changed.
+     */
+    class BlockCache
+    {
+    public:
+        static constexpr uint32_t MAX_BLOCK_INSTRUCTIONS = 64;
+        static constexpr uint32_t MAX_IDLE_LOOP_INSTRUCTIONS = 16;
+
+        /** @brief Block starting at pc, nullptr if code there can't be cached (not RAM/BIOS) */
+        const CodeBlock* getBlock(uint32_t pc, PSXSystem& system);
+        void clear();
+
+        inline size_t getBlocksCount() const { return blocks.size(); }
+
+    private:
+        static bool isCacheableAddress(uint32_t pc);
+        static bool isUnchanged(const CodeBlock& block, std::span<const uint8_t> mainRAM);
+        static void compileBlock(CodeBlock& block, uint32_t pc, PSXSystem& system);
+
+    private:
+        std::unordered_map<uint32_t, CodeBlock> blocks;
+    };
+};
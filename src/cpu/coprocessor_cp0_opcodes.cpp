@@ -27,6 +27,9 @@ namespace festation
         }
 
         cpu.getCOP0Regs().setCop0RegisterValue(rd, cpu.getCPURegs().gpr_regs[rt]);
+
+        if (rd == SR || rd == CAUSE)
+            cpu.requestInterruptCheck();
     }
     
     void ctc0(MIPS_R3000A_Core& cpu, reg_t rt, reg_t rd)
@@ -46,6 +49,9 @@ namespace festation
         }
 
         cpu.getCOP0Regs().setCop0RegisterValue(rt, cpu.read32(cpu.getCPURegs().gpr_regs[rs] + signExtend(imm)));
+
+        if (rt == SR || rt == CAUSE)
+            cpu.requestInterruptCheck();
     }
 
     void swc0(MIPS_R3000A_Core& cpu, reg_t rt, reg_t rs, immed16_t imm)
@@ -78,5 +84,6 @@ namespace festation
         shiftedBitsSR >>= 2;
 
         cpu.getCOP0Regs().SR.r = (cpu.getCOP0Regs().SR.r & 0xFFFFFFF0) | (shiftedBitsSR & 0xFu);
+        cpu.requestInterruptCheck();
     }
 }
@@ -0,0 +1,225 @@
+#include "cpu_profiler.hpp"
+#include "instruction_dispatch.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <string_view>
+
+namespace festation
+{
+    /** @brief Symbols further than this from an address are assumed to belong to something else */
+    static constexpr uint32_t MAX_SYMBOL_OFFSET = 0x10000;
+
+    static constexpr size_t SPECIAL_SLOTS_BASE = 64;
+    static constexpr size_t REGIMM_SLOTS_BASE = 128;
+
+    /** @brief Handler slot of an instruction: primary opcode, SPECIAL function or BcondZ variant */
+    static size_t getOpcodeSlot(uint32_t instruction)
+    {
+        const uint8_t opcode = getInstOpcode(instruction);
+
+        if (opcode == 0x00)
+            return SPECIAL_SLOTS_BASE + getInstFunctionOperation(instruction);
+
+        if (opcode == 0x01)
+            return REGIMM_SLOTS_BASE + getRegImmIndex(instruction);
+
+        return opcode;
+    }
+
+    static constexpr std::array<std::string_view, CpuProfiler::OPCODE_SLOTS_COUNT> OPCODE_SLOT_NAMES = []() {
+        std::array<std::string_view, CpuProfiler::OPCODE_SLOTS_COUNT> names{};
+
+        // SPECIAL/REGIMM primary entries are never a slot, they're counted by their own instructions
+        for (size_t i = 0; i < INSTRUCTION_TABLE_SIZE; i++) {
+            names[i] = PRIMARY_INSTRUCTIONS[i].mnemonic;
+            names[SPECIAL_SLOTS_BASE + i] = SPECIAL_INSTRUCTIONS[i].mnemonic;
+        }
+
+        for (size_t i = 0; i < REGIMM_TABLE_SIZE; i++)
+            names[REGIMM_SLOTS_BASE + i] = REGIMM_INSTRUCTIONS[i].mnemonic;
+
+        return names;
+    }();
+};
+
+void festation::CpuProfiler::start(uint32_t period)
+{
+    samplingPeriod = std::max(period, 1u);
+    samplingCountdown = samplingPeriod;
+    enabled = true;
+}
+
+void festation::CpuProfiler::stop()
+{
+    enabled = false;
+}
+
+void festation::CpuProfiler::reset()
+{
+    samplingCountdown = samplingPeriod;
+    shadowStack.clear();
+    pcStats.clear();
+    opcodeCounts.fill(0);
+    stackCycles.clear();
+}
+
+void festation::CpuProfiler::trackCallStack(uint32_t pc, uint32_t instruction, uint32_t target)
+{
+    const uint8_t opcode = getInstOpcode(instruction);
+    const uint8_t function = getInstFunctionOperation(instruction);
+    const reg_t rs = getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RS>(instruction);
+    const reg_t rt = getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction);
+
+    const bool isCall = opcode == 0x03 || (opcode == 0x00 && function == 0x09) || (opcode == 0x01 && ((rt >> 1) & 0x0F) == 0x08);
+    const bool isReturn = opcode == 0x00 && function == 0x08 && rs == GprRegs::ra;
+
+    if (isCall) {
+        // Calls that never return (e.g. jumping into the shell) would grow it forever
+        if (shadowStack.size() == MAX_STACK_DEPTH)
+            shadowStack.erase(shadowStack.begin());
+
+        shadowStack.push_back({ target, pc + 8 });
+    }
+    else if (isReturn) {
+        // Unwinds every frame above the one returning there (longjmp-like returns), a jr $ra to elsewhere is just a jump
+        auto frame = std::find_if(shadowStack.rbegin(), shadowStack.rend(),
+            [target](const StackFrame& frame) { return frame.returnAddress == target; });
+
+        if (frame != shadowStack.rend())
+            shadowStack.erase(std::prev(frame.base()), shadowStack.end());
+    }
+}
+
+void festation::CpuProfiler::recordSample(uint32_t pc, uint32_t instruction, uint32_t cycles)
+{
+    samplingCountdown = samplingPeriod;
+
+    // Totals are estimates, each sample stands for a whole period
+    const uint64_t estimatedCycles = static_cast<uint64_t>(cycles) * samplingPeriod;
+
+    PcStats& stats = pcStats[pc];
+    stats.samples++;
+    stats.cycles += estimatedCycles;
+
+    opcodeCounts[getOpcodeSlot(instruction)] += samplingPeriod;
+
+    std::vector<uint32_t> stack(shadowStack.size());
+    std::transform(shadowStack.begin(), shadowStack.end(), stack.begin(), [](const StackFrame& frame) { return frame.entry; });
+    stackCycles[std::move(stack)] += estimatedCycles;
+}
+
+bool festation::CpuProfiler::loadSymbols(const std::filesystem::path& path)
+{
+    std::ifstream fileStream{ path };
+
+    if (!fileStream)
+        return false;
+
+    std::string line;
+
+    while (std::getline(fileStream, line)) {
+        std::string_view text = line;
+
+        if (text.starts_with("0x") || text.starts_with("0X"))
+            text.remove_prefix(2);
+
+        uint32_t address = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), address, 16);
+
+        if (error != std::errc{})
+            continue;
+
+        text.remove_prefix(end - text.data());
+        const size_t nameStart = text.find_first_not_of(" \t");
+        const size_t nameEnd = text.find_last_not_of(" \t\r");
+
+        if (nameStart == std::string_view::npos)
+            continue;
+
+        symbols[address] = std::string(text.substr(nameStart, nameEnd - nameStart + 1));
+    }
+
+    return true;
+}
+
+std::string festation::CpuProfiler::getSymbolName(uint32_t address, bool isFunctionEntry) const
+{
+    auto symbol = symbols.upper_bound(address);
+
+    if (symbol != symbols.begin()) {
+        --symbol;
+        const uint32_t offset = address - symbol->first;
+
+        if (offset == 0)
+            return symbol->second;
+
+        if (offset < MAX_SYMBOL_OFFSET)
+            return std::format("{}+0x{:X}", symbol->second, offset);
+    }
+
+    return isFunctionEntry ? std::format("sub_{:08X}", address) : std::format("{:08X}", address);
+}
+
+bool festation::CpuProfiler::exportFoldedStacks(const std::filesystem::path& path) const
+{
+    std::ofstream fileStream{ path, std::ios::trunc };
+
+    if (!fileStream)
+        return false;
+
+    for (const auto& [stack, cycles] : stackCycles) {
+        std::string line = "root";
+
+        for (uint32_t entry : stack) {
+            line += ';';
+            line += getSymbolName(entry, true);
+        }
+
+        fileStream << std::format("{} {}\n", line, cycles);
+    }
+
+    return fileStream.good();
+}
+
+bool festation::CpuProfiler::exportHotSpots(const std::filesystem::path& path, size_t maxEntries) const
+{
+    std::ofstream fileStream{ path, std::ios::trunc };
+
+    if (!fileStream)
+        return false;
+
+    std::vector<std::pair<uint32_t, PcStats>> hottestPcs(pcStats.begin(), pcStats.end());
+    std::sort(hottestPcs.begin(), hottestPcs.end(), [](const auto& a, const auto& b) { return a.second.cycles > b.second.cycles; });
+
+    const uint64_t totalCycles = std::accumulate(hottestPcs.begin(), hottestPcs.end(), uint64_t{ 0 },
+        [](uint64_t total, const auto& entry) { return total + entry.second.cycles; });
+
+    fileStream << std::format("Sampling period: {} instructions, estimated cycles: {}\n\n", samplingPeriod, totalCycles);
+    fileStream << std::format("{:>8}  {:<40} {:>10} {:>14} {:>7}\n", "PC", "Symbol", "Samples", "Cycles", "%");
+
+    for (size_t i = 0; i < std::min(maxEntries, hottestPcs.size()); i++) {
+        const auto& [pc, stats] = hottestPcs[i];
+        fileStream << std::format("{:08X}  {:<40} {:>10} {:>14} {:>6.2f}%\n", pc, getSymbolName(pc, false), stats.samples, stats.cycles,
+            totalCycles ? 100.0 * stats.cycles / totalCycles : 0.0);
+    }
+
+    std::vector<size_t> slots(OPCODE_SLOTS_COUNT);
+    std::iota(slots.begin(), slots.end(), 0);
+    std::sort(slots.begin(), slots.end(), [this](size_t a, size_t b) { return opcodeCounts[a] > opcodeCounts[b]; });
+
+    fileStream << std::format("\n{:<10} {:>14}\n", "Opcode", "Executed");
+
+    for (size_t slot : slots) {
+        if (opcodeCounts[slot] == 0)
+            break;
+
+        const std::string name = OPCODE_SLOT_NAMES[slot].empty() ? std::format("slot_{:02X}h", slot) : std::string(OPCODE_SLOT_NAMES[slot]);
+        fileStream << std::format("{:<10} {:>14}\n", name, opcodeCounts[slot]);
+    }
+
+    return fileStream.good();
+}
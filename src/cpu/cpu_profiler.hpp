@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace festation
+{
+    /**
+     * @brief Counting/sampling profiler fed by the CPU after each instruction. Every Nth instruction (the
+     * sampling period) is accounted to its PC, its opcode handler and the current call stack. The call
+     * stack is a shadow stack kept on every instruction from linking jumps (jal, jalr, bltzal/bgezal)
+     * and jr $ra, so the folded stacks stay right whatever the period.
+     */
+    class CpuProfiler
+    {
+    public:
+        static constexpr size_t OPCODE_SLOTS_COUNT = 132;
+        static constexpr size_t MAX_STACK_DEPTH = 256;
+
+        struct PcStats
+        {
+            uint64_t samples = 0;
+            uint64_t cycles = 0;
+        };
+
+        /** @brief Period 1 counts every instruction, 1000 is cheap enough to leave on */
+        void start(uint32_t samplingPeriod);
+        void stop();
+        void reset();
+        inline bool isEnabled() const { return enabled; }
+
+        /** @brief Called before the delayed jump is performed, newBranchTarget is set when this instruction took one */
+        inline void onInstructionExecuted(uint32_t pc, uint32_t instruction, std::optional<uint32_t> newBranchTarget, uint32_t cycles)
+        {
+            if (--samplingCountdown == 0)
+                recordSample(pc, instruction, cycles);
+
+            if (newBranchTarget)
+                trackCallStack(pc, instruction, *newBranchTarget);
+        }
+
+        /** @brief Text map of "ADDRESS NAME" lines (hex address), used to name functions and PCs in the exports */
+        bool loadSymbols(const std::filesystem::path& path);
+
+        /** @brief One "root;caller;callee weight" line per sampled stack (weight in cycles), for flamegraph.pl & co */
+        bool exportFoldedStacks(const std::filesystem::path& path) const;
+        /** @brief Hottest PCs by cycles and the per opcode handler counts */
+        bool exportHotSpots(const std::filesystem::path& path, size_t maxEntries = 200) const;
+
+        inline const std::unordered_map<uint32_t, PcStats>& getPcStats() const { return pcStats; }
+        inline const std::array<uint64_t, OPCODE_SLOTS_COUNT>& getOpcodeCounts() const { return opcodeCounts; }
+
+    private:
+        struct StackFrame
+        {
+            uint32_t entry;
+            uint32_t returnAddress;
+        };
+
+        void trackCallStack(uint32_t pc, uint32_t instruction, uint32_t target);
+        void recordSample(uint32_t pc, uint32_t instruction, uint32_t cycles);
+        std::string getSymbolName(uint32_t address, bool isFunctionEntry) const;
+
+    private:
+        bool enabled = false;
+        uint32_t samplingPeriod = 1;
+        uint32_t samplingCountdown = 1;
+
+        std::vector<StackFrame> shadowStack;
+        std::unordered_map<uint32_t, PcStats> pcStats;
+        std::array<uint64_t, OPCODE_SLOTS_COUNT> opcodeCounts{};
+        /** @brief Keyed by the entry points from the outermost frame to the sampled one */
+        std::map<std::vector<uint32_t>, uint64_t> stackCycles;
+        std::map<uint32_t, std::string> symbols;
+    };
+};
@@ -0,0 +1,332 @@
+#include "execution_trace.hpp"
+#include "cpu_masks_types_utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+
+namespace festation
+{
+    /** @brief Records are buffered and written in chunks this big */
+    static constexpr size_t TRACE_FLUSH_SIZE = 1024 * 1024;
+
+    static uint32_t encodeZigZag(int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    static int32_t decodeZigZag(uint32_t value)
+    {
+        return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    static std::string_view getTraceRegisterName(uint8_t index)
+    {
+        if (index == TRACE_HI_REGISTER)
+            return "hi";
+
+        if (index == TRACE_LO_REGISTER)
+            return "lo";
+
+        return g_registerNames[index];
+    }
+};
+
+void festation::ExecutionTraceFormat::resetState(uint32_t initialPc, const std::array<uint32_t, TRACE_REGISTERS_COUNT>& initialRegisters)
+{
+    expectedPc = initialPc;
+    lastAccessAddress = 0;
+    registers = initialRegisters;
+    instructionCache.assign(INSTRUCTION_CACHE_SIZE, { 0xFFFFFFFF, 0 });
+}
+
+festation::ExecutionTraceWriter::~ExecutionTraceWriter()
+{
+    stop();
+}
+
+bool festation::ExecutionTraceWriter::start(const std::filesystem::path& path, uint32_t pc, const std::array<uint32_t, TRACE_REGISTERS_COUNT>& currentRegisters)
+{
+    stop();
+
+    fileStream.open(path, std::ios::binary | std::ios::trunc);
+
+    if (!fileStream)
+        return false;
+
+    resetState(pc, currentRegisters);
+    buffer.clear();
+    buffer.reserve(TRACE_FLUSH_SIZE + 256);
+    pendingAccesses.clear();
+    recordsCount = 0;
+
+    buffer.insert(buffer.end(), MAGIC.begin(), MAGIC.end());
+
+    auto appendWord = [this](uint32_t value) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(uint32_t));
+    };
+
+    appendWord(VERSION);
+    appendWord(pc);
+    std::for_each(currentRegisters.begin(), currentRegisters.end(), appendWord);
+
+    recording = true;
+    return true;
+}
+
+void festation::ExecutionTraceWriter::stop()
+{
+    if (!recording)
+        return;
+
+    flush();
+    fileStream.close();
+    recording = false;
+}
+
+void festation::ExecutionTraceWriter::endInstruction(uint32_t pc, uint32_t instruction, const std::array<uint32_t, TRACE_REGISTERS_COUNT>& currentRegisters)
+{
+    const size_t flagsPosition = buffer.size();
+    uint8_t flags = 0;
+    buffer.push_back(0);
+
+    if (pc != expectedPc) {
+        flags |= PC_NOT_SEQUENTIAL;
+        writeVarint(encodeZigZag(static_cast<int32_t>(pc - expectedPc)));
+    }
+
+    CachedInstruction& cached = instructionCache[getCacheIndex(pc)];
+
+    if (cached.pc != pc || cached.instruction != instruction) {
+        flags |= NEW_INSTRUCTION_WORD;
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&instruction);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(uint32_t));
+        cached = { pc, instruction };
+    }
+
+    uint8_t changedCount = 0;
+
+    for (uint8_t i = 0; i < TRACE_REGISTERS_COUNT; i++) {
+        changedCount += (currentRegisters[i] != registers[i]) ? 1 : 0;
+    }
+
+    if (changedCount) {
+        flags |= HAS_REGISTER_CHANGES;
+        buffer.push_back(changedCount);
+
+        for (uint8_t i = 0; i < TRACE_REGISTERS_COUNT; i++) {
+            if (currentRegisters[i] == registers[i])
+                continue;
+
+            buffer.push_back(i);
+            writeVarint(currentRegisters[i] ^ registers[i]);
+            registers[i] = currentRegisters[i];
+        }
+    }
+
+    if (!pendingAccesses.empty()) {
+        // More than 255 can only come from something other than a single instruction, the rest is dropped
+        const size_t accessesCount = std::min<size_t>(pendingAccesses.size(), 0xFF);
+
+        flags |= HAS_MEMORY_ACCESSES;
+        buffer.push_back(static_cast<uint8_t>(accessesCount));
+
+        for (size_t i = 0; i < accessesCount; i++) {
+            const TraceMemoryAccess& access = pendingAccesses[i];
+
+            buffer.push_back(static_cast<uint8_t>(access.type) | (access.size << 1));
+            writeVarint(encodeZigZag(static_cast<int32_t>(access.address - lastAccessAddress)));
+            writeVarint(access.value);
+            lastAccessAddress = access.address;
+        }
+
+        pendingAccesses.clear();
+    }
+
+    buffer[flagsPosition] = flags;
+    expectedPc = pc + 4;
+    recordsCount++;
+
+    if (buffer.size() >= TRACE_FLUSH_SIZE)
+        flush();
+}
+
+void festation::ExecutionTraceWriter::writeVarint(uint32_t value)
+{
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+
+    buffer.push_back(static_cast<uint8_t>(value));
+}
+
+void festation::ExecutionTraceWriter::flush()
+{
+    fileStream.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    buffer.clear();
+}
+
+bool festation::ExecutionTraceReader::open(const std::filesystem::path& path)
+{
+    fileStream.open(path, std::ios::binary);
+    error = false;
+
+    if (!fileStream)
+        return false;
+
+    std::array<char, 4> magic{};
+    fileStream.read(magic.data(), magic.size());
+
+    uint32_t version = 0;
+    uint32_t pc = 0;
+    std::array<uint32_t, TRACE_REGISTERS_COUNT> initialRegisters{};
+
+    if (magic != MAGIC || !readWord(version) || version != VERSION || !readWord(pc))
+        return false;
+
+    for (uint32_t& value : initialRegisters) {
+        if (!readWord(value))
+            return false;
+    }
+
+    resetState(pc, initialRegisters);
+    return true;
+}
+
+bool festation::ExecutionTraceReader::next(TraceRecord& record)
+{
+    uint8_t flags = 0;
+
+    if (!readByte(flags))
+        return false;
+
+    // From here on, running out of data means the trace was cut in the middle of a record
+    error = true;
+
+    record.pc = expectedPc;
+    record.registerChanges.clear();
+    record.memoryAccesses.clear();
+
+    if (flags & PC_NOT_SEQUENTIAL) {
+        uint32_t delta = 0;
+
+        if (!readVarint(delta))
+            return false;
+
+        record.pc = expectedPc + static_cast<uint32_t>(decodeZigZag(delta));
+    }
+
+    CachedInstruction& cached = instructionCache[getCacheIndex(record.pc)];
+
+    if (flags & NEW_INSTRUCTION_WORD) {
+        if (!readWord(record.instruction))
+            return false;
+
+        cached = { record.pc, record.instruction };
+    }
+    else {
+        record.instruction = cached.instruction;
+    }
+
+    if (flags & HAS_REGISTER_CHANGES) {
+        uint8_t count = 0;
+
+        if (!readByte(count))
+            return false;
+
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t index = 0;
+            uint32_t delta = 0;
+
+            if (!readByte(index) || index >= TRACE_REGISTERS_COUNT || !readVarint(delta))
+                return false;
+
+            registers[index] ^= delta;
+            record.registerChanges.push_back({ index, registers[index] });
+        }
+    }
+
+    if (flags & HAS_MEMORY_ACCESSES) {
+        uint8_t count = 0;
+
+        if (!readByte(count))
+            return false;
+
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t kind = 0;
+            uint32_t addressDelta = 0;
+            uint32_t value = 0;
+
+            if (!readByte(kind) || !readVarint(addressDelta) || !readVarint(value))
+                return false;
+
+            lastAccessAddress += static_cast<uint32_t>(decodeZigZag(addressDelta));
+            record.memoryAccesses.push_back({ static_cast<TraceAccessType>(kind & 1), static_cast<uint8_t>(kind >> 1), lastAccessAddress, value });
+        }
+    }
+
+    expectedPc = record.pc + 4;
+    error = false;
+    return true;
+}
+
+bool festation::ExecutionTraceReader::readByte(uint8_t& value)
+{
+    const auto byte = fileStream.rdbuf()->sbumpc();
+
+    if (byte == std::char_traits<char>::eof())
+        return false;
+
+    value = static_cast<uint8_t>(byte);
+    return true;
+}
+
+bool festation::ExecutionTraceReader::readVarint(uint32_t& value)
+{
+    value = 0;
+
+    for (uint32_t shift = 0; shift < 35; shift += 7) {
+        uint8_t byte = 0;
+
+        if (!readByte(byte))
+            return false;
+
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+bool festation::ExecutionTraceReader::readWord(uint32_t& value)
+{
+    uint8_t bytes[sizeof(uint32_t)];
+
+    for (uint8_t& byte : bytes) {
+        if (!readByte(byte))
+            return false;
+    }
+
+    std::memcpy(&value, bytes, sizeof(uint32_t));
+    return true;
+}
+
+std::string festation::formatTraceRecord(const TraceRecord& record)
+{
+    std::string line = std::format("{:08X}: {:08X}", record.pc, record.instruction);
+
+    for (const TraceRegisterChange& change : record.registerChanges) {
+        line += std::format("  {}={:08X}", getTraceRegisterName(change.index), change.value);
+    }
+
+    for (const TraceMemoryAccess& access : record.memoryAccesses) {
+        line += std::format("  {}{}[{:08X}]={:0{}X}", (access.type == TraceAccessType::Write) ? 'W' : 'R', access.size * 8,
+            access.address, access.value, access.size * 2);
+    }
+
+    return line;
+}
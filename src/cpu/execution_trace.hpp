@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace festation
+{
+    /** @brief GPRs followed by HI and LO, the register indices used in trace records */
+    static constexpr size_t TRACE_REGISTERS_COUNT = 34;
+    static constexpr uint8_t TRACE_HI_REGISTER = 32;
+    static constexpr uint8_t TRACE_LO_REGISTER = 33;
+
+    enum class TraceAccessType : uint8_t
+    {
+        Read,
+        Write,
+    };
+
+    struct TraceMemoryAccess
+    {
+        TraceAccessType type;
+        uint8_t size;       // Bytes (1, 2 or 4)
+        uint32_t address;
+        uint32_t value;
+
+        bool operator==(const TraceMemoryAccess&) const = default;
+    };
+
+    struct TraceRegisterChange
+    {
+        uint8_t index;
+        uint32_t value;
+
+        bool operator==(const TraceRegisterChange&) const = default;
+    };
+
+    /** @brief One executed instruction: where, what and everything it changed (hooks and exceptions included) */
+    struct TraceRecord
+    {
+        uint32_t pc;
+        uint32_t instruction;
+        std::vector<TraceRegisterChange> registerChanges;
+        std::vector<TraceMemoryAccess> memoryAccesses;
+
+        bool operator==(const TraceRecord&) const = default;
+    };
+
+    /**
+     * @brief Binary execution trace. Each record is a flags byte followed only by what can't be predicted:
+     * PC as a delta from the sequential one, instruction word unless a small direct-mapped cache of the
+     * previous words at that PC matches, changed registers XORed with their last value and memory
+     * addresses as deltas from the previous access, all as LEB128 varints. Decoding replays the same
+     * state, so a trace is only readable from its start.
+     */
+    class ExecutionTraceFormat
+    {
+    protected:
+        static constexpr std::array<char, 4> MAGIC = { 'F', 'T', 'R', 'C' };
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t INSTRUCTION_CACHE_SIZE = 4096;
+
+        enum RecordFlags : uint8_t
+        {
+            PC_NOT_SEQUENTIAL = 1 << 0,
+            NEW_INSTRUCTION_WORD = 1 << 1,
+            HAS_REGISTER_CHANGES = 1 << 2,
+            HAS_MEMORY_ACCESSES = 1 << 3,
+        };
+
+        struct CachedInstruction
+        {
+            uint32_t pc;
+            uint32_t instruction;
+        };
+
+        void resetState(uint32_t initialPc, const std::array<uint32_t, TRACE_REGISTERS_COUNT>& initialRegisters);
+        inline static size_t getCacheIndex(uint32_t pc) { return (pc >> 2) & (INSTRUCTION_CACHE_SIZE - 1); }
+
+        uint32_t expectedPc = 0;
+        uint32_t lastAccessAddress = 0;
+        std::array<uint32_t, TRACE_REGISTERS_COUNT> registers{};
+        std::vector<CachedInstruction> instructionCache;
+    };
+
+    class ExecutionTraceWriter : protected ExecutionTraceFormat
+    {
+    public:
+        ~ExecutionTraceWriter();
+
+        bool start(const std::filesystem::path& path, uint32_t pc, const std::array<uint32_t, TRACE_REGISTERS_COUNT>& currentRegisters);
+        void stop();
+        inline bool isRecording() const { return recording; }
+
+        /** @brief Drops the accesses made before the instruction is executed (its fetch) */
+        inline void beginInstruction() { pendingAccesses.clear(); }
+
+        inline void onMemoryAccess(TraceAccessType type, uint8_t size, uint32_t address, uint32_t value)
+        {
+            pendingAccesses.push_back({ type, size, address, value });
+        }
+
+        void endInstruction(uint32_t pc, uint32_t instruction, const std::array<uint32_t, TRACE_REGISTERS_COUNT>& currentRegisters);
+
+        inline uint64_t getRecordsCount() const { return recordsCount; }
+
+    private:
+        void writeVarint(uint32_t value);
+        void flush();
+
+    private:
+        bool recording = false;
+        std::ofstream fileStream;
+        std::vector<uint8_t> buffer;
+        std::vector<TraceMemoryAccess> pendingAccesses;
+        uint64_t recordsCount = 0;
+    };
+
+    class ExecutionTraceReader : protected ExecutionTraceFormat
+    {
+    public:
+        bool open(const std::filesystem::path& path);
+        /** @brief False at the end of the trace or if it's truncated/corrupted (see hasError) */
+        bool next(TraceRecord& record);
+        inline bool hasError() const { return error; }
+
+        /** @brief Register file after the last record read (GPRs, HI, LO) */
+        inline const std::array<uint32_t, TRACE_REGISTERS_COUNT>& getRegisters() const { return registers; }
+
+    private:
+        bool readByte(uint8_t& value);
+        bool readVarint(uint32_t& value);
+        bool readWord(uint32_t& value);
+
+    private:
+        std::ifstream fileStream;
+        bool error = false;
+    };
+
+    /** @brief One line of text, e.g. "80010000: 24420001  v0=00000004  W32[1F801070]=00000000" */
+    std::string formatTraceRecord(const TraceRecord& record);
+};
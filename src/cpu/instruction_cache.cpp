@@ -0,0 +1,91 @@
+#include "instruction_cache.hpp"
+#include "savestate/state_serializer.hpp"
+
+#include <bit>
+
+festation::InstructionCache::InstructionCache()
+{
+    reset();
+}
+
+void festation::InstructionCache::reset()
+{
+    lines.fill(0);
+}
+
+uint32_t festation::InstructionCache::fetchBlock(uint32_t startAddress, uint32_t endAddress)
+{
+    const uint32_t physicalStart = startAddress & PHYSICAL_MEMORY_MASK;
+    const uint32_t physicalEnd = endAddress & PHYSICAL_MEMORY_MASK;
+    uint32_t cycles = 0;
+
+    for (uint32_t lineAddress = physicalStart & ~(ICACHE_LINE_SIZE - 1); lineAddress <= physicalEnd; lineAddress += ICACHE_LINE_SIZE)
+    {
+        const uint32_t firstWord = (lineAddress < physicalStart) ? getWordIndex(physicalStart) : 0;
+        const uint32_t lastWord = (lineAddress + ICACHE_LINE_SIZE > physicalEnd) ? getWordIndex(physicalEnd) : ICACHE_WORDS_PER_LINE - 1;
+        const uint32_t neededWords = getWordsMask(firstWord, lastWord);
+        const uint32_t line = lines[getLineIndex(lineAddress)];
+
+        const uint32_t validWords = ((line & TAG_MASK) == (lineAddress & TAG_MASK)) ? (line & VALID_WORDS_MASK) : 0;
+        const uint32_t missingWords = neededWords & ~validWords;
+
+        // The first miss fills the rest of the line, so there's at most one per line
+        if (missingWords != 0)
+            cycles += fillLine(lineAddress + std::countr_zero(missingWords) * sizeof(uint32_t));
+    }
+
+    return cycles;
+}
+
+bool festation::InstructionCache::isBlockCached(uint32_t startAddress, uint32_t endAddress) const
+{
+    const uint32_t physicalStart = startAddress & PHYSICAL_MEMORY_MASK;
+    const uint32_t physicalEnd = endAddress & PHYSICAL_MEMORY_MASK;
+
+    for (uint32_t lineAddress = physicalStart & ~(ICACHE_LINE_SIZE - 1); lineAddress <= physicalEnd; lineAddress += ICACHE_LINE_SIZE)
+    {
+        const uint32_t firstWord = (lineAddress < physicalStart) ? getWordIndex(physicalStart) : 0;
+        const uint32_t lastWord = (lineAddress + ICACHE_LINE_SIZE > physicalEnd) ? getWordIndex(physicalEnd) : ICACHE_WORDS_PER_LINE - 1;
+        const uint32_t neededWords = getWordsMask(firstWord, lastWord);
+        const uint32_t line = lines[getLineIndex(lineAddress)];
+
+        if ((line & TAG_MASK) != (lineAddress & TAG_MASK) || (line & neededWords) != neededWords)
+            return false;
+    }
+
+    return true;
+}
+
+void festation::InstructionCache::writeIsolated(uint32_t address, bool isTagTestMode)
+{
+    // Outside tag test mode the store goes to the cached code, which isn't kept here
+    if (!isTagTestMode)
+        return;
+
+    // The BIOS flushes the cache writing zero (all words invalid) to the tag of every line
+    const uint32_t physicalAddress = address & PHYSICAL_MEMORY_MASK;
+    lines[getLineIndex(physicalAddress)] = physicalAddress & TAG_MASK;
+}
+
+void festation::InstructionCache::serialize(StateSerializer& serializer)
+{
+    uint32_t version = 1;
+
+    if (!serializer.beginSection(makeSectionTag("ICAC"), version))
+        return;
+
+    serializer.doArray(lines);
+    serializer.endSection();
+}
+
+uint32_t festation::InstructionCache::fillLine(uint32_t physicalAddress)
+{
+    const uint32_t firstWord = getWordIndex(physicalAddress);
+    uint32_t& line = lines[getLineIndex(physicalAddress)];
+
+    // A line holds a single tag, filling it for another address drops the words it had
+    const uint32_t keptWords = ((line & TAG_MASK) == (physicalAddress & TAG_MASK)) ? (line & VALID_WORDS_MASK) : 0;
+    line = (physicalAddress & TAG_MASK) | keptWords | getWordsMask(firstWord, ICACHE_WORDS_PER_LINE - 1);
+
+    return getICacheFillCycles(physicalAddress, ICACHE_WORDS_PER_LINE - firstWord);
+}
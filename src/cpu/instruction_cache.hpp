@@ -0,0 +1,72 @@
+#pragma once
+
+#include "instruction_timing.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+namespace festation
+{
+    class StateSerializer;
+
+    static constexpr size_t ICACHE_LINES_COUNT = 256;
+    static constexpr size_t ICACHE_LINE_SIZE = 16;
+    static constexpr size_t ICACHE_WORDS_PER_LINE = ICACHE_LINE_SIZE / sizeof(uint32_t);
+
+    /**
+     * @brief 4KB direct mapped instruction cache, only its tags are emulated (code is always read from
+     * memory) to know which fetches stall. Every line is one word: the tag (physical address bits 12-28)
+     * with the valid bit of each of its 4 words in the low bits, so a lookup is a single load and compare
+     * out of a 1KB array. A miss fills the line from the missed word to its end, as the R3000A does.
+     */
+    class InstructionCache
+    {
+    public:
+        InstructionCache();
+
+        void reset();
+
+        /** @brief Stall cycles of fetching the instruction at address, filling the line on a miss */
+        inline uint32_t fetch(uint32_t address)
+        {
+            const uint32_t physicalAddress = address & PHYSICAL_MEMORY_MASK;
+            const uint32_t line = lines[getLineIndex(physicalAddress)];
+
+            if ((line & TAG_MASK) == (physicalAddress & TAG_MASK) && (line & getWordBit(physicalAddress))) [[likely]]
+                return ICACHE_HIT_CYCLES;
+
+            return fillLine(physicalAddress);
+        }
+
+        /**
+         * @brief Stall cycles of running the straight-line code in [startAddress, endAddress] once, as fetch()
+         * on each instruction would, with one lookup per line. Meant for block based backends (cached
+         * interpreter, JIT) to account for the whole block at its entry.
+         */
+        uint32_t fetchBlock(uint32_t startAddress, uint32_t endAddress);
+        /** @brief True if running the block wouldn't miss, the cache isn't modified */
+        bool isBlockCached(uint32_t startAddress, uint32_t endAddress) const;
+
+        /** @brief Store with the cache isolated (SR.IsC), in tag test mode it invalidates the line */
+        void writeIsolated(uint32_t address, bool isTagTestMode);
+
+        void serialize(StateSerializer& serializer);
+
+    private:
+        static constexpr uint32_t TAG_MASK = ~static_cast<uint32_t>(ICACHE_LINES_COUNT * ICACHE_LINE_SIZE - 1);
+        static constexpr uint32_t VALID_WORDS_MASK = (1 << ICACHE_WORDS_PER_LINE) - 1;
+
+        inline static size_t getLineIndex(uint32_t physicalAddress) { return (physicalAddress / ICACHE_LINE_SIZE) & (ICACHE_LINES_COUNT - 1); }
+        inline static uint32_t getWordIndex(uint32_t physicalAddress) { return (physicalAddress >> 2) & (ICACHE_WORDS_PER_LINE - 1); }
+        inline static uint32_t getWordBit(uint32_t physicalAddress) { return 1 << getWordIndex(physicalAddress); }
+        /** @brief Valid bits of words [firstWord, lastWord] */
+        inline static uint32_t getWordsMask(uint32_t firstWord, uint32_t lastWord) { return (VALID_WORDS_MASK >> (ICACHE_WORDS_PER_LINE - 1 - lastWord)) & ~((1u << firstWord) - 1); }
+
+        /** @brief Loads the line from the missed word to its end, returns the stall cycles */
+        uint32_t fillLine(uint32_t physicalAddress);
+
+    private:
+        std::array<uint32_t, ICACHE_LINES_COUNT> lines;
+    };
+};
@@ -0,0 +1,70 @@
+#include "instruction_dispatch.hpp"
+#include "psx_cw33300_cpu.hpp"
+#include "exceptions_handling.hpp"
+#include "utils/logger.hpp"
+
+void festation::executeSpecial(MIPS_R3000A_Core& cpu, uint32_t instruction)
+{
+    SPECIAL_INSTRUCTIONS[getInstFunctionOperation(instruction)].handler(cpu, instruction);
+}
+
+void festation::executeRegImm(MIPS_R3000A_Core& cpu, uint32_t instruction)
+{
+    REGIMM_INSTRUCTIONS[getRegImmIndex(instruction)].handler(cpu, instruction);
+}
+
+void festation::executeCop0(MIPS_R3000A_Core& cpu, uint32_t instruction)
+{
+    reg_t rs = getInstSrcRegEncoding<EncodingType::IMMEDIATE, SrcRegs::RS>(instruction);
+
+    if (rs == 0b10000)
+    {
+        // We don't check last 6 bits because PS1 CPU doesn't have TLB
+        rfe(cpu);
+        return;
+    }
+
+    reg_t rtcop0 = getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RT>(instruction);
+    reg_t rdcop0 = getInstDestRegEncoding<EncodingType::REGISTER>(instruction);
+
+    switch (rs) // We don't need to check for more opcodes on COP0
+    {
+    case 0b00000:
+        mfc0(cpu, rtcop0, rdcop0);
+        break;
+    case 0b00100:
+        mtc0(cpu, rtcop0, rdcop0);
+        break;
+    default:
+        executeReserved(cpu, instruction);
+        break;
+    }
+}
+
+void festation::executeCop2(MIPS_R3000A_Core&, uint32_t instruction)
+{
+    LOG_ERROR("Unimplemented GTE command ({:02}h) from ({:08X})", getInstOpcode(instruction), instruction);
+}
+
+void festation::executeLwc2(MIPS_R3000A_Core&, uint32_t instruction)
+{
+    LOG_ERROR("Unimplemented GTE command: lwc2 {:02x}, [{:02x}+{:02x}]", getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction),
+        getInstSrcRegEncoding<EncodingType::IMMEDIATE, SrcRegs::RS>(instruction), getInstImmediate(instruction));
+}
+
+void festation::executeSwc2(MIPS_R3000A_Core&, uint32_t instruction)
+{
+    LOG_ERROR("Unimplemented GTE command: swc2 {:02x}, [{:02x}+{:02x}]", getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction),
+        getInstSrcRegEncoding<EncodingType::IMMEDIATE, SrcRegs::RS>(instruction), getInstImmediate(instruction));
+}
+
+void festation::executeMissingCoprocessor(MIPS_R3000A_Core& cpu, uint32_t)
+{
+    handleException(cpu, ExcCode_CpU);
+}
+
+void festation::executeReserved(MIPS_R3000A_Core& cpu, uint32_t instruction)
+{
+    LOG_WARN("Reserved instruction {:08X} at {:08X}", instruction, cpu.getCPURegs().currentPC);
+    handleException(cpu, ExcCode_RI);
+}
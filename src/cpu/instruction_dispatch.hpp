@@ -0,0 +1,265 @@
+#pragma once
+#include "cpu_masks_types_utils.hpp"
+#include "mips_r3000a_opcodes.hpp"
+#include "coprocessor_cp0_opcodes.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <string_view>
+
+namespace festation
+{
+    class MIPS_R3000A_Core;
+
+    /** @brief Fields an instruction reads from its encoding, in the order its handler takes them */
+    enum class OperandFormat : uint8_t
+    {
+        None,
+        RdRtShift,      // sll rd, rt, shift
+        RdRtRs,         // sllv rd, rt, rs
+        RdRsRt,         // add rd, rs, rt
+        RsRt,           // mult rs, rt
+        RsRd,           // jalr rs, rd
+        Rs,             // jr rs
+        Rd,             // mfhi rd
+        Code,           // syscall code
+        Target,         // j target
+        RtRsImm,        // addi rt, rs, imm / lw rt, imm(rs)
+        RsRtOffset,     // beq rs, rt, offset
+        RsOffset,       // blez rs, offset
+        RtImm,          // lui rt, imm
+        Group,          // Further decoded by its own table/fields (SPECIAL, REGIMM, COPn)
+    };
+
+    using InstructionHandler = void (*)(MIPS_R3000A_Core& cpu, uint32_t instruction);
+
+    struct InstructionDescriptor
+    {
+        InstructionHandler handler;
+        std::string_view mnemonic;
+        OperandFormat format;
+    };
+
+    static constexpr size_t INSTRUCTION_TABLE_SIZE = 64;
+    static constexpr size_t REGIMM_TABLE_SIZE = 4;
+    using InstructionTable = std::array<InstructionDescriptor, INSTRUCTION_TABLE_SIZE>;
+
+    // Handlers adapting the encoding to an opcode implementation, only the fields it uses are extracted
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, reg_t, shift_t)>
+    void executeRdRtShift(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstDestRegEncoding<EncodingType::REGISTER>(instruction),
+            getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RT>(instruction), getInstShiftAmount(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, reg_t, reg_t)>
+    void executeRdRtRs(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstDestRegEncoding<EncodingType::REGISTER>(instruction),
+            getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RT>(instruction), getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RS>(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, reg_t, reg_t)>
+    void executeRdRsRt(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstDestRegEncoding<EncodingType::REGISTER>(instruction),
+            getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RS>(instruction), getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RT>(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, reg_t)>
+    void executeRsRt(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RS>(instruction),
+            getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RT>(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, reg_t)>
+    void executeRsRd(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RS>(instruction),
+            getInstDestRegEncoding<EncodingType::REGISTER>(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t)>
+    void executeRs(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RS>(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t)>
+    void executeRd(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstDestRegEncoding<EncodingType::REGISTER>(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, syscall_break_code_t)>
+    void executeCode(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getSyscallBreakCode(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, j_immed26_t)>
+    void executeTarget(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstAddress(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, reg_t, immed16_t)>
+    void executeRtRsImm(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction),
+            getInstSrcRegEncoding<EncodingType::IMMEDIATE, SrcRegs::RS>(instruction), getInstImmediate(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, reg_t, immed16_t)>
+    void executeRsRtOffset(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstSrcRegEncoding<EncodingType::IMMEDIATE, SrcRegs::RS>(instruction),
+            getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction), getInstImmediate(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, immed16_t)>
+    void executeRsOffset(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstSrcRegEncoding<EncodingType::IMMEDIATE, SrcRegs::RS>(instruction), getInstImmediate(instruction));
+    }
+
+    template<void (*OPERATION)(MIPS_R3000A_Core&, reg_t, immed16_t)>
+    void executeRtImm(MIPS_R3000A_Core& cpu, uint32_t instruction)
+    {
+        OPERATION(cpu, getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction), getInstImmediate(instruction));
+    }
+
+    // Handlers of encodings without a single opcode implementation behind (instruction_dispatch.cpp)
+
+    void executeSpecial(MIPS_R3000A_Core& cpu, uint32_t instruction);
+    void executeRegImm(MIPS_R3000A_Core& cpu, uint32_t instruction);
+    void executeCop0(MIPS_R3000A_Core& cpu, uint32_t instruction);
+    void executeCop2(MIPS_R3000A_Core& cpu, uint32_t instruction);
+    void executeLwc2(MIPS_R3000A_Core& cpu, uint32_t instruction);
+    void executeSwc2(MIPS_R3000A_Core& cpu, uint32_t instruction);
+    /** @brief COP1/COP3 don't exist on the PS1 (Coprocessor Unusable exception) */
+    void executeMissingCoprocessor(MIPS_R3000A_Core& cpu, uint32_t instruction);
+    /** @brief Encodings not defined by the R3000A (Reserved Instruction exception) */
+    void executeReserved(MIPS_R3000A_Core& cpu, uint32_t instruction);
+
+    /** @brief Indexed by primary opcode, entry 0 (SPECIAL) goes on through SPECIAL_INSTRUCTIONS */
+    static constexpr InstructionTable PRIMARY_INSTRUCTIONS = [] {
+        InstructionTable table{};
+        table.fill({ executeReserved, "", OperandFormat::None });
+
+        table[0x00] = { executeSpecial, "special", OperandFormat::Group };
+        table[0x01] = { executeRegImm, "bcondz", OperandFormat::Group };
+        table[0x02] = { executeTarget<j>, "j", OperandFormat::Target };
+        table[0x03] = { executeTarget<jal>, "jal", OperandFormat::Target };
+        table[0x04] = { executeRsRtOffset<beq>, "beq", OperandFormat::RsRtOffset };
+        table[0x05] = { executeRsRtOffset<bne>, "bne", OperandFormat::RsRtOffset };
+        table[0x06] = { executeRsOffset<blez>, "blez", OperandFormat::RsOffset };
+        table[0x07] = { executeRsOffset<bgtz>, "bgtz", OperandFormat::RsOffset };
+        table[0x08] = { executeRtRsImm<addi>, "addi", OperandFormat::RtRsImm };
+        table[0x09] = { executeRtRsImm<addiu>, "addiu", OperandFormat::RtRsImm };
+        table[0x0A] = { executeRtRsImm<slti>, "slti", OperandFormat::RtRsImm };
+        table[0x0B] = { executeRtRsImm<sltiu>, "sltiu", OperandFormat::RtRsImm };
+        table[0x0C] = { executeRtRsImm<andi>, "andi", OperandFormat::RtRsImm };
+        table[0x0D] = { executeRtRsImm<ori>, "ori", OperandFormat::RtRsImm };
+        table[0x0E] = { executeRtRsImm<xori>, "xori", OperandFormat::RtRsImm };
+        table[0x0F] = { executeRtImm<lui>, "lui", OperandFormat::RtImm };
+        table[0x10] = { executeCop0, "cop0", OperandFormat::Group };
+        table[0x11] = { executeMissingCoprocessor, "cop1", OperandFormat::Group };
+        table[0x12] = { executeCop2, "cop2", OperandFormat::Group };
+        table[0x13] = { executeMissingCoprocessor, "cop3", OperandFormat::Group };
+        table[0x20] = { executeRtRsImm<lb>, "lb", OperandFormat::RtRsImm };
+        table[0x21] = { executeRtRsImm<lh>, "lh", OperandFormat::RtRsImm };
+        table[0x22] = { executeRtRsImm<lwl>, "lwl", OperandFormat::RtRsImm };
+        table[0x23] = { executeRtRsImm<lw>, "lw", OperandFormat::RtRsImm };
+        table[0x24] = { executeRtRsImm<lbu>, "lbu", OperandFormat::RtRsImm };
+        table[0x25] = { executeRtRsImm<lhu>, "lhu", OperandFormat::RtRsImm };
+        table[0x26] = { executeRtRsImm<lwr>, "lwr", OperandFormat::RtRsImm };
+        table[0x28] = { executeRtRsImm<sb>, "sb", OperandFormat::RtRsImm };
+        table[0x29] = { executeRtRsImm<sh>, "sh", OperandFormat::RtRsImm };
+        table[0x2A] = { executeRtRsImm<swl>, "swl", OperandFormat::RtRsImm };
+        table[0x2B] = { executeRtRsImm<sw>, "sw", OperandFormat::RtRsImm };
+        table[0x2E] = { executeRtRsImm<swr>, "swr", OperandFormat::RtRsImm };
+        table[0x30] = { executeRtRsImm<lwc0>, "lwc0", OperandFormat::RtRsImm };
+        table[0x31] = { executeMissingCoprocessor, "lwc1", OperandFormat::RtRsImm };
+        table[0x32] = { executeLwc2, "lwc2", OperandFormat::RtRsImm };
+        table[0x33] = { executeMissingCoprocessor, "lwc3", OperandFormat::RtRsImm };
+        table[0x38] = { executeRtRsImm<swc0>, "swc0", OperandFormat::RtRsImm };
+        table[0x39] = { executeMissingCoprocessor, "swc1", OperandFormat::RtRsImm };
+        table[0x3A] = { executeSwc2, "swc2", OperandFormat::RtRsImm };
+        table[0x3B] = { executeMissingCoprocessor, "swc3", OperandFormat::RtRsImm };
+
+        return table;
+    }();
+
+    /** @brief Indexed by the function field of SPECIAL (opcode 0) instructions */
+    static constexpr InstructionTable SPECIAL_INSTRUCTIONS = [] {
+        InstructionTable table{};
+        table.fill({ executeReserved, "", OperandFormat::None });
+
+        table[0x00] = { executeRdRtShift<sll>, "sll", OperandFormat::RdRtShift };
+        table[0x02] = { executeRdRtShift<srl>, "srl", OperandFormat::RdRtShift };
+        table[0x03] = { executeRdRtShift<sra>, "sra", OperandFormat::RdRtShift };
+        table[0x04] = { executeRdRtRs<sllv>, "sllv", OperandFormat::RdRtRs };
+        table[0x06] = { executeRdRtRs<srlv>, "srlv", OperandFormat::RdRtRs };
+        table[0x07] = { executeRdRtRs<srav>, "srav", OperandFormat::RdRtRs };
+        table[0x08] = { executeRs<jr>, "jr", OperandFormat::Rs };
+        table[0x09] = { executeRsRd<jalr>, "jalr", OperandFormat::RsRd };
+        table[0x0C] = { executeCode<syscall>, "syscall", OperandFormat::Code };
+        table[0x0D] = { executeCode<_break>, "break", OperandFormat::Code };
+        table[0x10] = { executeRd<mfhi>, "mfhi", OperandFormat::Rd };
+        table[0x11] = { executeRs<mthi>, "mthi", OperandFormat::Rs };
+        table[0x12] = { executeRd<mflo>, "mflo", OperandFormat::Rd };
+        table[0x13] = { executeRs<mtlo>, "mtlo", OperandFormat::Rs };
+        table[0x18] = { executeRsRt<mult>, "mult", OperandFormat::RsRt };
+        table[0x19] = { executeRsRt<multu>, "multu", OperandFormat::RsRt };
+        table[0x1A] = { executeRsRt<div>, "div", OperandFormat::RsRt };
+        table[0x1B] = { executeRsRt<divu>, "divu", OperandFormat::RsRt };
+        table[0x20] = { executeRdRsRt<add>, "add", OperandFormat::RdRsRt };
+        table[0x21] = { executeRdRsRt<addu>, "addu", OperandFormat::RdRsRt };
+        table[0x22] = { executeRdRsRt<sub>, "sub", OperandFormat::RdRsRt };
+        table[0x23] = { executeRdRsRt<subu>, "subu", OperandFormat::RdRsRt };
+        table[0x24] = { executeRdRsRt<_and>, "and", OperandFormat::RdRsRt };
+        table[0x25] = { executeRdRsRt<_or>, "or", OperandFormat::RdRsRt };
+        table[0x26] = { executeRdRsRt<_xor>, "xor", OperandFormat::RdRsRt };
+        table[0x27] = { executeRdRsRt<nor>, "nor", OperandFormat::RdRsRt };
+        table[0x2A] = { executeRdRsRt<slt>, "slt", OperandFormat::RdRsRt };
+        table[0x2B] = { executeRdRsRt<sltu>, "sltu", OperandFormat::RdRsRt };
+
+        return table;
+    }();
+
+    /** @brief BcondZ variants, indexed by getRegImmIndex() */
+    static constexpr std::array<InstructionDescriptor, REGIMM_TABLE_SIZE> REGIMM_INSTRUCTIONS = {{
+        { executeRsOffset<bltz>, "bltz", OperandFormat::RsOffset },
+        { executeRsOffset<bgez>, "bgez", OperandFormat::RsOffset },
+        { executeRsOffset<bltzal>, "bltzal", OperandFormat::RsOffset },
+        { executeRsOffset<bgezal>, "bgezal", OperandFormat::RsOffset },
+    }};
+
+    /** @brief rt bit 0 selects ltz/gez and rt bits 1-4 being 8 (rt 10h/11h) links, other rt values don't */
+    static inline constexpr size_t getRegImmIndex(uint32_t instruction)
+    {
+        const reg_t rt = getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction);
+        const bool ezBit = (rt & 0x01) == 0x01;
+        const bool linkBit = ((rt >> 1) & 0x0F) == 0x08;
+
+        return (ezBit ? 1 : 0) + (linkBit ? 2 : 0);
+    }
+
+    /** @brief Entry the instruction is executed by, SPECIAL and REGIMM resolved */
+    static inline constexpr const InstructionDescriptor& getInstructionDescriptor(uint32_t instruction)
+    {
+        const uint8_t opcode = getInstOpcode(instruction);
+
+        if (opcode == 0x00)
+            return SPECIAL_INSTRUCTIONS[getInstFunctionOperation(instruction)];
+
+        if (opcode == 0x01)
+            return REGIMM_INSTRUCTIONS[getRegImmIndex(instruction)];
+
+        return PRIMARY_INSTRUCTIONS[opcode];
+    }
+};
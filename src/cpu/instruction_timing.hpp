@@ -0,0 +1,201 @@
+#pragma once
+
+#include "cpu_masks_types_utils.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <bit>
+
+#include "memory/memory_map_masks.hpp"
+
+namespace festation
+{
+    /** @brief What an instruction may have to wait for on top of its base cycles */
+    enum class InstructionTimingClass : uint8_t
+    {
+        Simple,
+        MultiplySigned,     // Starts the multiplier, HI/LO are busy until it's done
+        MultiplyUnsigned,
+        Divide,
+        MoveFromHiLo,       // Interlocks until the multiplier/divider result is ready
+    };
+
+    struct InstructionTiming
+    {
+        uint8_t baseCycles;
+        InstructionTimingClass timingClass;
+    };
+
+    static constexpr size_t OPCODE_TIMINGS_COUNT = 64;
+    using OpcodeTimingTable = std::array<InstructionTiming, OPCODE_TIMINGS_COUNT>;
+
+    /** @brief Indexed by primary opcode, SPECIAL (opcode 0) instructions use SPECIAL_OPCODE_TIMINGS */
+    static constexpr OpcodeTimingTable PRIMARY_OPCODE_TIMINGS = [] {
+        OpcodeTimingTable table{};
+        table.fill({ 1, InstructionTimingClass::Simple });
+        return table;
+    }();
+
+    /** @brief Indexed by function field of SPECIAL instructions */
+    static constexpr OpcodeTimingTable SPECIAL_OPCODE_TIMINGS = [] {
+        OpcodeTimingTable table{};
+        table.fill({ 1, InstructionTimingClass::Simple });
+
+        table[0x10] = { 1, InstructionTimingClass::MoveFromHiLo };      // mfhi
+        table[0x12] = { 1, InstructionTimingClass::MoveFromHiLo };      // mflo
+        table[0x18] = { 1, InstructionTimingClass::MultiplySigned };    // mult
+        table[0x19] = { 1, InstructionTimingClass::MultiplyUnsigned };  // multu
+        table[0x1A] = { 1, InstructionTimingClass::Divide };            // div
+        table[0x1B] = { 1, InstructionTimingClass::Divide };            // divu
+
+        return table;
+    }();
+
+    static constexpr uint32_t DIVIDE_LATENCY_CYCLES = 36;
+
+    /** @brief The multiplier ends early when rs has few significant bits, 6/9/13 cycles (psx-spx) */
+    constexpr uint32_t getMultiplyLatency(uint32_t rsValue, bool isSigned)
+    {
+        // Negative values are as fast as their one's complement
+        uint32_t magnitude = (isSigned && (rsValue & 0x80000000)) ? ~rsValue : rsValue;
+
+        if (magnitude < 0x800)
+            return 6;
+
+        if (magnitude < 0x100000)
+            return 9;
+
+        return 13;
+    }
+
+    enum class MemoryTimingRegion : uint8_t
+    {
+        Internal,       // Cache control and unmapped addresses, no bus access
+        MainRAM,
+        Scratchpad,
+        BiosROM,
+        Expansion1,
+        Expansion2,
+        Expansion3,
+        IoPorts,
+        Cdrom,
+        Spu,
+        Count
+    };
+
+    /** @brief Stall cycles of a CPU read per access size (8, 16, 32 bits) */
+    struct MemoryRegionTiming
+    {
+        std::array<uint8_t, 3> readCycles;
+    };
+
+    /**
+     * @brief Read stalls with the memory control delays the BIOS sets up. 8 and 16 bits devices take one
+     * bus access per byte/halfword of a wider read. Writes go through the CPU write buffer and don't stall.
+     */
+    static constexpr std::array<MemoryRegionTiming, static_cast<size_t>(MemoryTimingRegion::Count)> MEMORY_REGION_TIMINGS = {{
+        { { 0, 0, 0 } },        // Internal
+        { { 4, 4, 4 } },        // MainRAM
+        { { 0, 0, 0 } },        // Scratchpad
+        { { 6, 12, 24 } },      // BiosROM (8 bits)
+        { { 6, 12, 24 } },      // Expansion1 (8 bits)
+        { { 10, 20, 40 } },     // Expansion2 (8 bits)
+        { { 5, 5, 10 } },       // Expansion3 (16 bits)
+        { { 2, 2, 2 } },        // IoPorts
+        { { 8, 16, 32 } },      // Cdrom (8 bits)
+        { { 17, 17, 36 } },     // Spu (16 bits)
+    }};
+
+    static constexpr uint32_t MEMORY_TIMING_PAGE_SHIFT = 20;  // 1MB pages of the physical address space
+    static constexpr size_t MEMORY_TIMING_PAGES_COUNT = (PHYSICAL_MEMORY_MASK >> MEMORY_TIMING_PAGE_SHIFT) + 1;
+    static constexpr uint32_t IO_TIMING_BLOCK_SHIFT = 4;       // 16 bytes blocks of the I/O ports
+    static constexpr size_t IO_TIMING_BLOCKS_COUNT = IO_PORTS_SIZE >> IO_TIMING_BLOCK_SHIFT;
+
+    /** @brief Region of every 1MB page, the one shared by scratchpad, I/O ports and expansion 2 is resolved apart */
+    static constexpr std::array<MemoryTimingRegion, MEMORY_TIMING_PAGES_COUNT> MEMORY_TIMING_PAGES = [] {
+        std::array<MemoryTimingRegion, MEMORY_TIMING_PAGES_COUNT> pages{};
+        pages.fill(MemoryTimingRegion::Internal);
+
+        auto fillRange = [&pages](uint32_t start, uint32_t end, MemoryTimingRegion region) {
+            for (uint32_t page = start >> MEMORY_TIMING_PAGE_SHIFT; page <= (end >> MEMORY_TIMING_PAGE_SHIFT); page++)
+                pages[page] = region;
+        };
+
+        fillRange(MAIN_RAM_START, MAIN_RAM_END, MemoryTimingRegion::MainRAM);
+        fillRange(EXPANSION_REGION1_START, EXPANSION_REGION1_END, MemoryTimingRegion::Expansion1);
+        fillRange(SCRATCHPAD_START, EXPANSION_REGION2_END, MemoryTimingRegion::Scratchpad);
+        fillRange(EXPANSION_REGION3_START, EXPANSION_REGION3_END, MemoryTimingRegion::Expansion3);
+        fillRange(BIOS_ROM_START, BIOS_ROM_END, MemoryTimingRegion::BiosROM);
+
+        return pages;
+    }();
+
+    /** @brief Devices behind the I/O ports with their own bus delays, the rest answer at I/O speed */
+    static constexpr std::array<MemoryTimingRegion, IO_TIMING_BLOCKS_COUNT> IO_TIMING_BLOCKS = [] {
+        std::array<MemoryTimingRegion, IO_TIMING_BLOCKS_COUNT> blocks{};
+        blocks.fill(MemoryTimingRegion::IoPorts);
+
+        blocks[0x800 >> IO_TIMING_BLOCK_SHIFT] = MemoryTimingRegion::Cdrom;    // 1F801800h-1F801803h
+
+        for (size_t block = 0xC00 >> IO_TIMING_BLOCK_SHIFT; block < IO_TIMING_BLOCKS_COUNT; block++)
+            blocks[block] = MemoryTimingRegion::Spu;                            // 1F801C00h-1F801FFFh
+
+        return blocks;
+    }();
+
+    constexpr MemoryTimingRegion getMemoryTimingRegion(uint32_t address)
+    {
+        uint32_t physicalAddress = address & PHYSICAL_MEMORY_MASK;
+        MemoryTimingRegion region = MEMORY_TIMING_PAGES[physicalAddress >> MEMORY_TIMING_PAGE_SHIFT];
+
+        if (region != MemoryTimingRegion::Scratchpad)
+            return region;
+
+        if (physicalAddress <= SCRATCHPAD_END)
+            return MemoryTimingRegion::Scratchpad;
+
+        if (physicalAddress >= IO_PORTS_START && physicalAddress <= IO_PORTS_END)
+            return IO_TIMING_BLOCKS[(physicalAddress & IO_PORTS_SIZE_MASK) >> IO_TIMING_BLOCK_SHIFT];
+
+        if (physicalAddress >= EXPANSION_REGION2_START && physicalAddress <= EXPANSION_REGION2_END)
+            return MemoryTimingRegion::Expansion2;
+
+        return MemoryTimingRegion::Internal;
+    }
+
+    /** @brief Size in bytes (1, 2 or 4) */
+    constexpr uint32_t getMemoryReadCycles(uint32_t address, uint32_t size)
+    {
+        const MemoryRegionTiming& timing = MEMORY_REGION_TIMINGS[static_cast<size_t>(getMemoryTimingRegion(address))];
+        return timing.readCycles[std::countr_zero(size)];
+    }
+
+    /** @brief KUSEG and KSEG0 go through the instruction cache (when enabled), KSEG1 always reads memory */
+    constexpr bool isCachedAddress(uint32_t address)
+    {
+        return address < 0xA0000000;
+    }
+
+    static constexpr uint32_t ICACHE_HIT_CYCLES = 0;
+
+    /** @brief Stall of an instruction fetch that can't be served by the instruction cache */
+    constexpr uint32_t getUncachedFetchCycles(uint32_t address)
+    {
+        return getMemoryReadCycles(address, sizeof(uint32_t));
+    }
+
+    /** @brief Stall of an instruction cache miss, the first word is a full read and the rest come in a burst */
+    constexpr uint32_t getICacheFillCycles(uint32_t address, uint32_t wordsCount)
+    {
+        return getUncachedFetchCycles(address) + (wordsCount - 1);
+    }
+
+    static_assert(getMemoryTimingRegion(0x80010000) == MemoryTimingRegion::MainRAM);
+    static_assert(getMemoryTimingRegion(0xBFC00000) == MemoryTimingRegion::BiosROM);
+    static_assert(getMemoryTimingRegion(0x1F8003FC) == MemoryTimingRegion::Scratchpad);
+    static_assert(getMemoryTimingRegion(0x1F801070) == MemoryTimingRegion::IoPorts);
+    static_assert(getMemoryTimingRegion(0x1F801801) == MemoryTimingRegion::Cdrom);
+    static_assert(getMemoryTimingRegion(0x1F801DAA) == MemoryTimingRegion::Spu);
+    static_assert(getMemoryTimingRegion(0xFFFE0130) == MemoryTimingRegion::Internal);
+};
@@ -0,0 +1,33 @@
+#include "pc_hooks.hpp"
+
+#include <algorithm>
+
+festation::PcHookId festation::PcHooks::add(uint32_t address, PcHook hook)
+{
+    const uint32_t physicalAddress = address & PHYSICAL_ADDRESS_MASK;
+    const PcHookId id = nextId++;
+
+    hooks.push_back({ id, physicalAddress, std::move(hook) });
+    hookedPages.set(physicalAddress >> HOOK_PAGE_SHIFT);
+
+    return id;
+}
+
+void festation::PcHooks::remove(PcHookId id)
+{
+    std::erase_if(hooks, [id](const HookEntry& entry) { return entry.id == id; });
+
+    hookedPages.reset();
+
+    for (const HookEntry& entry : hooks) {
+        hookedPages.set(entry.physicalAddress >> HOOK_PAGE_SHIFT);
+    }
+}
+
+void festation::PcHooks::dispatch(uint32_t physicalAddress)
+{
+    for (size_t i = 0; i < hooks.size(); i++) {
+        if (hooks[i].physicalAddress == physicalAddress && hooks[i].hook(physicalAddress))
+            return;
+    }
+}
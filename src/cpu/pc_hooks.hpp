@@ -0,0 +1,59 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace festation
+{
+    using PcHookId = uint32_t;
+    /** @brief Gets the hooked address, returns true if it moved the PC away (later hooks on it are skipped) */
+    using PcHook = std::function<bool(uint32_t address)>;
+
+    /**
+     * @brief Addresses watched for execution (kernel vectors, TTY capture, breakpoints, profiling probes).
+     * They're only checked when the PC changes non-sequentially (jump/branch targets and exception vectors),
+     * so hooks must sit on such entry points. A page bitmap keeps the check to one bit test when nothing
+     * is hooked nearby. Hooks can't add or remove hooks while they run.
+     */
+    class PcHooks
+    {
+    public:
+        /** @brief Address is matched on its physical part, so KUSEG/KSEG0/KSEG1 mirrors all trigger */
+        PcHookId add(uint32_t address, PcHook hook);
+        void remove(PcHookId id);
+
+        inline void check(uint32_t pc)
+        {
+            const uint32_t physicalAddress = pc & PHYSICAL_ADDRESS_MASK;
+
+            if (hookedPages.test(physicalAddress >> HOOK_PAGE_SHIFT))
+                dispatch(physicalAddress);
+        }
+
+        /** @brief Conservative, true if anything is hooked in the page of pc */
+        inline bool mayBeHooked(uint32_t pc) const
+        {
+            return hookedPages.test((pc & PHYSICAL_ADDRESS_MASK) >> HOOK_PAGE_SHIFT);
+        }
+
+    private:
+        static constexpr uint32_t PHYSICAL_ADDRESS_MASK = 0x1FFFFFFF;
+        static constexpr uint32_t HOOK_PAGE_SHIFT = 12;
+        static constexpr size_t HOOK_PAGES_COUNT = (PHYSICAL_ADDRESS_MASK >> HOOK_PAGE_SHIFT) + 1;
+
+        struct HookEntry
+        {
+            PcHookId id;
+            uint32_t physicalAddress;
+            PcHook hook;
+        };
+
+        void dispatch(uint32_t physicalAddress);
+
+        std::vector<HookEntry> hooks;
+        std::bitset<HOOK_PAGES_COUNT> hookedPages;
+        PcHookId nextId = 1;
+    };
+};
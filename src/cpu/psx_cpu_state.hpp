@@ -68,6 +68,11 @@ namespace festation
             return branchDelaySlotLatch.isDelay;
         }
 
+        constexpr inline uint32_t getDelayedJumpAddress() const
+        {
+            return branchDelaySlotLatch.destAddr;
+        }
+
         constexpr inline void performDelayedJump()
         {
             pc = branchDelaySlotLatch.destAddr;
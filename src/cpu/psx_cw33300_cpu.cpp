@@ -1,11 +1,12 @@
 #include "psx_cw33300_cpu.hpp"
 #include "psx_system.hpp"
-#include "mips_r3000a_opcodes.hpp"
-#include "coprocessor_cp0_opcodes.hpp"
+#include "instruction_dispatch.hpp"
 #include "exceptions_handling.hpp"
 #include "utils/logger.hpp"
 #include "memory/memory_map_masks.hpp"
+#include "savestate/state_serializer.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 #include <utility>
@@ -14,60 +15,127 @@ namespace festation
 {
     static constexpr uint32_t INSTRUCTION_SIZE = 4;
     static constexpr uintptr_t RESET_VECTOR = 0xBCF00000;
-    static constexpr uint8_t INSTRUCTION_CYCLES_AVERAGE = 2;
+
+    static constexpr uint32_t CACHE_CONTROL_ADDRESS = 0xFFFE0130;
+    static constexpr uint32_t CACHE_CONTROL_TAG_TEST_MODE = 1 << 2;
+    static constexpr uint32_t CACHE_CONTROL_CODE_CACHE_ENABLE = 1 << 11;
 };
 
 festation::MIPS_R3000A_Core::MIPS_R3000A_Core(PSXSystem* device, InterruptsHandler& intrHndRef)
     : system(device), m_intrHndRef(intrHndRef)
 {
     std::memset((void*) &r3000a_regs, 0, sizeof(PSXRegs));
+    m_intrHndRef.setLineChangedCallback([this]() { requestInterruptCheck(); });
 
     reset();
 }
 
 void festation::MIPS_R3000A_Core::reset()
 {
+    totalCyclesElapsed = 0;
+    hiLoReadyCycle = 0;
+    memoryAccessCycles = 0;
+    isInterruptCheckPending = true;
+    cacheControl = 0;
+    icache.reset();
+    blockCache.clear();
+
     handleReset(*this);
 }
 
+void festation::MIPS_R3000A_Core::serialize(StateSerializer& serializer)
+{
+    uint32_t version = 3;
+
+    if (!serializer.beginSection(makeSectionTag("CPU0"), version))
+        return;
+
+    /** @brief Both register files are plain data, delay slot latches included */
+    serializer.doValue(r3000a_regs);
+    serializer.doValue(cop0_state);
+    serializer.doValue(currentInstruction);
+    serializer.doValue(totalCyclesElapsed);
+    serializer.doValue(hiLoReadyCycle);
+    serializer.doArray(scratchpadCache);
+    serializer.doValue(cacheControl);
+    serializer.endSection();
+
+    icache.serialize(serializer);
+
+    // BIOS blocks aren't checked against memory, the state may come from another BIOS
+    if (serializer.isLoading())
+    {
+        blockCache.clear();
+        isInterruptCheckPending = true;
+    }
+}
+
 uint8_t festation::MIPS_R3000A_Core::read8(uint32_t address)
 {
     uint32_t masked_address = address & PHYSICAL_MEMORY_MASK;
     
-    if (masked_address >= SCRATCHPAD_START && masked_address <= SCRATCHPAD_END)
-    {
-        return scratchpadCache[masked_address & SCRATCHPAD_SIZE_MASK];
-    }
+    uint8_t value = (masked_address >= SCRATCHPAD_START && masked_address <= SCRATCHPAD_END) ?
+        scratchpadCache[masked_address & SCRATCHPAD_SIZE_MASK] : system->read8(address);
+
+    memoryAccessCycles += getMemoryReadCycles(address, sizeof(uint8_t));
+
+    if (isProbingIdleLoop) [[unlikely]]
+        hasIdleLoopUnsafeRead |= !isIdlePollAddress(address);
+
+    if (tracer.isRecording()) [[unlikely]]
+        tracer.onMemoryAccess(TraceAccessType::Read, sizeof(uint8_t), address, value);
 
-    return system->read8(address);
+    return value;
 }
 
 uint16_t festation::MIPS_R3000A_Core::read16(uint32_t address)
 {
     uint32_t masked_address = address & PHYSICAL_MEMORY_MASK;
 
-    if (masked_address >= SCRATCHPAD_START && masked_address <= SCRATCHPAD_END)
-    {
-        return scratchpadCache[masked_address & SCRATCHPAD_SIZE_MASK] |
-            (scratchpadCache[(masked_address + 1) & SCRATCHPAD_SIZE_MASK] << 8);
-    }
+    uint16_t value = (masked_address >= SCRATCHPAD_START && masked_address <= SCRATCHPAD_END) ?
+        scratchpadCache[masked_address & SCRATCHPAD_SIZE_MASK] | (scratchpadCache[(masked_address + 1) & SCRATCHPAD_SIZE_MASK] << 8) :
+        system->read16(address);
+
+    memoryAccessCycles += getMemoryReadCycles(address, sizeof(uint16_t));
+
+    if (isProbingIdleLoop) [[unlikely]]
+        hasIdleLoopUnsafeRead |= !isIdlePollAddress(address);
+
+    if (tracer.isRecording()) [[unlikely]]
+        tracer.onMemoryAccess(TraceAccessType::Read, sizeof(uint16_t), address, value);
 
-    return system->read16(address);
+    return value;
 }
 
 uint32_t festation::MIPS_R3000A_Core::read32(uint32_t address)
 {
     uint32_t masked_address = address & PHYSICAL_MEMORY_MASK;
 
+    uint32_t value;
+
     if (masked_address >= SCRATCHPAD_START && masked_address <= SCRATCHPAD_END)
     {
-        return scratchpadCache[masked_address & SCRATCHPAD_SIZE_MASK] |
+        value = scratchpadCache[masked_address & SCRATCHPAD_SIZE_MASK] |
             (scratchpadCache[(masked_address + 1) & SCRATCHPAD_SIZE_MASK] << 8) |
             (scratchpadCache[(masked_address + 2) & SCRATCHPAD_SIZE_MASK] << 16) |
             (scratchpadCache[(masked_address + 3) & SCRATCHPAD_SIZE_MASK] << 24);
     }
+    else if (address == CACHE_CONTROL_ADDRESS)
+    {
+        value = cacheControl;
+    }
+    else
+    {
+        value = system->read32(address);
+    }
+
+    memoryAccessCycles += getMemoryReadCycles(address, sizeof(uint32_t));
 
-    uint32_t value = system->read32(address);
+    if (isProbingIdleLoop) [[unlikely]]
+        hasIdleLoopUnsafeRead |= !isIdlePollAddress(address);
+
+    if (tracer.isRecording()) [[unlikely]]
+        tracer.onMemoryAccess(TraceAccessType::Read, sizeof(uint32_t), address, value);
 
     /*if (value == 0x801ff014) {
         LOG_DEBUG("Reading {:08X}h from 0x{:08X}", value, address);
@@ -81,7 +149,16 @@ uint32_t festation::MIPS_R3000A_Core::read32(uint32_t address)
 void festation::MIPS_R3000A_Core::write8(uint32_t address, uint8_t value)
 {
     if (isCacheIsolated())
+    {
+        icache.writeIsolated(address, (cacheControl & CACHE_CONTROL_TAG_TEST_MODE) != 0);
         return;
+    }
+
+    if (tracer.isRecording()) [[unlikely]]
+        tracer.onMemoryAccess(TraceAccessType::Write, sizeof(uint8_t), address, value);
+
+    if (memoryWriteLog) [[unlikely]]
+        memoryWriteLog->push_back({ TraceAccessType::Write, sizeof(uint8_t), address, value });
 
     uint32_t masked_address = address & PHYSICAL_MEMORY_MASK;
 
@@ -91,13 +168,23 @@ void festation::MIPS_R3000A_Core::write8(uint32_t address, uint8_t value)
         return;
     }
 
+    checkRunningBlockWrite(masked_address);
     system->write8(address, value);
 }
 
 void festation::MIPS_R3000A_Core::write16(uint32_t address, uint16_t value)
 {
     if (isCacheIsolated())
+    {
+        icache.writeIsolated(address, (cacheControl & CACHE_CONTROL_TAG_TEST_MODE) != 0);
         return;
+    }
+
+    if (tracer.isRecording()) [[unlikely]]
+        tracer.onMemoryAccess(TraceAccessType::Write, sizeof(uint16_t), address, value);
+
+    if (memoryWriteLog) [[unlikely]]
+        memoryWriteLog->push_back({ TraceAccessType::Write, sizeof(uint16_t), address, value });
 
     uint32_t masked_address = address & PHYSICAL_MEMORY_MASK;
 
@@ -108,13 +195,29 @@ void festation::MIPS_R3000A_Core::write16(uint32_t address, uint16_t value)
         return;
     }
 
+    checkRunningBlockWrite(masked_address);
     system->write16(address, value);
 }
 
 void festation::MIPS_R3000A_Core::write32(uint32_t address, uint32_t value)
 {
     if (isCacheIsolated())
+    {
+        icache.writeIsolated(address, (cacheControl & CACHE_CONTROL_TAG_TEST_MODE) != 0);
         return;
+    }
+
+    if (tracer.isRecording()) [[unlikely]]
+        tracer.onMemoryAccess(TraceAccessType::Write, sizeof(uint32_t), address, value);
+
+    if (memoryWriteLog) [[unlikely]]
+        memoryWriteLog->push_back({ TraceAccessType::Write, sizeof(uint32_t), address, value });
+
+    if (address == CACHE_CONTROL_ADDRESS)
+    {
+        cacheControl = value;
+        return;
+    }
 
     uint32_t masked_address = address & PHYSICAL_MEMORY_MASK;
 
@@ -127,6 +230,7 @@ void festation::MIPS_R3000A_Core::write32(uint32_t address, uint32_t value)
         return;
     }
 
+    checkRunningBlockWrite(masked_address);
     system->write32(address, value);
 
     /*if (value == 0x801ff014) {
@@ -136,7 +240,7 @@ void festation::MIPS_R3000A_Core::write32(uint32_t address, uint32_t value)
     }*/
 }
 
-uint8_t festation::MIPS_R3000A_Core::executeInstruction()
+uint32_t festation::MIPS_R3000A_Core::executeInstruction()
 {
     const bool isBranchDelayPending = r3000a_regs.isBranchDelaySlot();
     
@@ -146,6 +250,13 @@ uint8_t festation::MIPS_R3000A_Core::executeInstruction()
     }
 
     currentInstruction = fetchInstruction();
+
+    uint32_t cycles = getFetchCycles(r3000a_regs.currentPC);
+    cycles += getIssueCycles(currentInstruction, totalCyclesElapsed + cycles);
+    memoryAccessCycles = 0;
+
+    if (tracer.isRecording()) [[unlikely]]
+        tracer.beginInstruction();
         
     // if (r3000a_regs.pc == 0x8003D708) {
     //     printCPUState();
@@ -155,22 +266,102 @@ uint8_t festation::MIPS_R3000A_Core::executeInstruction()
 
     decodeAndExecuteInstruction(currentInstruction);
 
+    cycles += memoryAccessCycles;
+
+    if (profiler.isEnabled()) [[unlikely]]
+    {
+        const bool hasTakenBranch = !isBranchDelayPending && r3000a_regs.isBranchDelaySlot();
+        profiler.onInstructionExecuted(r3000a_regs.currentPC, currentInstruction,
+            hasTakenBranch ? std::optional(r3000a_regs.getDelayedJumpAddress()) : std::nullopt, cycles);
+    }
+
     if (isBranchDelayPending)
         r3000a_regs.performDelayedJump();
 
+    // Only after something changed the interrupt line, SR or CAUSE (see requestInterruptCheck)
+    if (isInterruptCheckPending) [[unlikely]]
+        checkInterrupts();
+
+    r3000a_regs.gpr_regs[0] = 0; // $0 or $zero is always zero
+
+    // Hooks are only looked up when the flow jumped (taken branch, jump or exception)
+    if (r3000a_regs.pc != r3000a_regs.currentPC + INSTRUCTION_SIZE)
+        pcHooks.check(r3000a_regs.pc);
+
+    if (tracer.isRecording()) [[unlikely]]
+        tracer.endInstruction(r3000a_regs.currentPC, currentInstruction, getTraceRegisters());
+
+    totalCyclesElapsed += cycles;
+
+    return cycles;
+}
+
+festation::CpuRunResult festation::MIPS_R3000A_Core::run(uint64_t cyclesBudget)
+{
+    switch (backend)
+    {
+    case CpuBackend::ThreadedInterpreter:
+        return runThreadedBlock(cyclesBudget);
+    case CpuBackend::Interpreter:
+    default:
+        return { executeInstruction(), 1 };
+    }
+}
+
+void festation::MIPS_R3000A_Core::checkInterrupts()
+{
+    isInterruptCheckPending = false;
     cop0_state.CAUSE.ip = m_intrHndRef.isInterruptPending();
 
     if ((cop0_state.CAUSE.r & cop0_state.SR.r & 0xFF00) && (cop0_state.SR.r & 1)) {
         handleException(*this, ExcCode_INT);
     }
+}
 
-    r3000a_regs.gpr_regs[0] = 0; // $0 or $zero is always zero
+uint32_t festation::MIPS_R3000A_Core::getFetchCycles(uint32_t address)
+{
+    if (isCachedAddress(address) && isCodeCacheEnabled())
+        return icache.fetch(address);
 
-    return INSTRUCTION_CYCLES_AVERAGE;
+    return getUncachedFetchCycles(address);
 }
 
-void festation::MIPS_R3000A_Core::clockCycles(uint32_t cycles)
+bool festation::MIPS_R3000A_Core::isCodeCacheEnabled() const
 {
+    return (cacheControl & CACHE_CONTROL_CODE_CACHE_ENABLE) != 0;
+}
+
+uint32_t festation::MIPS_R3000A_Core::getIssueCycles(uint32_t instruction, uint64_t issueCycle)
+{
+    const uint8_t opcode = getInstOpcode(instruction);
+    const InstructionTiming& timing = (opcode == 0) ?
+        SPECIAL_OPCODE_TIMINGS[getInstFunctionOperation(instruction)] : PRIMARY_OPCODE_TIMINGS[opcode];
+
+    if (timing.timingClass == InstructionTimingClass::Simple) [[likely]]
+        return timing.baseCycles;
+
+    // A busy multiplier/divider stalls whoever needs it, reading HI/LO or starting a new operation
+    const uint32_t interlockCycles = (hiLoReadyCycle > issueCycle) ? static_cast<uint32_t>(hiLoReadyCycle - issueCycle) : 0;
+
+    // Operands are read before the instruction runs, a pending load may still overwrite rs
+    const uint32_t rsValue = r3000a_regs.gpr_regs[getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RS>(instruction)];
+
+    switch (timing.timingClass)
+    {
+    case InstructionTimingClass::MultiplySigned:
+        hiLoReadyCycle = issueCycle + interlockCycles + getMultiplyLatency(rsValue, true);
+        break;
+    case InstructionTimingClass::MultiplyUnsigned:
+        hiLoReadyCycle = issueCycle + interlockCycles + getMultiplyLatency(rsValue, false);
+        break;
+    case InstructionTimingClass::Divide:
+        hiLoReadyCycle = issueCycle + interlockCycles + DIVIDE_LATENCY_CYCLES;
+        break;
+    default:
+        break;
+    }
+
+    return timing.baseCycles + interlockCycles;
 }
 
 festation::PSXRegs& festation::MIPS_R3000A_Core::getCPURegs()
@@ -183,11 +374,46 @@ festation::COP0SystemControlRegs& festation::MIPS_R3000A_Core::getCOP0Regs()
     return cop0_state;
 }
 
+bool festation::MIPS_R3000A_Core::startExecutionTrace(const std::filesystem::path& path)
+{
+    return tracer.start(path, r3000a_regs.pc, getTraceRegisters());
+}
+
+void festation::MIPS_R3000A_Core::stopExecutionTrace()
+{
+    tracer.stop();
+}
+
+std::array<uint32_t, festation::TRACE_REGISTERS_COUNT> festation::MIPS_R3000A_Core::getTraceRegisters() const
+{
+    std::array<uint32_t, TRACE_REGISTERS_COUNT> registers;
+
+    std::copy(std::begin(r3000a_regs.gpr_regs), std::end(r3000a_regs.gpr_regs), registers.begin());
+    registers[TRACE_HI_REGISTER] = r3000a_regs.hi;
+    registers[TRACE_LO_REGISTER] = r3000a_regs.lo;
+
+    return registers;
+}
+
 bool festation::MIPS_R3000A_Core::isCacheIsolated() const
 {
     return (cop0_state.getCop0RegisterValue(SR) & CACHE_ISOLATION_BIT_MASK) != 0;
 }
 
+void festation::MIPS_R3000A_Core::checkRunningBlockWrite(uint32_t maskedAddress)
+{
+    if (runningBlockSize == 0)
+        return;
+
+    // Offset taken modulo the 2MB mirror, a block running into the next mirror is still one range
+    const bool isInRunningBlock = maskedAddress <= MAIN_RAM_END &&
+        ((maskedAddress - runningBlockStart) & MAIN_RAM_SIZE_MASK) < runningBlockSize;
+    const bool isDmaPort = maskedAddress >= 0x1F801080 && maskedAddress <= 0x1F8010FF;
+
+    if (isInRunningBlock || isDmaPort)
+        hasRunningBlockChanged = true;
+}
+
 void festation::MIPS_R3000A_Core::printCPUState()
 {
     const PSXRegs& regs = this->getCPURegs();
@@ -234,279 +460,11 @@ uint32_t festation::MIPS_R3000A_Core::fetchInstruction()
 
 void festation::MIPS_R3000A_Core::decodeAndExecuteInstruction(uint32_t instruction)
 {
-    uint8_t opcode = getInstOpcode(instruction);
+    const uint8_t opcode = getInstOpcode(instruction);
 
-    switch(opcode)
-    {
-    case 0x0:   // R-FORMAT INSTRUCTION or SPECIAL
-        {
-            uint8_t function = getInstFunctionOperation(instruction);
-            reg_t rd = getInstDestRegEncoding<EncodingType::REGISTER>(instruction);
-            reg_t rt = getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RT>(instruction);
-            reg_t rs = getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RS>(instruction);
-            shift_t shift = getInstShiftAmount(instruction);
-
-            switch(function)
-            {
-            case 0x00:
-                sll(*this, rd, rt, shift);
-                break;
-            case 0x02:
-                srl(*this, rd, rt, shift);
-                break;
-            case 0x03:
-                sra(*this, rd, rt, shift);
-                break;
-            case 0x04:
-                sllv(*this, rd, rt, rs);
-                break;
-            case 0x06:
-                srlv(*this, rd, rt, rs);
-                break;
-            case 0x07:
-                srav(*this, rd, rt, rs);
-                break;
-            case 0x08:
-                jr(*this, rs);
-                break;
-            case 0x09:
-                jalr(*this, rs, rd);
-                break;
-            case 0x0C:
-                syscall(*this, getSyscallBreakCode(instruction));
-                break;
-            case 0x0D:
-                _break(*this, getSyscallBreakCode(instruction));
-                break;
-            case 0x10:
-                mfhi(*this, rd);
-                break;
-            case 0x11:
-                mthi(*this, rs);
-                break;
-            case 0x12:
-                mflo(*this, rd);
-                break;
-            case 0x13:
-                mtlo(*this, rs);
-                break;
-            case 0x18:
-                mult(*this, rs, rt);
-                break;
-            case 0x19:
-                multu(*this, rs, rt);
-                break;
-            case 0x1A:
-                div(*this, rs, rt);
-                break;
-            case 0x1B:
-                divu(*this, rs, rt);
-                break;
-            case 0x20:
-                add(*this, rd, rs, rt);
-                break;
-            case 0x21:
-                addu(*this, rd, rs, rt);
-                break;
-            case 0x22:
-                sub(*this, rd, rs, rt);
-                break;
-            case 0x23:
-                subu(*this, rd, rs, rt);
-                break;
-            case 0x24:
-                _and(*this, rd, rs, rt);
-                break;
-            case 0x25:
-                _or(*this, rd, rs, rt);
-                break;
-            case 0x26:
-                _xor(*this, rd, rs, rt);
-                break;
-            case 0x27:
-                nor(*this, rd, rs, rt);
-                break;
-            case 0x2A:
-                slt(*this, rd, rs, rt);
-                break;
-            case 0x2B:
-                sltu(*this, rd, rs, rt);
-                break;
-            default:
-                std::unreachable();
-            }
-        }
-        break;
-    case 0x2:   // J-FORMAT INSTRUCTION "J"
-        j(*this, getInstAddress(instruction));
-        break;
-    case 0x3:   // J-FORMAT INSTRUCTION "JAL"
-        jal(*this, getInstAddress(instruction));
-        break;
-    default:    // I-FORMAT INSTRUCTION
-        {
-            uint8_t opcode = getInstOpcode(instruction);
-            reg_t rt = getInstDestRegEncoding<EncodingType::IMMEDIATE>(instruction);
-            reg_t rs = getInstSrcRegEncoding<EncodingType::IMMEDIATE, SrcRegs::RS>(instruction);
-            immed16_t imm16 = getInstImmediate(instruction);
-
-            switch (opcode)
-            {
-            case 0x01:
-            {
-                // To be able to know which BcondZ instruction is, we look the encoding in rt reg field bits
-                bool ezBit = (rt & 0x01) == 0x01;
-                bool linkBit = ((rt >> 1) & 0x0F) == 0x08;
-
-                if (!ezBit && !linkBit)
-                {
-                    bltz(*this, rs, imm16);
-                }
-                else if (ezBit && !linkBit)
-                {
-                    bgez(*this, rs, imm16);
-                }
-                else if (!ezBit && linkBit)
-                {
-                    bltzal(*this, rs, imm16);
-                }
-                else if (ezBit && linkBit)
-                {
-                    bgezal(*this, rs, imm16);
-                }
-                else
-                {
-                    std::unreachable();
-                }
-            }
-                break;
-            case 0x04:
-                beq(*this, rs, rt, imm16);
-                break;
-            case 0x05:
-                bne(*this, rs, rt, imm16);
-                break;
-            case 0x06:
-                blez(*this, rs, imm16);
-                break;
-            case 0x07:
-                bgtz(*this, rs, imm16);
-                break;
-            case 0x08:
-                addi(*this, rt, rs, imm16);
-                break;
-            case 0x09:
-                addiu(*this, rt, rs, imm16);
-                break;
-            case 0x0A:
-                slti(*this, rt, rs, imm16);
-                break;
-            case 0x0B:
-                sltiu(*this, rt, rs, imm16);
-                break;
-            case 0x0C:
-                andi(*this, rt, rs, imm16);
-                break;
-            case 0x0D:
-                ori(*this, rt, rs, imm16);
-                break;
-            case 0x0E:
-                xori(*this, rt, rs, imm16);
-                break;
-            case 0x0F:
-                lui(*this, rt, imm16);
-                break;
-            case 0x10: // COP0
-                if (rs == 0b10000)
-                {
-                    // We don't check last 6 bits because PS1 CPU doesn't have TLB
-                    rfe(*this);
-                }
-                else
-                {
-                    reg_t rtcop0 = getInstSrcRegEncoding<EncodingType::REGISTER, SrcRegs::RT>(instruction);
-                    reg_t rdcop0 = getInstDestRegEncoding<EncodingType::REGISTER>(instruction);
-
-                    switch (rs) // We don't need to check for more opcodes on COP0
-                    {
-                    case 0b00000:
-                        mfc0(*this, rtcop0, rdcop0);
-                        break;
-                    case 0b00100:
-                        mtc0(*this, rtcop0, rdcop0);
-                        break;
-                    default:
-                        std::unreachable();
-                    }
-                }
-                break;
-            case 0x11: // COP1
-                std::unreachable();
-            case 0x12: // COP2
-                LOG_ERROR("Unimplemented GTE command ({:02}h) from ({:08X})", opcode, instruction);
-                break;
-            case 0x13: // COP3
-                std::unreachable();
-            case 0x20:
-                lb(*this, rt, rs, imm16);
-                break;
-            case 0x21:
-                lh(*this, rt, rs, imm16);
-                break;
-            case 0x22:
-                lwl(*this, rt, rs, imm16);
-                break;
-            case 0x23:
-                lw(*this, rt, rs, imm16);
-                break;
-            case 0x24:
-                lbu(*this, rt, rs, imm16);
-                break;
-            case 0x25:
-                lhu(*this, rt, rs, imm16);
-                break;
-            case 0x26:
-                lwr(*this, rt, rs, imm16);
-                break;
-            case 0x28:
-                sb(*this, rt, rs, imm16);
-                break;
-            case 0x29:
-                sh(*this, rt, rs, imm16);
-                break;
-            case 0x2A:
-                swl(*this, rt, rs, imm16);
-                break;
-            case 0x2B:
-                sw(*this, rt, rs, imm16);
-                break;
-            case 0x2E:
-                swr(*this, rt, rs, imm16);
-                break;
-            case 0x30: // COP0
-                lwc0(*this, rt, rs, imm16);
-                break;
-            case 0x31: // COP1
-                std::unreachable();
-            case 0x32: // COP2
-                LOG_ERROR("Unimplemented GTE command: lwc2 {:02x}, [{:02x}+{:02x}]", rt, rs, imm16);
-                break;
-            case 0x33: // COP3
-                std::unreachable();
-            case 0x38: // COP0
-                swc0(*this, rt, rs, imm16);
-                break;
-            case 0x39: // COP1
-                std::unreachable();
-            case 0x3A: // COP2
-                LOG_ERROR("Unimplemented GTE command: swc2 {:02x}, [{:02x}+{:02x}]", rt, rs, imm16);
-                break;
-            case 0x3B: // COP3
-                std::unreachable();
-            default:
-                std::unreachable();
-            } 
-        }
-        break;
-    }
+    // SPECIAL is looked up here rather than through its primary entry to keep it to one indirect call
+    const InstructionDescriptor& descriptor = (opcode == 0x00) ?
+        SPECIAL_INSTRUCTIONS[getInstFunctionOperation(instruction)] : PRIMARY_INSTRUCTIONS[opcode];
+
+    descriptor.handler(*this, instruction);
 }
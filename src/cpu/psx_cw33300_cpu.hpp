@@ -1,19 +1,44 @@
 #pragma once
 #include "psx_cpu_state.hpp"
 #include "cpu_masks_types_utils.hpp"
+#include "pc_hooks.hpp"
+#include "cpu_profiler.hpp"
+#include "execution_trace.hpp"
+#include "instruction_timing.hpp"
+#include "instruction_cache.hpp"
+#include "block_cache.hpp"
 #include "interrupts/interrupts.hpp"
 
 #include <cstdint>
 #include <array>
 #include <functional>
+#include <filesystem>
+#include <string_view>
+#include <vector>
 
 namespace festation
 {
     class PSXSystem;
+    class StateSerializer;
 
     static constexpr float CPU_CLOCK_SPEED = 33.8688f; // MHz
     static constexpr uint32_t CPU_CLOCKS_PER_SECOND = 33'868'800;
 
+    /** @brief Ways of executing guest code, all of them must end up in the same state (see LockstepHarness) */
+    enum class CpuBackend : uint8_t
+    {
+        Interpreter,
+        ThreadedInterpreter,    // Pre-decoded blocks, ops chained through computed goto (see block_cache.hpp)
+    };
+
+    static constexpr std::array<std::string_view, 2> CPU_BACKEND_NAMES = { "interpreter", "threaded" };
+
+    struct CpuRunResult
+    {
+        uint32_t cycles;            // Not yet given to the scheduler
+        uint32_t instructions;
+    };
+
     class MIPS_R3000A_Core
     {
     public:
@@ -30,24 +55,73 @@ namespace festation
         void write16(uint32_t address, uint16_t value);
         void write32(uint32_t address, uint32_t value);
 
-        uint8_t executeInstruction();
-        void clockCycles(uint32_t cycles);
+        /** @brief Returns the cycles taken, fetch, memory stalls and HI/LO interlocks included */
+        uint32_t executeInstruction();
+        /**
+         * @brief One step of the selected backend: an instruction for the interpreter, a block for the threaded
+         * one, which stops early once cyclesBudget (time to the next scheduler event) is used up
+         */
+        CpuRunResult run(uint64_t cyclesBudget);
+        inline uint64_t getElapsedCycles() const { return totalCyclesElapsed; }
 
         PSXRegs& getCPURegs();
         COP0SystemControlRegs& getCOP0Regs();
         inline uint32_t getCurrentInstruction() const { return currentInstruction; }
 
         bool isCacheIsolated() const;
+        inline InstructionCache& getInstructionCache() { return icache; }
+
+        inline PcHooks& getPcHooks() { return pcHooks; }
+        /** @brief Interrupt state changed (line from the controller, SR or CAUSE), looked at after the current instruction */
+        inline void requestInterruptCheck() { isInterruptCheckPending = true; }
+        inline CpuProfiler& getProfiler() { return profiler; }
+
+        /** @brief Binary trace of every instruction from the current state on (see ExecutionTraceWriter) */
+        bool startExecutionTrace(const std::filesystem::path& path);
+        void stopExecutionTrace();
+        inline bool isTracingExecution() const { return tracer.isRecording(); }
+
+        inline void setBackend(CpuBackend cpuBackend) { backend = cpuBackend; }
+        inline CpuBackend getBackend() const { return backend; }
+
+        /** @brief Every CPU store (after cache isolation) is appended to it while set, nullptr stops logging */
+        inline void setMemoryWriteLog(std::vector<TraceMemoryAccess>* log) { memoryWriteLog = log; }
 
         void printCPUState();
         void printCOP0State();
 
+        void serialize(StateSerializer& serializer);
+
     private:        
         uint32_t fetchInstruction();
         void decodeAndExecuteInstruction(uint32_t instruction);
+        std::array<uint32_t, TRACE_REGISTERS_COUNT> getTraceRegisters() const;
+        /** @brief Base cycles plus HI/LO interlock stalls, starts the multiplier/divider on mult/div */
+        uint32_t getIssueCycles(uint32_t instruction, uint64_t issueCycle);
+        uint32_t getFetchCycles(uint32_t address);
+        bool isCodeCacheEnabled() const;
+        /** @brief Updates CAUSE.IP and takes the interrupt if it's enabled, clears the pending check */
+        void checkInterrupts();
+        CpuRunResult runThreadedBlock(uint64_t cyclesBudget);
+        /**
+         * @brief After an iteration of an idle loop block: if it left the registers as they were and only read
+         * what can't change until the next scheduler event, the iterations until then are all the same and are
+         * accounted for at once. Returns the iterations skipped.
+         */
+        uint32_t skipIdleLoop(const CodeBlock& block, const PSXRegs& iterationStartRegs, uint64_t iterationCycles, uint32_t pendingCycles);
+        /** @brief Flags stores into the running RAM block, or to the DMA ports (a transfer may land on it) */
+        void checkRunningBlockWrite(uint32_t maskedAddress);
 
     private:
-        uint64_t totalCyclesElapsed;
+        uint64_t totalCyclesElapsed = 0;
+        uint64_t hiLoReadyCycle = 0;        // Cycle the multiplier/divider result can be read at
+        uint32_t memoryAccessCycles = 0;    // Read stalls of the instruction being executed
+        bool isInterruptCheckPending = true;
+        bool isProbingIdleLoop = false;     // Reads of the running idle loop candidate are being watched
+        bool hasIdleLoopUnsafeRead = false;
+        uint32_t runningBlockStart = 0;     // Physical RAM address of the running threaded block
+        uint32_t runningBlockSize = 0;      // 0 while no RAM block is running
+        bool hasRunningBlockChanged = false;
         PSXSystem* system = nullptr;
 
         PSXRegs r3000a_regs;
@@ -56,5 +130,13 @@ namespace festation
         InterruptsHandler& m_intrHndRef;
 
         std::array<uint8_t, 1024> scratchpadCache;
+        InstructionCache icache;
+        uint32_t cacheControl = 0;          // FFFE0130h
+        BlockCache blockCache;
+        PcHooks pcHooks;
+        CpuProfiler profiler;
+        ExecutionTraceWriter tracer;
+        std::vector<TraceMemoryAccess>* memoryWriteLog = nullptr;
+        CpuBackend backend = CpuBackend::Interpreter;
     };
 };
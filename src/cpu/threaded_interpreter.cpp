@@ -0,0 +1,239 @@
+#include "psx_cw33300_cpu.hpp"
+#include "psx_system.hpp"
+#include "block_cache.hpp"
+#include "instruction_timing.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+// GCC and Clang jump from an op straight to the label of the next one (computed goto), one indirect
+// branch per op the predictor can tell apart. Other compilers go back through a switch.
+#if defined(__GNUC__) || defined(__clang__)
+#define FESTATION_COMPUTED_GOTO 1
+#endif
+
+namespace festation
+{
+    static constexpr uint32_t INSTRUCTION_SIZE = 4;
+
+    /** @brief Everything an iteration of a loop starts from, but the PC (already known to be the loop start) */
+    static bool isSameIterationState(const PSXRegs& first, const PSXRegs& second)
+    {
+        return std::ranges::equal(first.gpr_regs, second.gpr_regs) && first.hi == second.hi && first.lo == second.lo &&
+            first.currentPC == second.currentPC && first.isBranchDelaySlot() == second.isBranchDelaySlot() &&
+            first.isLoadDelaySlot() == second.isLoadDelaySlot() &&
+            (!first.isLoadDelaySlot() || (first.getLoadReg() == second.getLoadReg() && first.getLoadValue() == second.getLoadValue()));
+    }
+};
+
+/**
+ * Runs a block with the same results as executeInstruction() on each of its instructions (the lockstep harness
+ * checks it). What the interpreter does after every instruction is only done where it can make a difference:
+ * - Interrupts are only checked when the controller, SR or CAUSE asked for it (requestInterruptCheck). Only
+ *   Checked ops can do that (stores, COP0 ops, loads) or events between blocks (seen by the first op).
+ * - $zero is only cleared after ops that may write it, a load into $zero is written by the op after it.
+ * - The flow only leaves the block by its own jump or an exception, then hooks are checked and the block ends.
+ * - Time is given to the scheduler before loads/stores, devices see it as they would with the interpreter.
+ *   A store may schedule an event, so the budget is taken again from the scheduler after it.
+ * Whatever the interpreter needs to see instruction by instruction (tracer, profiler, a jump pending from
+ * the previous block, misaligned PCs, code not fully in the instruction cache) runs one instruction instead.
+ * Idle loops (see CodeBlock::isIdleLoop) may fast forward to the next scheduler event, see skipIdleLoop().
+ */
+festation::CpuRunResult festation::MIPS_R3000A_Core::runThreadedBlock(uint64_t cyclesBudget)
+{
+    if (tracer.isRecording() || profiler.isEnabled() || r3000a_regs.isBranchDelaySlot() ||
+        ((r3000a_regs.pc | r3000a_regs.currentPC) & (INSTRUCTION_SIZE - 1))) [[unlikely]]
+        return { executeInstruction(), 1 };
+
+    const CodeBlock* block = blockCache.getBlock(r3000a_regs.pc, *system);
+
+    if (!block) [[unlikely]]
+        return { executeInstruction(), 1 };
+
+    uint32_t fetchCycles = block->uncachedFetchCycles;
+
+    if (isCachedAddress(block->startPc) && isCodeCacheEnabled())
+    {
+        // Misses are left to the interpreter, a block is run once all its lines are in
+        if (!icache.isBlockCached(block->startPc, block->endPc))
+            return { executeInstruction(), 1 };
+
+        fetchCycles = ICACHE_HIT_CYCLES;
+    }
+
+    const uint32_t entryCacheControl = cacheControl;
+
+    if (block->isInMainRAM)
+    {
+        runningBlockStart = block->startPc & PHYSICAL_MEMORY_MASK & MAIN_RAM_SIZE_MASK;
+        runningBlockSize = block->endPc - block->startPc + INSTRUCTION_SIZE;
+        hasRunningBlockChanged = false;
+    }
+
+    const ThreadedOp* op = block->ops.data();
+    uint32_t pc = block->startPc;
+    uint32_t cycles = 0;
+    uint32_t instructions = 0;
+    uint64_t syncedCycles = 0;
+    memoryAccessCycles = 0;
+
+    // Hooks would run every iteration (the loop start is a jump target), those loops aren't skipped
+    const bool isIdleLoopProbe = block->isIdleLoop && !pcHooks.mayBeHooked(block->startPc);
+    std::optional<PSXRegs> iterationStartRegs;
+
+    if (isIdleLoopProbe) [[unlikely]]
+    {
+        iterationStartRegs.emplace(r3000a_regs);
+        isProbingIdleLoop = true;
+        hasIdleLoopUnsafeRead = false;
+    }
+
+#ifdef FESTATION_COMPUTED_GOTO
+    static const void* const OP_LABELS[] = { &&simple_op, &&checked_op, &&block_end };
+#define DISPATCH_NEXT_OP() goto *OP_LABELS[static_cast<size_t>(op->kind)]
+#else
+#define DISPATCH_NEXT_OP() goto dispatch
+#endif
+
+    DISPATCH_NEXT_OP();
+
+#ifndef FESTATION_COMPUTED_GOTO
+dispatch:
+    switch (op->kind)
+    {
+    case ThreadedOpKind::Simple:
+        goto simple_op;
+    case ThreadedOpKind::Checked:
+        goto checked_op;
+    default:
+        goto block_end;
+    }
+#endif
+
+simple_op:
+    r3000a_regs.currentPC = pc;
+    r3000a_regs.pc = pc + INSTRUCTION_SIZE;
+    currentInstruction = op->instruction;
+
+    op->handler(*this, op->instruction);
+
+    cycles += fetchCycles + op->baseCycles;
+    instructions++;
+    pc += INSTRUCTION_SIZE;
+
+    if (cycles + memoryAccessCycles >= cyclesBudget)
+        goto block_end;
+
+    op++;
+    DISPATCH_NEXT_OP();
+
+checked_op:
+    {
+        if (op->flags & SYNCS_TIME)
+        {
+            const uint32_t elapsedCycles = cycles + memoryAccessCycles;
+
+            totalCyclesElapsed += elapsedCycles;
+            system->advanceTime(elapsedCycles);
+            cyclesBudget -= elapsedCycles;
+            syncedCycles += elapsedCycles;
+            cycles = 0;
+            memoryAccessCycles = 0;
+        }
+
+        const bool isBranchDelayPending = (op->flags & DELAY_SLOT) && r3000a_regs.isBranchDelaySlot();
+
+        r3000a_regs.currentPC = pc;
+        r3000a_regs.pc = pc + INSTRUCTION_SIZE;
+        currentInstruction = op->instruction;
+
+        cycles += fetchCycles;
+        cycles += (op->flags & HILO_TIMING) ?
+            getIssueCycles(op->instruction, totalCyclesElapsed + cycles + memoryAccessCycles) : op->baseCycles;
+
+        op->handler(*this, op->instruction);
+        instructions++;
+
+        if (isBranchDelayPending)
+            r3000a_regs.performDelayedJump();
+
+        if (isInterruptCheckPending)
+            checkInterrupts();
+
+        if (op->flags & MAY_CHANGE_IRQ)
+        {
+            // Stores to the cache control register or with the cache isolated change how the rest would be fetched,
+            // stores into the block itself (or DMA it started) leave its remaining ops stale
+            const bool hasFetchChanged = cacheControl != entryCacheControl || isCacheIsolated() || hasRunningBlockChanged;
+            cyclesBudget = hasFetchChanged ? 0 : system->getCyclesUntilNextEvent();
+        }
+
+        if (op->flags & CLEARS_ZERO_REGISTER)
+            r3000a_regs.gpr_regs[0] = 0;
+
+        if (r3000a_regs.pc != pc + INSTRUCTION_SIZE)
+        {
+            pcHooks.check(r3000a_regs.pc);
+            goto block_end;
+        }
+    }
+
+    pc += INSTRUCTION_SIZE;
+
+    if (cycles + memoryAccessCycles >= cyclesBudget)
+        goto block_end;
+
+    op++;
+    DISPATCH_NEXT_OP();
+
+#undef DISPATCH_NEXT_OP
+
+block_end:
+    runningBlockSize = 0;
+    cycles += memoryAccessCycles;
+    memoryAccessCycles = 0;
+    totalCyclesElapsed += cycles;
+
+    if (isIdleLoopProbe) [[unlikely]]
+    {
+        isProbingIdleLoop = false;
+
+        const uint32_t iterationInstructions = static_cast<uint32_t>(block->ops.size() - 1);
+
+        if (instructions == iterationInstructions)
+        {
+            const uint64_t iterationCycles = syncedCycles + cycles;
+            const uint32_t skippedIterations = skipIdleLoop(*block, *iterationStartRegs, iterationCycles, cycles);
+
+            cycles += static_cast<uint32_t>(skippedIterations * iterationCycles);
+            instructions += skippedIterations * iterationInstructions;
+        }
+    }
+
+    return { cycles, instructions };
+}
+
+uint32_t festation::MIPS_R3000A_Core::skipIdleLoop(const CodeBlock& block, const PSXRegs& iterationStartRegs,
+    uint64_t iterationCycles, uint32_t pendingCycles)
+{
+    // Looped back without an exception, an interrupt or anything read that could change
+    if (hasIdleLoopUnsafeRead || isInterruptCheckPending || r3000a_regs.pc != block.startPc ||
+        !isSameIterationState(iterationStartRegs, r3000a_regs))
+        return 0;
+
+    // Only whole iterations ending at the event (not after), the one crossing it runs normally
+    const uint64_t cyclesUntilEvent = system->getCyclesUntilNextEvent();
+
+    if (cyclesUntilEvent <= pendingCycles)
+        return 0;
+
+    const uint32_t iterationInstructions = static_cast<uint32_t>(block.ops.size() - 1);
+    const uint64_t maxIterations = std::min((std::numeric_limits<uint32_t>::max() - pendingCycles) / iterationCycles,
+        static_cast<uint64_t>(std::numeric_limits<uint32_t>::max() / iterationInstructions - 1));
+    const uint64_t iterations = std::min((cyclesUntilEvent - pendingCycles) / iterationCycles, maxIterations);
+
+    totalCyclesElapsed += iterations * iterationCycles;
+
+    return static_cast<uint32_t>(iterations);
+}
@@ -1,9 +1,12 @@
 #include "dma_channel.hpp"
 #include "psx_system.hpp"
+#include "memory/memory_map_masks.hpp"
+#include "savestate/state_serializer.hpp"
 #include "utils/logger.hpp"
 
 #include <cassert>
 #include <cstring>
+#include <span>
 
 festation::DmaChannel::DmaChannel(PSXSystem& system)
     : D_MADR({}), D_BCR({}), D_CHCR({}), m_system(system)
@@ -78,6 +81,14 @@ auto festation::DmaChannel::isEnabled() const -> bool
     return m_isEnabled;
 }
 
+auto festation::DmaChannel::serialize(StateSerializer& serializer) -> void
+{
+    serializer.doValue(D_MADR.raw);
+    serializer.doValue(D_BCR.raw);
+    serializer.doValue(D_CHCR.raw);
+    serializer.doBool(m_isEnabled);
+}
+
 auto festation::DmaChannel::modifyControlRegister(uint32_t value) -> void
 {
     D_CHCR.raw = value;
@@ -244,6 +255,17 @@ auto festation::Dma3Cdrom::startTransfer() -> void
         std::unreachable();
     }
 
+    std::span<uint8_t> mainRAM = this->m_system.getMainRAM();
+    const size_t ramOffset = address & MAIN_RAM_SIZE_MASK;
+    const size_t bytesCount = wordsCount * sizeof(uint32_t);
+
+    /** @brief Whole sector is copied at once unless the transfer goes backwards or wraps around RAM */
+    if (increment > 0 && ramOffset + bytesCount <= mainRAM.size()) {
+        this->m_system.getCdrom().readDataFifo(mainRAM.subspan(ramOffset, bytesCount));
+        address += bytesCount;
+        wordsCount = 0;
+    }
+
     while (wordsCount > 0) {
         uint32_t word = this->m_system.read32(0x1F801802);
         this->m_system.write32(address, word);
@@ -4,6 +4,7 @@
 
 namespace festation {
     class PSXSystem;
+    class StateSerializer;
 
     enum TransferDirection : uint32_t {
         DeviceToRam = 0,
@@ -33,6 +34,8 @@ namespace festation {
         auto setChannelEnable(bool isEnabled) -> void;
         auto isEnabled() const -> bool;
 
+        auto serialize(StateSerializer& serializer) -> void;
+
     protected:
         virtual auto startTransfer() -> void = 0;
         virtual auto modifyControlRegister(uint32_t value) -> void;
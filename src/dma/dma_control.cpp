@@ -1,5 +1,6 @@
 #include <dma/dma_control.hpp>
 #include "dma_control.hpp"
+#include "savestate/state_serializer.hpp"
 
 #include <algorithm>
 
@@ -27,6 +28,23 @@ auto festation::DmaControl::reset() -> void
     DICR.raw = 0;
 }
 
+auto festation::DmaControl::serialize(StateSerializer& serializer) -> void
+{
+    uint32_t version = 1;
+
+    if (!serializer.beginSection(makeSectionTag("DMAC"), version))
+        return;
+
+    serializer.doValue(DPCR.raw);
+    serializer.doValue(DICR.raw);
+
+    for (auto& channel : m_channels) {
+        channel->serialize(serializer);
+    }
+
+    serializer.endSection();
+}
+
 auto festation::DmaControl::read32(uint32_t address) -> uint32_t
 {
     switch(address)
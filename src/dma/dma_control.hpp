@@ -15,6 +15,7 @@ namespace festation {
         ~DmaControl();
 
         auto reset() -> void;
+        auto serialize(StateSerializer& serializer) -> void;
 
         auto read32(uint32_t address) -> uint32_t;
         auto write32(uint32_t address, uint32_t value) -> void;
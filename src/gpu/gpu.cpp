@@ -1,15 +1,17 @@
 #include "gpu.hpp"
 #include "gpu_commands.h"
+#include "savestate/state_serializer.hpp"
 #include "utils/logger.hpp"
 
+#include <algorithm>
 #include <utility>
 #include <cstring>
 
 #include <glm/gtc/matrix_transform.hpp>
 
-festation::PsxGpu::PsxGpu()
+festation::PsxGpu::PsxGpu(const std::filesystem::path& shadersPath)
     : GPUREAD(0), GPUSTAT({}), m_commandState(GpuCommandsState::WaitingForCommand),
-        m_remainingCmdArg(1), m_currentCmdParam(0), m_commandsFIFO({}), m_vram(VRAM_WIDTH * VRAM_HEIGHT), m_renderer(m_vram)
+        m_remainingCmdArg(1), m_currentCmdParam(0), m_commandsFIFO({}), m_vram(VRAM_WIDTH * VRAM_HEIGHT), m_renderer(m_vram, shadersPath)
 {
     processResetGpuCmd();
     updateRenderProjection();
@@ -20,6 +22,26 @@ festation::PsxGpu::~PsxGpu()
 {
 }
 
+auto festation::PsxGpu::reset() -> void
+{
+    m_renderer.renderBatch();
+
+    GPUREAD = 0;
+    processResetGpuCmd();
+    processResetCommandBufferCmd();
+    m_remainingCmdArg = 1;
+    m_drawingAreaInfo = {};
+    m_cpuVramBlitCmdInfo = {};
+    m_vramCpuBlitCmdInfo = {};
+    m_gp0ReadValue = 0;
+    m_rectData = {};
+    m_polyData = {};
+
+    std::ranges::fill(m_vram, 0);
+    m_renderer.uploadVramToGpu((const uint8_t*)m_vram.data(), { 0, 0 }, { VRAM_WIDTH, VRAM_HEIGHT });
+    updateRenderProjection();
+}
+
 auto festation::PsxGpu::read32(uint32_t address) -> uint32_t
 {
     switch(address) {
@@ -101,6 +123,8 @@ auto festation::PsxGpu::write32(uint32_t address, uint32_t value) -> void
 auto festation::PsxGpu::renderFrame() -> void
 {
     m_renderer.renderBatch();
+    /** @brief States are saved between frames (rewind, run-ahead), their VRAM copy is already on its way by then */
+    m_renderer.beginVramReadback();
 }
 
 auto festation::PsxGpu::parseCommandGP0(uint32_t commandWord) -> void
@@ -670,6 +694,20 @@ auto festation::PsxGpu::processVerticalDisplayRangeCmd(uint32_t parameter) -> vo
 
 auto festation::PsxGpu::processDisplayModeCmd(uint32_t parameter) -> void
 {
+    GPUSTAT.horizontalResolution1 = parameter & 3;
+    GPUSTAT.verticalResolution = (parameter >> 2) & 1;
+    GPUSTAT.videoMode = (parameter >> 3) & 1;
+    GPUSTAT.displayAreaColorDepth = (parameter >> 4) & 1;
+    GPUSTAT.verticalInterlace = (parameter >> 5) & 1;
+    GPUSTAT.horizontalResolution2 = (parameter >> 6) & 1;
+    GPUSTAT.flipScreenHorizontally = (parameter >> 7) & 1;
+}
+
+auto festation::PsxGpu::getDotClockDivider() const -> uint32_t
+{
+    static constexpr uint32_t DOT_CLOCK_DIVIDERS[] = { 10, 8, 5, 4 };   // 256, 320, 512, 640 pixels wide
+
+    return GPUSTAT.horizontalResolution2 ? 7 : DOT_CLOCK_DIVIDERS[GPUSTAT.horizontalResolution1];     // 368 pixels wide
 }
 
 auto festation::PsxGpu::processSetVramSizeCmd(uint32_t parameter) -> void
@@ -680,6 +718,69 @@ auto festation::PsxGpu::processReadGpuInternalRegCmd(uint32_t parameter) -> void
 {
 }
 
+auto festation::PsxGpu::serialize(StateSerializer& serializer, bool withRenderedVram) -> void
+{
+    uint32_t version = 1;
+
+    if (!serializer.beginSection(makeSectionTag("GPU0"), version))
+        return;
+
+    serializer.doValue(GPUREAD);
+    serializer.doValue(GPUSTAT.raw);
+    serializer.doValue(m_drawingAreaInfo);
+
+    serializer.doValue(m_cpuVramBlitCmdInfo.cmdState);
+    serializer.doValue(m_cpuVramBlitCmdInfo.dstCoord);
+    serializer.doValue(m_cpuVramBlitCmdInfo.size2D);
+    serializer.doValue(m_cpuVramBlitCmdInfo.size);
+    serializer.doValue(m_cpuVramBlitCmdInfo.totalWords);
+    serializer.doValue(m_cpuVramBlitCmdInfo.currentWord);
+    serializer.doVector(m_cpuVramBlitCmdInfo.blitData);
+    serializer.doValue(m_vramCpuBlitCmdInfo);
+
+    serializer.doValue(m_gp0ReadValue);
+    serializer.doValue(m_rectData);
+    serializer.doValue(m_polyData);
+    serializer.doValue(m_commandState);
+    serializer.doValue(m_remainingCmdArg);
+    serializer.doValue(m_currentCmdParam);
+    serializer.doArray(m_commandsFIFO);
+    serializer.doSpan(std::span(m_vram));
+
+    /**
+     * @brief Primitives are only drawn on the host GPU, so m_vram alone misses them.
+     * The framebuffer contents are stored as well and take precedence on load.
+     */
+    if (!serializer.isLoading()) {
+        m_renderedVram.resize(withRenderedVram ? VRAM_WIDTH * VRAM_HEIGHT : 0);
+
+        if (withRenderedVram) {
+            m_renderer.downloadVramFromGpu({ (uint8_t*)m_renderedVram.data(), m_renderedVram.size() * sizeof(uint16_t) });
+        }
+    }
+
+    serializer.doVector(m_renderedVram);
+    serializer.endSection();
+}
+
+auto festation::PsxGpu::finishStateLoad() -> void
+{
+    m_renderer.renderBatch();
+
+    if (!m_renderedVram.empty()) {
+        if (m_renderedVram.size() != VRAM_WIDTH * VRAM_HEIGHT) {
+            m_renderedVram = m_vram;
+        }
+
+        m_renderer.uploadVramToGpu((const uint8_t*)m_renderedVram.data(), { 0, 0 }, { VRAM_WIDTH, VRAM_HEIGHT });
+        m_renderedVram.clear();
+    }
+
+    uint16_t flippedY = VRAM_HEIGHT - (m_drawingAreaInfo.topLeft.y + m_drawingAreaInfo.bottomRight.y);
+    m_renderer.setClipRegion({ m_drawingAreaInfo.topLeft.x, flippedY }, m_drawingAreaInfo.bottomRight);
+    updateRenderProjection();
+}
+
 auto festation::PsxGpu::updateRenderProjection() -> void
 {
     // float width = m_drawingAreaInfo.bottomRight.x - m_drawingAreaInfo.topLeft.x + 1;
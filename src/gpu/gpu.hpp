@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <array>
+#include <filesystem>
 #include <vector>
 
 #include <glm/vec2.hpp>
@@ -14,15 +15,26 @@ namespace festation {
     static constexpr size_t VRAM_WIDTH = 1024;
     static constexpr size_t VRAM_HEIGHT = 512;
 
+    class StateSerializer;
+
     class PsxGpu {
     public:
-        PsxGpu();
+        PsxGpu(const std::filesystem::path& shadersPath);
         ~PsxGpu();
 
         auto read32(uint32_t address) -> uint32_t;
         auto write32(uint32_t address, uint32_t value) -> void;
 
         auto renderFrame() -> void;
+        /** @brief Power on state: GP1(00h) reset, empty command buffer and cleared VRAM */
+        auto reset() -> void;
+        auto setOutputMode(RenderOutputMode mode) -> void { m_renderer.setOutputMode(mode); }
+        /** @brief Video clock cycles per dot for the current horizontal resolution */
+        auto getDotClockDivider() const -> uint32_t;
+
+        /** @brief Loading doesn't touch the host GPU, finishStateLoad() does once the whole machine state is in */
+        auto serialize(StateSerializer& serializer, bool withRenderedVram = true) -> void;
+        auto finishStateLoad() -> void;
 
     private:
         auto parseCommandGP0(uint32_t commandWord) -> void;
@@ -124,6 +136,8 @@ namespace festation {
         std::array<uint32_t, MAX_COMMANDS_BUFFER_SIZE> m_commandsFIFO{};
 
         std::vector<uint16_t> m_vram{};
+        /** @brief Host VRAM as saved or just loaded (empty: left as is), reused between states */
+        std::vector<uint16_t> m_renderedVram{};
 
         Renderer m_renderer;
     };
@@ -29,6 +29,7 @@ namespace festation {
 
         virtual auto setData(const uint8_t* buffer, const glm::uvec2& offset, const glm::uvec2& size) -> void = 0;
         virtual auto setData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) -> void = 0;
+        virtual auto getData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) const -> void = 0;
 
         virtual auto blitToSwapchain() -> void = 0;
         virtual auto blitToFramebuffer(const IFramebuffer& framebuffer, const glm::uvec2& srcOffset, const glm::uvec2& dstOffset) -> void = 0;
@@ -47,6 +47,11 @@ auto festation::OGLFramebuffer::setData(std::span<uint8_t> buffer, const glm::uv
     m_colorAttachment->setData(buffer, offset, size);
 }
 
+auto festation::OGLFramebuffer::getData(std::span<uint8_t> buffer, const glm::uvec2 &offset, const glm::uvec2 &size) const -> void
+{
+    m_colorAttachment->getData(buffer, offset, size);
+}
+
 auto festation::OGLFramebuffer::blitToSwapchain() -> void
 {
 	glBlitNamedFramebuffer(m_fbo, 0, 
@@ -12,6 +12,7 @@ namespace festation {
 
         auto setData(const uint8_t* buffer, const glm::uvec2& offset, const glm::uvec2& size) -> void override;
         auto setData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) -> void override;
+        auto getData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) const -> void override;
 
         auto blitToSwapchain() -> void override;
         auto blitToFramebuffer(const IFramebuffer& framebuffer, const glm::uvec2& srcOffset, const glm::uvec2& dstOffset) -> void override;
@@ -66,6 +66,14 @@ auto festation::OGLTexture::setData(std::span<uint8_t> buffer, const glm::uvec2&
     }
 }
 
+auto festation::OGLTexture::getData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) const -> void
+{
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    auto [_, format, type] = getGLFormat(m_specification.format);
+    glGetTextureSubImage(m_textureID, 0, offset.x, offset.y, 0, size.x, size.y, 1, format, type, 
+        static_cast<GLsizei>(buffer.size()), buffer.data());
+}
+
 auto festation::OGLTexture::createTexture() -> void
 {
     glCreateTextures(GL_TEXTURE_2D, 1, &m_textureID);
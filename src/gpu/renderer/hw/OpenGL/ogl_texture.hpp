@@ -12,6 +12,7 @@ namespace festation {
 
             auto setData(const uint8_t *const buffer, const glm::uvec2& offset, const glm::uvec2& size) -> void override;
             auto setData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) -> void override;
+            auto getData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) const -> void override;
 
         private:
             auto createTexture() -> void;
@@ -2,6 +2,7 @@
 #include "glad/gl.h"
 
 #include <filesystem>
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <utility>
@@ -18,6 +19,8 @@ namespace festation {
     static constexpr size_t VRAM_WIDTH = 1024;
     static constexpr size_t VRAM_HEIGHT = 512;
     static constexpr glm::u16vec2 VRAM_SIZE = { VRAM_WIDTH, VRAM_HEIGHT };
+    static constexpr size_t VRAM_SIZE_BYTES = VRAM_WIDTH * VRAM_HEIGHT * sizeof(uint16_t);
+    static constexpr GLuint64 VRAM_READBACK_WAIT_TIMEOUT_NS = 1'000'000;
 
     static constexpr uint32_t getBppDepthFromRegBits(TexturePageColorsDepth colorDepth)
     {
@@ -36,10 +39,10 @@ namespace festation {
     }
 };
 
-festation::Renderer::Renderer(const std::vector<uint16_t>& vram)
-    : m_flatColorShader(IShader::createUnique(SHADERS_PATH / "flat_color.glsl.vert",
-        SHADERS_PATH / "flat_color.glsl.frag")), m_textureShader(IShader::createUnique(SHADERS_PATH / "texture.glsl.vert",
-            SHADERS_PATH / "texture.glsl.frag")), m_VAO(0), m_VBO(0), m_IBO(0), m_projection(glm::mat4(1)), m_indicesCount(0), m_vramRef(vram)
+festation::Renderer::Renderer(const std::vector<uint16_t>& vram, const std::filesystem::path& shadersPath)
+    : m_flatColorShader(IShader::createUnique(shadersPath / "flat_color.glsl.vert",
+        shadersPath / "flat_color.glsl.frag")), m_textureShader(IShader::createUnique(shadersPath / "texture.glsl.vert",
+            shadersPath / "texture.glsl.frag")), m_VAO(0), m_VBO(0), m_IBO(0), m_projection(glm::mat4(1)), m_indicesCount(0), m_vramRef(vram)
 {
     m_vramFramebuffer = IFramebuffer::createUnique({
         .size = VRAM_SIZE,
@@ -118,14 +121,21 @@ festation::Renderer::Renderer(const std::vector<uint16_t>& vram)
 
     glEnable(GL_SCISSOR_TEST);
 
+    glCreateBuffers(1, &m_vramReadbackBuffer);
+    glNamedBufferStorage(m_vramReadbackBuffer, VRAM_SIZE_BYTES, nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+
     setClearColor({ 0.0f, 0.0f, 0.0f, 1.0f });
     clearDisplay();
 }
 
 festation::Renderer::~Renderer()
 {
+    if (m_vramReadbackFence)
+        glDeleteSync(m_vramReadbackFence);
+
     glDeleteBuffers(1, &m_VBO);
     glDeleteBuffers(1, &m_IBO);
+    glDeleteBuffers(1, &m_vramReadbackBuffer);
     glDeleteVertexArrays(1, &m_VAO);
 }
 
@@ -188,6 +198,7 @@ auto festation::Renderer::uploadVramToGpu(const uint8_t* data, const glm::uvec2
     }
 
     m_vramFramebuffer->setData(data, offset, size);
+    m_vramGeneration++;
 }
 
 auto festation::Renderer::uploadVramToGpu(std::span<uint8_t> data, const glm::uvec2 &offset = { 0, 0 }, const glm::uvec2 &size = VRAM_SIZE) -> void
@@ -204,6 +215,45 @@ auto festation::Renderer::uploadVramToGpu(std::span<uint8_t> data, const glm::uv
     }
     
     m_vramFramebuffer->setData(data, offset, size);
+    m_vramGeneration++;
+}
+
+auto festation::Renderer::beginVramReadback() -> void
+{
+    flushBatch();
+
+    if (m_vramReadbackGeneration == m_vramGeneration)
+        return;
+
+    if (m_vramReadbackFence)
+        glDeleteSync(m_vramReadbackFence);
+
+    /** @brief With a pack buffer bound the pixels pointer is an offset into it, the call returns right away */
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_vramReadbackBuffer);
+    glGetTextureSubImage(m_vramFramebuffer->getColorAttachmentHandle(), 0, 0, 0, 0, VRAM_WIDTH, VRAM_HEIGHT, 1,
+        GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, VRAM_SIZE_BYTES, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_vramReadbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_vramReadbackGeneration = m_vramGeneration;
+}
+
+auto festation::Renderer::downloadVramFromGpu(std::span<uint8_t> data) -> void
+{
+    beginVramReadback();
+
+    while (glClientWaitSync(m_vramReadbackFence, GL_SYNC_FLUSH_COMMANDS_BIT, VRAM_READBACK_WAIT_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED) {
+    }
+
+    glGetNamedBufferSubData(m_vramReadbackBuffer, 0, std::min(data.size(), VRAM_SIZE_BYTES), data.data());
+
+    size_t stride = VRAM_WIDTH * sizeof(uint16_t);
+
+    for (size_t y = 0; y < VRAM_HEIGHT / 2; y++) {
+        std::swap_ranges(data.begin() + y * stride, data.begin() + (y + 1) * stride, 
+            data.begin() + (VRAM_HEIGHT - y - 1) * stride);
+    }
 }
 
 void festation::Renderer::drawRectangle(const RectanglePrimitiveData &rectData)
@@ -385,6 +435,28 @@ auto festation::Renderer::drawPolygonTextured(const PolygonPrimitiveData &polygo
 
 auto festation::Renderer::renderBatch() -> void
 {
+    flushBatch();
+
+    if (m_outputMode != RenderOutputMode::Present)
+        return;
+
+    /** @brief Clearing default framebuffer first before blitting VRAM FBO */
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_vramFramebuffer->blitToSwapchain();
+    glEnable(GL_SCISSOR_TEST);
+}
+
+auto festation::Renderer::flushBatch() -> void
+{
+    if (m_outputMode == RenderOutputMode::Discard) {
+        m_vertices.clear();
+        m_indicesCount = 0;
+        return;
+    }
+
     if (!m_vertices.empty()) {
         m_vramFramebuffer->apply();
         glNamedBufferSubData(m_VBO, 0, sizeof(PrimitiveVertex) * m_vertices.size(), m_vertices.data());
@@ -405,13 +477,6 @@ auto festation::Renderer::renderBatch() -> void
         
         m_vertices.clear();
         m_indicesCount = 0;
+        m_vramGeneration++;
     }
-
-    /** @brief Clearing default framebuffer first before blitting VRAM FBO */
-    glDisable(GL_SCISSOR_TEST);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    m_vramFramebuffer->blitToSwapchain();
-    glEnable(GL_SCISSOR_TEST);
 }
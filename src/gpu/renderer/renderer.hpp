@@ -5,6 +5,7 @@
 #include "gpu/primitives_data.hpp"
 #include "framebuffer.hpp"
 
+#include <filesystem>
 #include <memory>
 #include <vector>
 #include <span>
@@ -24,9 +25,18 @@ namespace festation {
         ColorReserved = 3,
     };
 
+    enum class RenderOutputMode {
+        /** @brief Batches are drawn into VRAM and VRAM is blitted to the swapchain */
+        Present,
+        /** @brief Batches are drawn into VRAM only */
+        DrawOnly,
+        /** @brief Batches are dropped, for frames whose output is thrown away (run-ahead) */
+        Discard,
+    };
+
     class Renderer {
     public:
-        Renderer(const std::vector<uint16_t>& vram);
+        Renderer(const std::vector<uint16_t>& vram, const std::filesystem::path& shadersPath);
         ~Renderer();
 
         auto setClearColor(const glm::vec4& color) -> void;
@@ -44,6 +54,13 @@ namespace festation {
             const glm::uvec2& offset, const glm::uvec2& size) -> void;
         auto uploadVramToGpu(std::span<uint8_t> data, 
             const glm::uvec2& offset, const glm::uvec2& size) -> void;
+        /**
+         * @brief Starts copying VRAM into a pixel buffer without waiting for it. Nothing is copied again while
+         * VRAM doesn't change, downloadVramFromGpu() then only has to wait for the copy to be done.
+         */
+        auto beginVramReadback() -> void;
+        /** @brief Whole VRAM as drawn by the GPU, rows in PSX order (top to bottom) */
+        auto downloadVramFromGpu(std::span<uint8_t> data) -> void;
 
         auto drawRectangle(const RectanglePrimitiveData& rectData) -> void;
         auto drawRectangleTextured(const RectanglePrimitiveData& rectData, TexturePageColorsDepth colorDepth) -> void;
@@ -53,6 +70,13 @@ namespace festation {
 
         auto renderBatch() -> void;
 
+        auto setOutputMode(RenderOutputMode mode) -> void { m_outputMode = mode; }
+        auto getOutputMode() const -> RenderOutputMode { return m_outputMode; }
+
+    private:
+        /** @brief Draws the pending primitives into VRAM, renderBatch() without presenting */
+        auto flushBatch() -> void;
+
     private:
         std::unique_ptr<IShader> m_flatColorShader{};
         std::unique_ptr<IShader> m_textureShader{};
@@ -65,7 +89,11 @@ namespace festation {
         std::unique_ptr<ITexture> m_defaultWhiteTexture{};
         std::unique_ptr<ITexture> m_vramRawTexture{};
         const std::vector<uint16_t>& m_vramRef;
-
-        inline static std::filesystem::path SHADERS_PATH { std::filesystem::current_path().concat("/../../../res/shaders/") };
+        RenderOutputMode m_outputMode{ RenderOutputMode::Present };
+        GLuint m_vramReadbackBuffer{};
+        GLsync m_vramReadbackFence{};
+        /** @brief Bumped on every draw or upload into VRAM, tells whether the readback buffer is still current */
+        uint64_t m_vramGeneration{};
+        uint64_t m_vramReadbackGeneration{ UINT64_MAX };
     };
 };
@@ -37,6 +37,7 @@ namespace festation {
 
             virtual auto setData(const uint8_t *const buffer, const glm::uvec2& offset, const glm::uvec2& size) -> void = 0;
             virtual auto setData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) -> void = 0;
+            virtual auto getData(std::span<uint8_t> buffer, const glm::uvec2& offset, const glm::uvec2& size) const -> void = 0;
 
             auto getHandle() const -> uint32_t { return m_textureID; }
             auto getTextureInfo() const -> TextureInfo { return m_specification; }
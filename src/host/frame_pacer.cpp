@@ -0,0 +1,184 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <thread>
+
+namespace festation {
+    /** @brief Max deviation applied to the audio resampling ratio (0.5%, inaudible pitch shift) */
+    static constexpr double MAX_RESAMPLING_DELTA = 0.005;
+    static constexpr double AUDIO_TARGET_FILL = 0.5;
+    static constexpr double AUDIO_HIGH_WATERMARK = 0.75;
+    static constexpr auto AUDIO_POLL_INTERVAL = std::chrono::microseconds(250);
+};
+
+auto festation::FrameTimeHistogram::record(std::chrono::nanoseconds frameTime) -> void
+{
+    double frameTimeMs = std::chrono::duration<double, std::milli>(frameTime).count();
+    size_t bucket = std::min(static_cast<size_t>(frameTimeMs / BUCKET_WIDTH_MS), BUCKETS_COUNT - 1);
+
+    m_buckets[bucket]++;
+
+    if (m_samplesCount == 0) {
+        m_minMs = frameTimeMs;
+        m_maxMs = frameTimeMs;
+    }
+    else {
+        m_minMs = std::min(m_minMs, frameTimeMs);
+        m_maxMs = std::max(m_maxMs, frameTimeMs);
+    }
+
+    m_totalMs += frameTimeMs;
+    m_samplesCount++;
+}
+
+auto festation::FrameTimeHistogram::reset() -> void
+{
+    *this = FrameTimeHistogram();
+}
+
+auto festation::FrameTimeHistogram::getAverageMs() const -> double
+{
+    return (m_samplesCount > 0) ? m_totalMs / m_samplesCount : 0.0;
+}
+
+auto festation::FrameTimeHistogram::getPercentileMs(double p) const -> double
+{
+    if (m_samplesCount == 0)
+        return 0.0;
+
+    uint64_t threshold = static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * m_samplesCount));
+    uint64_t accumulated = 0;
+
+    for (size_t bucket = 0; bucket < BUCKETS_COUNT; bucket++) {
+        accumulated += m_buckets[bucket];
+
+        if (accumulated >= threshold && accumulated > 0) {
+            return std::min((bucket + 1) * BUCKET_WIDTH_MS, m_maxMs);
+        }
+    }
+
+    return m_maxMs;
+}
+
+auto festation::FrameTimeHistogram::toString() const -> std::string
+{
+    std::string result = std::format("Frame times ({} frames): avg {:.3f} ms | min {:.3f} ms | max {:.3f} ms | p50 {:.1f} ms | p99 {:.1f} ms",
+        m_samplesCount, getAverageMs(), m_minMs, m_maxMs, getPercentileMs(0.5), getPercentileMs(0.99));
+
+    for (size_t bucket = 0; bucket < BUCKETS_COUNT; bucket++) {
+        if (m_buckets[bucket] == 0)
+            continue;
+
+        result += std::format("\n  [{:5.1f}, {:5.1f}) ms: {}", bucket * BUCKET_WIDTH_MS,
+            (bucket + 1) * BUCKET_WIDTH_MS, m_buckets[bucket]);
+    }
+
+    return result;
+}
+
+festation::FramePacer::FramePacer(double targetFrameRate)
+{
+    setTargetFrameRate(targetFrameRate);
+
+    m_lastFrameEnd = Clock::now();
+    m_nextDeadline = m_lastFrameEnd + m_frameDuration;
+}
+
+auto festation::FramePacer::setMode(FramePacingMode mode) -> void
+{
+    m_mode = mode;
+    m_resamplingRatio = 1.0;
+    m_nextDeadline = Clock::now() + m_frameDuration;
+}
+
+auto festation::FramePacer::setTargetFrameRate(double frameRate) -> void
+{
+    m_frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frameRate));
+}
+
+auto festation::FramePacer::waitForNextFrame() -> void
+{
+    switch (m_mode)
+    {
+    case FramePacingMode::HighResolutionDeadline:
+        waitForDeadline(Clock::now());
+        break;
+    case FramePacingMode::AudioDriven:
+        if (m_audioStatusQuery) {
+            waitForAudioBuffer();
+        }
+        else {
+            waitForDeadline(Clock::now());
+        }
+        break;
+    case FramePacingMode::Uncapped:
+        break;
+    }
+
+    recordFrameEnd();
+}
+
+auto festation::FramePacer::waitUntil(Clock::time_point deadline) -> void
+{
+    Clock::time_point now = Clock::now();
+
+    /** @brief Sleeping is only accurate to the OS timer slack, so the last stretch is spun */
+    if (deadline - now > m_spinThreshold) {
+        std::this_thread::sleep_until(deadline - m_spinThreshold);
+    }
+
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+auto festation::FramePacer::waitForDeadline(Clock::time_point now) -> void
+{
+    /** @brief Too far behind (e.g. window dragged or breakpoint): resync instead of fast-forwarding to catch up */
+    if (now > m_nextDeadline + m_frameDuration) {
+        m_nextDeadline = now;
+    }
+    else {
+        waitUntil(m_nextDeadline);
+    }
+
+    /** @brief Deadlines are absolute so rounding errors don't accumulate frame after frame */
+    m_nextDeadline += m_frameDuration;
+}
+
+auto festation::FramePacer::waitForAudioBuffer() -> void
+{
+    AudioBufferStatus status = m_audioStatusQuery();
+
+    if (status.capacityFrames == 0) {
+        waitForDeadline(Clock::now());
+        return;
+    }
+
+    double fill = static_cast<double>(status.queuedFrames) / status.capacityFrames;
+
+    /** @brief Audio device consumes samples at its own pace, block while it still has plenty buffered */
+    const Clock::time_point timeout = Clock::now() + 2 * m_frameDuration;
+
+    while (fill > AUDIO_HIGH_WATERMARK && Clock::now() < timeout) {
+        waitUntil(Clock::now() + AUDIO_POLL_INTERVAL);
+        status = m_audioStatusQuery();
+        fill = static_cast<double>(status.queuedFrames) / status.capacityFrames;
+    }
+
+    /** @brief Dynamic rate control: stretch or shrink the produced audio slightly to converge to the target fill */
+    double fillError = (AUDIO_TARGET_FILL - fill) / AUDIO_TARGET_FILL;
+    m_resamplingRatio = 1.0 + std::clamp(fillError, -1.0, 1.0) * MAX_RESAMPLING_DELTA;
+
+    m_nextDeadline = Clock::now() + m_frameDuration;
+}
+
+auto festation::FramePacer::recordFrameEnd() -> void
+{
+    Clock::time_point now = Clock::now();
+    m_lastFrameTime = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lastFrameEnd);
+    m_lastFrameEnd = now;
+    m_histogram.record(m_lastFrameTime);
+}
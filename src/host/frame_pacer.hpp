@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace festation {
+    enum class FramePacingMode {
+        HighResolutionDeadline,
+        AudioDriven,
+        Uncapped,
+    };
+
+    class FrameTimeHistogram {
+    public:
+        static constexpr size_t BUCKETS_COUNT = 100;
+        static constexpr double BUCKET_WIDTH_MS = 0.5;
+
+        auto record(std::chrono::nanoseconds frameTime) -> void;
+        auto reset() -> void;
+
+        auto getSamplesCount() const -> uint64_t { return m_samplesCount; }
+        auto getBuckets() const -> const std::array<uint64_t, BUCKETS_COUNT>& { return m_buckets; }
+        auto getAverageMs() const -> double;
+        auto getMinMs() const -> double { return m_minMs; }
+        auto getMaxMs() const -> double { return m_maxMs; }
+
+        /** @brief Upper bound (in ms) of the bucket holding the requested percentile, p in [0, 1] */
+        auto getPercentileMs(double p) const -> double;
+
+        auto toString() const -> std::string;
+
+    private:
+        /** @brief Last bucket also accumulates every frame longer than the histogram range */
+        std::array<uint64_t, BUCKETS_COUNT> m_buckets{};
+        uint64_t m_samplesCount{};
+        double m_totalMs{};
+        double m_minMs{};
+        double m_maxMs{};
+    };
+
+    struct AudioBufferStatus {
+        size_t queuedFrames;
+        size_t capacityFrames;
+    };
+
+    class FramePacer {
+        using Clock = std::chrono::steady_clock;
+
+    public:
+        using AudioStatusQuery = std::function<AudioBufferStatus(void)>;
+
+        FramePacer(double targetFrameRate);
+
+        auto setMode(FramePacingMode mode) -> void;
+        auto getMode() const -> FramePacingMode { return m_mode; }
+
+        auto setTargetFrameRate(double frameRate) -> void;
+
+        /** @brief Remaining time to the deadline that is slept; the rest is spun to avoid OS timer slack */
+        auto setSpinThreshold(std::chrono::nanoseconds threshold) -> void { m_spinThreshold = threshold; }
+
+        /** @brief Audio backend hook used by AudioDriven mode (falls back to deadline pacing while unset) */
+        auto setAudioStatusQuery(AudioStatusQuery query) -> void { m_audioStatusQuery = std::move(query); }
+
+        /** @brief Blocks until the next frame is due. Call once per presented frame. */
+        auto waitForNextFrame() -> void;
+
+        /** @brief Ratio the audio resampler should apply (output rate / input rate) to keep its buffer half full */
+        auto getResamplingRatio() const -> double { return m_resamplingRatio; }
+
+        auto getLastFrameTime() const -> std::chrono::nanoseconds { return m_lastFrameTime; }
+        auto getHistogram() const -> const FrameTimeHistogram& { return m_histogram; }
+        auto resetHistogram() -> void { m_histogram.reset(); }
+
+    private:
+        auto waitUntil(Clock::time_point deadline) -> void;
+        auto waitForDeadline(Clock::time_point now) -> void;
+        auto waitForAudioBuffer() -> void;
+        auto recordFrameEnd() -> void;
+
+    private:
+        FramePacingMode m_mode{ FramePacingMode::HighResolutionDeadline };
+        Clock::duration m_frameDuration{};
+        std::chrono::nanoseconds m_spinThreshold{ std::chrono::microseconds(1500) };
+        Clock::time_point m_nextDeadline{};
+        Clock::time_point m_lastFrameEnd{};
+        std::chrono::nanoseconds m_lastFrameTime{};
+        AudioStatusQuery m_audioStatusQuery{};
+        double m_resamplingRatio{ 1.0 };
+        FrameTimeHistogram m_histogram{};
+    };
+};
@@ -0,0 +1,316 @@
+#include "instance_runner.hpp"
+#include "psx_system.hpp"
+#include "utils/logger.hpp"
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#elif defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace festation {
+    /** @brief How many slices a session may get ahead of a queued one on another worker before it's stolen */
+    static constexpr uint64_t FAIRNESS_SLACK_SLICES = 2;
+
+    static auto pinCurrentThreadToCpu(uint32_t cpu) -> void
+    {
+#if defined(__linux__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+            LOG_WARN("Couldn't pin worker thread to CPU {}", cpu);
+#elif defined(_WIN32)
+        if (!SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu))
+            LOG_WARN("Couldn't pin worker thread to CPU {}", cpu);
+#else
+        (void)cpu;
+#endif
+    }
+};
+
+festation::InstanceRunner::InstanceRunner(const InstanceRunnerConfig& config)
+    : m_workersCount((config.workersCount != 0) ? config.workersCount : std::max(std::thread::hardware_concurrency(), 1u)),
+        m_framesPerSlice(std::max(config.framesPerSlice, 1u)), m_pinWorkersToCpus(config.pinWorkersToCpus)
+{
+    for (uint32_t i = 0; i < m_workersCount; i++) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    for (uint32_t i = 0; i < m_workersCount; i++) {
+        m_workers.emplace_back([this, i](std::stop_token stopToken) {
+            workerLoop(stopToken, i);
+        });
+    }
+}
+
+festation::InstanceRunner::~InstanceRunner()
+{
+    stop();
+
+    for (std::jthread& worker : m_workers) {
+        worker.request_stop();
+    }
+
+    m_workAvailable.notify_all();
+}
+
+auto festation::InstanceRunner::addSession(PSXSystem& system, SessionOptions options) -> SessionId
+{
+    std::optional<uint32_t> preferredWorker{};
+
+    if (options.preferredCpu) {
+        preferredWorker = *options.preferredCpu % getWorkersCount();
+    }
+
+    SessionId id;
+
+    {
+        std::scoped_lock lock(m_sessionsMutex);
+        id = static_cast<SessionId>(m_sessions.size());
+        m_sessions.push_back(std::make_unique<Session>(system, std::move(options), preferredWorker, 0, SessionStats{}));
+    }
+
+    m_activeSessions++;
+
+    /** @brief Unpinned sessions are spread round-robin, stealing evens out whatever is left */
+    queueSession(id, preferredWorker.value_or(id % getWorkersCount()));
+
+    return id;
+}
+
+auto festation::InstanceRunner::waitUntilFinished() -> void
+{
+    std::unique_lock lock(m_idleMutex);
+    m_sessionsFinished.wait(lock, [this]() { return m_activeSessions == 0; });
+}
+
+auto festation::InstanceRunner::stop() -> void
+{
+    m_isStopping = true;
+    waitUntilFinished();
+}
+
+auto festation::InstanceRunner::getSessionStats(SessionId id) const -> SessionStats
+{
+    const Session& session = getSession(id);
+
+    std::scoped_lock lock(m_statsMutex);
+    return session.stats;
+}
+
+auto festation::InstanceRunner::getFairnessIndex() const -> double
+{
+    std::scoped_lock lock(m_sessionsMutex);
+
+    double sum = 0.0;
+    double squaresSum = 0.0;
+
+    for (const std::unique_ptr<Session>& session : m_sessions) {
+        const double frames = static_cast<double>(session->framesRun.load());
+        sum += frames;
+        squaresSum += frames * frames;
+    }
+
+    if (squaresSum == 0.0)
+        return 1.0;
+
+    return (sum * sum) / (m_sessions.size() * squaresSum);
+}
+
+auto festation::InstanceRunner::workerLoop(std::stop_token stopToken, uint32_t workerIndex) -> void
+{
+    if (m_pinWorkersToCpus) {
+        pinCurrentThreadToCpu(workerIndex);
+    }
+
+    while (!stopToken.stop_requested()) {
+        bool isStolen = false;
+
+        if (std::optional<SessionId> id = takeWork(workerIndex, isStolen)) {
+            runSlice(*id, workerIndex, isStolen);
+            continue;
+        }
+
+        std::unique_lock lock(m_idleMutex);
+
+        if (!m_workAvailable.wait(lock, stopToken, [this]() { return m_queuedSessions != 0; }))
+            break;
+    }
+}
+
+auto festation::InstanceRunner::takeWork(uint32_t workerIndex, bool& isStolen) -> std::optional<SessionId>
+{
+    WorkerQueue& queue = *m_queues[workerIndex];
+    std::optional<SessionId> ownId{};
+
+    {
+        std::scoped_lock lock(queue.mutex);
+
+        if (!queue.sessions.empty()) {
+            ownId = queue.sessions.front();
+            queue.sessions.pop_front();
+        }
+    }
+
+    if (!ownId) {
+        std::optional<SessionId> stolenId = stealWork(workerIndex, false);
+
+        if (!stolenId)
+            stolenId = stealWork(workerIndex, true);
+
+        isStolen = stolenId.has_value();
+        return stolenId;
+    }
+
+    if (std::optional<SessionId> laggingId = stealLaggingWork(workerIndex, getSession(*ownId).framesRun)) {
+        /** @brief Own session goes back in front, it never stopped counting as queued */
+        std::scoped_lock lock(queue.mutex);
+        queue.sessions.push_front(*ownId);
+
+        isStolen = true;
+        return laggingId;
+    }
+
+    m_queuedSessions--;
+    return ownId;
+}
+
+auto festation::InstanceRunner::stealWork(uint32_t workerIndex, bool allowPinned) -> std::optional<SessionId>
+{
+    const uint32_t workersCount = getWorkersCount();
+
+    for (uint32_t offset = 1; offset < workersCount; offset++) {
+        WorkerQueue& victim = *m_queues[(workerIndex + offset) % workersCount];
+        std::scoped_lock lock(victim.mutex);
+
+        /** @brief The back holds the sessions that would run last on the victim */
+        for (auto it = victim.sessions.rbegin(); it != victim.sessions.rend(); it++) {
+            if (!allowPinned && getSession(*it).preferredWorker)
+                continue;
+
+            const SessionId id = *it;
+            victim.sessions.erase(std::next(it).base());
+            m_queuedSessions--;
+            return id;
+        }
+    }
+
+    return std::nullopt;
+}
+
+auto festation::InstanceRunner::stealLaggingWork(uint32_t workerIndex, uint64_t framesRun) -> std::optional<SessionId>
+{
+    const uint64_t slack = FAIRNESS_SLACK_SLICES * m_framesPerSlice;
+
+    if (framesRun < slack)
+        return std::nullopt;
+
+    const uint32_t workersCount = getWorkersCount();
+
+    for (uint32_t offset = 1; offset < workersCount; offset++) {
+        WorkerQueue& victim = *m_queues[(workerIndex + offset) % workersCount];
+        std::scoped_lock lock(victim.mutex);
+
+        auto laggingIt = std::find_if(victim.sessions.begin(), victim.sessions.end(), [&](SessionId id) {
+            const Session& session = getSession(id);
+            return !session.preferredWorker && session.framesRun + slack < framesRun;
+        });
+
+        if (laggingIt != victim.sessions.end()) {
+            const SessionId id = *laggingIt;
+            victim.sessions.erase(laggingIt);
+            m_queuedSessions--;
+            return id;
+        }
+    }
+
+    return std::nullopt;
+}
+
+auto festation::InstanceRunner::runSlice(SessionId id, uint32_t workerIndex, bool isStolen) -> void
+{
+    Session& session = getSession(id);
+    const uint64_t framesRun = session.framesRun;
+    uint64_t framesCount = m_framesPerSlice;
+
+    if (session.options.framesToRun != 0) {
+        framesCount = std::min(framesCount, session.options.framesToRun - framesRun);
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    if (session.options.onSliceBegin)
+        session.options.onSliceBegin(session.system);
+
+    for (uint64_t frame = 0; frame < framesCount; frame++) {
+        session.system.runFrame();
+    }
+
+    const bool shouldContinue = !session.options.onSliceEnd || session.options.onSliceEnd(session.system);
+    const auto busyTime = std::chrono::steady_clock::now() - startTime;
+
+    session.framesRun = framesRun + framesCount;
+
+    const bool isFinished = !shouldContinue || m_isStopping ||
+        (session.options.framesToRun != 0 && session.framesRun >= session.options.framesToRun);
+
+    {
+        std::scoped_lock lock(m_statsMutex);
+        session.stats.framesRun = session.framesRun;
+        session.stats.slicesRun++;
+        session.stats.slicesStolen += isStolen ? 1 : 0;
+        session.stats.busyTime += std::chrono::duration_cast<std::chrono::nanoseconds>(busyTime);
+        session.stats.isFinished = isFinished;
+    }
+
+    if (isFinished) {
+        finishSession();
+        return;
+    }
+
+    /** @brief Pinned sessions go home after being stolen, the others stay where they ran (warm caches) */
+    queueSession(id, session.preferredWorker.value_or(workerIndex));
+}
+
+auto festation::InstanceRunner::queueSession(SessionId id, uint32_t workerIndex) -> void
+{
+    WorkerQueue& queue = *m_queues[workerIndex];
+
+    {
+        std::scoped_lock lock(queue.mutex);
+        queue.sessions.push_back(id);
+    }
+
+    m_queuedSessions++;
+
+    {
+        std::scoped_lock lock(m_idleMutex);
+    }
+
+    m_workAvailable.notify_one();
+}
+
+auto festation::InstanceRunner::finishSession() -> void
+{
+    {
+        std::scoped_lock lock(m_idleMutex);
+        m_activeSessions--;
+    }
+
+    m_sessionsFinished.notify_all();
+}
+
+auto festation::InstanceRunner::getSession(SessionId id) const -> Session&
+{
+    std::scoped_lock lock(m_sessionsMutex);
+    assert(id < m_sessions.size());
+    return *m_sessions[id];
+}
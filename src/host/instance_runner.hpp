@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace festation {
+    class PSXSystem;
+
+    using SessionId = uint32_t;
+
+    struct SessionOptions {
+        /** @brief Hint to keep the session on one worker (worker = CPU % workers count). Other workers only
+         * take it when they run out of unpinned sessions */
+        std::optional<uint32_t> preferredCpu;
+        /** @brief 0 runs the session until onSliceEnd finishes it */
+        uint64_t framesToRun;
+        /** @brief Both run on the worker thread around every slice, e.g. to make the instance's GL context current.
+         * Returning false from onSliceEnd finishes the session */
+        std::function<void(PSXSystem&)> onSliceBegin;
+        std::function<bool(PSXSystem&)> onSliceEnd;
+    };
+
+    struct SessionStats {
+        uint64_t framesRun;
+        uint64_t slicesRun;
+        /** @brief Slices run by a worker other than the one the session was queued on */
+        uint64_t slicesStolen;
+        std::chrono::nanoseconds busyTime;
+        bool isFinished;
+    };
+
+    struct InstanceRunnerConfig {
+        /** @brief 0 uses one worker per hardware thread */
+        uint32_t workersCount;
+        uint32_t framesPerSlice;
+        /** @brief Pins worker N to CPU N, which turns SessionOptions::preferredCpu into a real affinity */
+        bool pinWorkersToCpus;
+    };
+
+    /**
+     * @brief Runs many independent PSXSystem instances on a pool of workers, a frame-sized slice at a time.
+     * Every worker owns a queue of sessions and round-robins it; idle workers steal from the back of the
+     * others' queues, and busy ones also steal a session lagging too many frames behind their own so a
+     * worker with fewer sessions doesn't run them faster. Instances are owned by the caller and must
+     * outlive the runner.
+     */
+    class InstanceRunner {
+    public:
+        explicit InstanceRunner(const InstanceRunnerConfig& config);
+        ~InstanceRunner();
+
+        InstanceRunner(const InstanceRunner&) = delete;
+        InstanceRunner& operator=(const InstanceRunner&) = delete;
+
+        /** @brief Can be called while other sessions are running, the session starts right away */
+        auto addSession(PSXSystem& system, SessionOptions options) -> SessionId;
+
+        auto waitUntilFinished() -> void;
+        /** @brief Finishes every session after its current slice */
+        auto stop() -> void;
+
+        auto getWorkersCount() const -> uint32_t { return m_workersCount; }
+        auto getSessionStats(SessionId id) const -> SessionStats;
+        /** @brief Jain's fairness index over the frames run by each session, 1 when all of them got the same */
+        auto getFairnessIndex() const -> double;
+
+    private:
+        struct Session {
+            PSXSystem& system;
+            SessionOptions options;
+            std::optional<uint32_t> preferredWorker;
+            /** @brief Read by other workers to pick lagging sessions, everything else only by the one running it */
+            std::atomic<uint64_t> framesRun;
+            SessionStats stats;
+        };
+
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<SessionId> sessions;
+        };
+
+        auto workerLoop(std::stop_token stopToken, uint32_t workerIndex) -> void;
+        auto takeWork(uint32_t workerIndex, bool& isStolen) -> std::optional<SessionId>;
+        auto stealWork(uint32_t workerIndex, bool allowPinned) -> std::optional<SessionId>;
+        auto stealLaggingWork(uint32_t workerIndex, uint64_t framesRun) -> std::optional<SessionId>;
+        auto runSlice(SessionId id, uint32_t workerIndex, bool isStolen) -> void;
+        auto queueSession(SessionId id, uint32_t workerIndex) -> void;
+        auto finishSession() -> void;
+        auto getSession(SessionId id) const -> Session&;
+
+    private:
+        uint32_t m_workersCount;
+        uint32_t m_framesPerSlice;
+        bool m_pinWorkersToCpus;
+
+        mutable std::mutex m_sessionsMutex;
+        std::vector<std::unique_ptr<Session>> m_sessions{};
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues{};
+
+        std::mutex m_idleMutex;
+        std::condition_variable_any m_workAvailable;
+        std::condition_variable_any m_sessionsFinished;
+        std::atomic<uint32_t> m_queuedSessions{};
+        std::atomic<uint32_t> m_activeSessions{};
+        std::atomic<bool> m_isStopping{};
+
+        mutable std::mutex m_statsMutex;
+        std::vector<std::jthread> m_workers{};
+    };
+};
@@ -0,0 +1,160 @@
+#include "lockstep_harness.hpp"
+#include "psx_system.hpp"
+#include "cpu/cpu_masks_types_utils.hpp"
+
+#include <algorithm>
+#include <format>
+
+namespace festation {
+    /** @brief Straight-line code this long is compared anyway, so tight code without jumps still gets checked */
+    static constexpr uint32_t MAX_BLOCK_INSTRUCTIONS = 256;
+    static constexpr size_t COP0_REGISTERS_COUNT = 16;
+
+    static auto formatWrite(const TraceMemoryAccess& access) -> std::string
+    {
+        return std::format("W{}[{:08X}]={:0{}X}", access.size * 8, access.address, access.value, access.size * 2);
+    }
+};
+
+festation::LockstepHarness::LockstepHarness(PSXSystem& reference, PSXSystem& candidate, const LockstepConfig& config)
+    : m_reference(reference), m_candidate(candidate), m_config(config)
+{
+}
+
+festation::LockstepHarness::~LockstepHarness()
+{
+    m_reference.getCpu().setMemoryWriteLog(nullptr);
+    m_candidate.getCpu().setMemoryWriteLog(nullptr);
+}
+
+auto festation::LockstepHarness::run() -> LockstepResult
+{
+    LockstepResult result{ .instructionsCompared = 0, .blocksCompared = 0, .divergence = std::nullopt };
+
+    std::vector<uint8_t> state;
+    m_reference.saveState(state);
+
+    if (!m_candidate.loadState(state)) {
+        result.divergence = "The candidate machine couldn't load the reference's state";
+        return result;
+    }
+
+    m_reference.getCpu().setMemoryWriteLog(&m_referenceWrites);
+    m_candidate.getCpu().setMemoryWriteLog(&m_candidateWrites);
+    m_lastBlocks.clear();
+
+    uint64_t referenceInstructions = 0;
+    uint64_t candidateInstructions = 0;
+
+    while (referenceInstructions < m_config.maxInstructions) {
+        const uint32_t startPc = m_reference.getCpu().getCPURegs().pc;
+        const uint64_t firstInstruction = referenceInstructions;
+
+        referenceInstructions += runReferenceBlock();
+
+        // A block based candidate may overshoot, the reference then catches up until both meet again
+        while (candidateInstructions != referenceInstructions) {
+            if (candidateInstructions < referenceInstructions)
+                candidateInstructions += m_candidate.run();
+            else
+                referenceInstructions += m_reference.run();
+        }
+
+        m_lastBlocks.push_back({ firstInstruction, startPc, static_cast<uint32_t>(referenceInstructions - firstInstruction) });
+
+        if (m_lastBlocks.size() > m_config.contextBlocks + 1)
+            m_lastBlocks.pop_front();
+
+        if (auto differences = compareMachines()) {
+            result.instructionsCompared = referenceInstructions;
+            result.divergence = buildReport(*differences);
+            return result;
+        }
+
+        m_referenceWrites.clear();
+        m_candidateWrites.clear();
+        result.blocksCompared++;
+    }
+
+    result.instructionsCompared = referenceInstructions;
+    return result;
+}
+
+auto festation::LockstepHarness::runReferenceBlock() -> uint32_t
+{
+    const PSXRegs& regs = m_reference.getCpu().getCPURegs();
+    uint32_t instructions = 0;
+
+    do {
+        instructions += m_reference.run();
+    } while (regs.pc == regs.currentPC + 4 && instructions < MAX_BLOCK_INSTRUCTIONS);
+
+    return instructions;
+}
+
+auto festation::LockstepHarness::compareMachines() const -> std::optional<std::string>
+{
+    MIPS_R3000A_Core& referenceCpu = m_reference.getCpu();
+    MIPS_R3000A_Core& candidateCpu = m_candidate.getCpu();
+    const PSXRegs& referenceRegs = referenceCpu.getCPURegs();
+    const PSXRegs& candidateRegs = candidateCpu.getCPURegs();
+    std::string differences;
+
+    auto compare = [&differences](std::string_view name, uint32_t referenceValue, uint32_t candidateValue) {
+        if (referenceValue != candidateValue)
+            differences += std::format("  {:<10} reference {:08X}  candidate {:08X}\n", name, referenceValue, candidateValue);
+    };
+
+    compare("pc", referenceRegs.pc, candidateRegs.pc);
+    compare("hi", referenceRegs.hi, candidateRegs.hi);
+    compare("lo", referenceRegs.lo, candidateRegs.lo);
+
+    for (size_t i = 1; i < GprRegs_Count; i++) {
+        compare(g_registerNames[i], referenceRegs.gpr_regs[i], candidateRegs.gpr_regs[i]);
+    }
+
+    compare("load delay", referenceRegs.isLoadDelaySlot() ? referenceRegs.getLoadReg() : 0xFFFFFFFF,
+        candidateRegs.isLoadDelaySlot() ? candidateRegs.getLoadReg() : 0xFFFFFFFF);
+
+    for (size_t i = 0; i < COP0_REGISTERS_COUNT; i++) {
+        compare(std::format("cop0r{}", i), referenceCpu.getCOP0Regs().getCop0RegisterValue(i),
+            candidateCpu.getCOP0Regs().getCop0RegisterValue(i));
+    }
+
+    if (m_referenceWrites != m_candidateWrites) {
+        const auto [referenceWrite, candidateWrite] = std::mismatch(m_referenceWrites.begin(), m_referenceWrites.end(),
+            m_candidateWrites.begin(), m_candidateWrites.end());
+
+        differences += std::format("  writes     reference {}  candidate {} (write #{} of the block)\n",
+            referenceWrite != m_referenceWrites.end() ? formatWrite(*referenceWrite) : "none",
+            candidateWrite != m_candidateWrites.end() ? formatWrite(*candidateWrite) : "none",
+            referenceWrite - m_referenceWrites.begin());
+    }
+
+    if (differences.empty())
+        return std::nullopt;
+
+    return differences;
+}
+
+auto festation::LockstepHarness::buildReport(const std::string& differences) const -> std::string
+{
+    const BlockInfo& block = m_lastBlocks.back();
+    std::string report = std::format("Divergence in the block at {:08X} (instructions {} to {}):\n{}", block.startPc,
+        block.firstInstruction, block.firstInstruction + block.instructionsCount, differences);
+
+    report += "Previous blocks:\n";
+
+    for (size_t i = 0; i + 1 < m_lastBlocks.size(); i++) {
+        report += std::format("  {:08X}  {} instructions from #{}\n", m_lastBlocks[i].startPc, m_lastBlocks[i].instructionsCount,
+            m_lastBlocks[i].firstInstruction);
+    }
+
+    report += "Block writes (reference):\n";
+
+    for (const TraceMemoryAccess& write : m_referenceWrites) {
+        report += std::format("  {}\n", formatWrite(write));
+    }
+
+    return report;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "cpu/execution_trace.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace festation {
+    class PSXSystem;
+
+    struct LockstepConfig {
+        uint64_t maxInstructions;
+        /** @brief Blocks listed before the divergent one in the report */
+        size_t contextBlocks;
+    };
+
+    struct LockstepResult {
+        uint64_t instructionsCompared;
+        uint64_t blocksCompared;
+        /** @brief Report of the first divergence, nullopt if both machines stayed in sync */
+        std::optional<std::string> divergence;
+    };
+
+    /**
+     * @brief Differential testing of CPU backends: the candidate machine starts from the reference's
+     * state and both run side by side. Whenever both have executed the same number of instructions and
+     * the reference just ended a block (non-sequential PC), CPU registers, COP0 registers and the memory
+     * writes of the block are compared.
+     */
+    class LockstepHarness {
+    public:
+        LockstepHarness(PSXSystem& reference, PSXSystem& candidate, const LockstepConfig& config);
+        ~LockstepHarness();
+
+        auto run() -> LockstepResult;
+
+    private:
+        struct BlockInfo {
+            uint64_t firstInstruction;
+            uint32_t startPc;
+            uint32_t instructionsCount;
+        };
+
+        auto runReferenceBlock() -> uint32_t;
+        auto compareMachines() const -> std::optional<std::string>;
+        auto buildReport(const std::string& differences) const -> std::string;
+
+    private:
+        PSXSystem& m_reference;
+        PSXSystem& m_candidate;
+        LockstepConfig m_config;
+
+        std::vector<TraceMemoryAccess> m_referenceWrites{};
+        std::vector<TraceMemoryAccess> m_candidateWrites{};
+        std::deque<BlockInfo> m_lastBlocks{};
+    };
+};
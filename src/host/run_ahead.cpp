@@ -0,0 +1,37 @@
+#include "run_ahead.hpp"
+#include "psx_system.hpp"
+#include "utils/logger.hpp"
+
+festation::RunAhead::RunAhead(PSXSystem& system, uint32_t framesAhead)
+    : m_system(system), m_framesAhead(framesAhead)
+{
+}
+
+auto festation::RunAhead::runFrame() -> void
+{
+    if (m_framesAhead == 0) {
+        m_system.runFrame();
+        return;
+    }
+
+    /** @brief Real frame: drawn so the snapshot holds the right VRAM, but not presented */
+    m_system.setOutputMode(RenderOutputMode::DrawOnly);
+    m_system.runFrame();
+
+    m_state.clear();
+    m_system.saveState(m_state);
+
+    m_system.setOutputMode(RenderOutputMode::Discard);
+
+    for (uint32_t frame = 1; frame < m_framesAhead; frame++) {
+        m_system.runFrame();
+    }
+
+    m_system.setOutputMode(RenderOutputMode::Present);
+    m_system.runFrame();
+
+    if (!m_system.loadState(m_state)) {
+        LOG_ERROR("Run-ahead: couldn't restore the snapshot, disabling it");
+        m_framesAhead = 0;
+    }
+}
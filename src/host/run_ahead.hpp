@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace festation {
+    class PSXSystem;
+
+    /**
+     * @brief Hides part of the game's own input lag: each host frame the real frame is emulated and
+     * snapshotted, the machine then runs framesAhead more frames (only the last one is presented)
+     * and is restored to the snapshot. Costs framesAhead + 1 emulated frames per host frame.
+     */
+    class RunAhead {
+    public:
+        RunAhead(PSXSystem& system, uint32_t framesAhead = 0);
+
+        auto setFramesAhead(uint32_t framesAhead) -> void { m_framesAhead = framesAhead; }
+        auto getFramesAhead() const -> uint32_t { return m_framesAhead; }
+
+        auto runFrame() -> void;
+
+    private:
+        PSXSystem& m_system;
+        uint32_t m_framesAhead;
+        /** @brief Reused every frame, keeps snapshots allocation free after the first one */
+        std::vector<uint8_t> m_state{};
+    };
+};
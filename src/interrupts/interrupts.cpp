@@ -1,4 +1,6 @@
 #include "interrupts.hpp"
+#include "savestate/state_serializer.hpp"
+
 #include <utility>
 
 auto festation::InterruptsHandler::read16(uint32_t address) -> uint16_t
@@ -52,6 +54,8 @@ auto festation::InterruptsHandler::write16(uint32_t address, uint16_t value) ->
     default:
         std::unreachable();
     }
+
+    updateLine();
 }
 
 auto festation::InterruptsHandler::write32(uint32_t address, uint32_t value) -> void
@@ -67,14 +71,47 @@ auto festation::InterruptsHandler::write32(uint32_t address, uint32_t value) ->
     default:
         std::unreachable();
     }
+
+    updateLine();
 }
 
 auto festation::InterruptsHandler::setInterruptSource(festation::InterruptSource source) -> void
 {
     I_STAT.raw |= source;
+    updateLine();
 }
 
-auto festation::InterruptsHandler::isInterruptPending() const -> bool
+auto festation::InterruptsHandler::updateLine() -> void
 {
-    return I_STAT.raw & I_MASK.raw & 0x7FF;
+    const bool isLineAsserted = (I_STAT.raw & I_MASK.raw & 0x7FF) != 0;
+
+    if (isLineAsserted == m_isLineAsserted)
+        return;
+
+    m_isLineAsserted = isLineAsserted;
+
+    if (m_lineChangedCallback)
+        m_lineChangedCallback();
+}
+
+auto festation::InterruptsHandler::reset() -> void
+{
+    I_STAT.raw = 0;
+    I_MASK.raw = 0;
+    updateLine();
+}
+
+auto festation::InterruptsHandler::serialize(StateSerializer& serializer) -> void
+{
+    uint32_t version = 1;
+
+    if (!serializer.beginSection(makeSectionTag("INTC"), version))
+        return;
+
+    serializer.doValue(I_STAT.raw);
+    serializer.doValue(I_MASK.raw);
+    serializer.endSection();
+
+    if (serializer.isLoading())
+        updateLine();
 }
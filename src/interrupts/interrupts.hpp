@@ -1,8 +1,12 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <utility>
 
 namespace festation {
+    class StateSerializer;
+
     enum InterruptSource {
         VBlankSrc = (1 << 0),
         GpuSrc = (1 << 1),
@@ -28,7 +32,16 @@ namespace festation {
         auto write32(uint32_t address, uint32_t value) -> void;
     
         auto setInterruptSource(InterruptSource source) -> void;
-        auto isInterruptPending() const -> bool;
+        auto reset() -> void;
+        /** @brief I_STAT & I_MASK, cached: it's what the CPU sees in CAUSE bit 10 */
+        auto isInterruptPending() const -> bool { return m_isLineAsserted; }
+        /** @brief Called when the interrupt line to the CPU goes up or down, so it doesn't have to poll it */
+        auto setLineChangedCallback(std::function<void(void)> callback) -> void { m_lineChangedCallback = std::move(callback); }
+
+        auto serialize(StateSerializer& serializer) -> void;
+
+    private:
+        auto updateLine() -> void;
 
     private:
         union {
@@ -70,5 +83,8 @@ namespace festation {
 
             uint32_t raw;
         } I_MASK{};
+
+        bool m_isLineAsserted{};
+        std::function<void(void)> m_lineChangedCallback;
     };
 };
@@ -2,30 +2,18 @@
 #include "tty.hpp"
 #include "cpu/psx_cw33300_cpu.hpp"
 #include "cpu/cpu_masks_types_utils.hpp"
-#include "utils/file_reader.hpp"
 
 #include <filesystem>
-#include <fstream>
 #include <cassert>
 
 static constexpr size_t R9 = festation::GprRegs::t1;
 static constexpr size_t R4 = festation::GprRegs::a0;
 
-namespace festation
-{
-    static constexpr const uint32_t BIOS_SIZE = 512 * 1024;
-};
-
-festation::KernelBIOS::KernelBIOS(MIPS_R3000A_Core& _cpu)
-    : KernelBIOS(_cpu, std::filesystem::path(std::filesystem::current_path().string() + "/../../../res/bios/SCPH1001.BIN"))
-{
-
-}
-
-festation::KernelBIOS::KernelBIOS(MIPS_R3000A_Core& _cpu, const std::filesystem::path &filename)
-    : cpu(_cpu)
+festation::KernelBIOS::KernelBIOS(MIPS_R3000A_Core& _cpu, std::span<uint8_t> mainRAM, CdromDrive& cdrom, const std::filesystem::path &filename)
+    : cpu(_cpu), hle(_cpu, mainRAM, cdrom, tty)
 {
     loadBIOSROMFile(filename);
+    registerKernelHooks();
 }
 
 uint8_t festation::KernelBIOS::read8(uint32_t address)
@@ -35,56 +23,73 @@ uint8_t festation::KernelBIOS::read8(uint32_t address)
 
 uint16_t festation::KernelBIOS::read16(uint32_t address)
 {
-    return *(uint16_t*)&biosROM[address];
+    return *(const uint16_t*)&biosROM[address];
 }
 
 uint32_t festation::KernelBIOS::read32(uint32_t address)
 {
-    return *(uint32_t*)&biosROM[address];
+    return *(const uint32_t*)&biosROM[address];
 }
 
-void festation::KernelBIOS::write8(uint32_t address, uint8_t value)
+// The ROM is read-only on hardware and the image is shared between machines, writes are dropped
+
+void festation::KernelBIOS::write8(uint32_t, uint8_t)
 {
-    biosROM[address] = value;
 }
 
-void festation::KernelBIOS::write16(uint32_t address, uint16_t value)
+void festation::KernelBIOS::write16(uint32_t, uint16_t)
 {
-    *(uint16_t*)&biosROM[address] = value;
 }
 
-void festation::KernelBIOS::write32(uint32_t address, uint32_t value)
+void festation::KernelBIOS::write32(uint32_t, uint32_t)
 {
-    *(uint32_t*)&biosROM[address] = value;
 }
 
 bool festation::KernelBIOS::loadBIOSROMFile(const std::filesystem::path &filename)
 {
-    std::ifstream file;
+    std::shared_ptr<const BiosImage> image = BiosImageCache::acquire(filename);
 
-    file.open(filename, std::ios::in | std::ios::binary);
+    assert(image && "Provided BIOS ROM file couldn't be loaded or isn't a proper PSX BIOS file (512KB)!");
 
-    if (file.is_open())
-    {
-        std::vector<char> buffer = readFile<char>(std::filesystem::path(filename));
+    if (!image)
+        return false;
 
-        assert((buffer.size() == BIOS_SIZE) && "Provided BIOS ROM file doesn't match proper PSX BIOS file size (512KB)!");
+    biosImage = std::move(image);
+    biosROM = biosImage->data();
+
+    return true;
+}
 
-        biosROM = std::vector<uint8_t>(buffer.cbegin(), buffer.cend());
+void festation::KernelBIOS::registerKernelHooks()
+{
+    PcHooks& hooks = cpu.getPcHooks();
 
-        return true;
-    } 
+    hooks.add(0x000000A0, [this](uint32_t) { return hle.tryHandleCall(KernelVector::A0, cpu.getCPURegs().gpr_regs[R9]); });
+    hooks.add(0x000000B0, [this](uint32_t) { return hle.tryHandleCall(KernelVector::B0, cpu.getCPURegs().gpr_regs[R9]); });
+    hooks.add(0x000000C0, [this](uint32_t) { return hle.tryHandleCall(KernelVector::C0, cpu.getCPURegs().gpr_regs[R9]); });
 
-    return false;
+    hooks.add(0x000000A0, [this](uint32_t address) { return captureTTYOutput(address); });
+    hooks.add(0x000000B0, [this](uint32_t address) { return captureTTYOutput(address); });
 }
 
-void festation::KernelBIOS::checkKernerlTTYOutput()
+bool festation::KernelBIOS::captureTTYOutput(uint32_t vectorAddress)
 {
-    uint32_t masked_pc = cpu.getCPURegs().pc & 0x1FFFFFFF; // Only interested on the first 29 bits (any MIPS memory region)
     uint32_t r9FunctNumber = cpu.getCPURegs().gpr_regs[R9];
 
-    if ((masked_pc == 0x000000A0 && r9FunctNumber == 0x3C) || (masked_pc == 0x000000B0 && r9FunctNumber == 0x3D))
+    if ((vectorAddress == 0x000000A0 && r9FunctNumber == 0x3C) || (vectorAddress == 0x000000B0 && r9FunctNumber == 0x3D))
     {
-        kernel_putchar(cpu.getCPURegs().gpr_regs[R4] & 0x000000FF);
+        tty.kernel_putchar(cpu.getCPURegs().gpr_regs[R4] & 0x000000FF);
     }
+
+    return false;
+}
+
+void festation::KernelBIOS::reset()
+{
+    hle.reset();
+}
+
+void festation::KernelBIOS::serialize(StateSerializer& serializer)
+{
+    hle.serialize(serializer);
 }
@@ -1,19 +1,25 @@
 #pragma once
 
+#include "tty.hpp"
+#include "bios_image_cache.hpp"
+#include "kernel_hle.hpp"
+
 #include <cstdint>
 #include <string>
-#include <vector>
+#include <memory>
+#include <span>
 #include <filesystem>
 
 namespace festation
 {
     class MIPS_R3000A_Core;
+    class CdromDrive;
+    class StateSerializer;
 
     class KernelBIOS
     {
     public:
-        KernelBIOS(MIPS_R3000A_Core& cpu);
-        KernelBIOS(MIPS_R3000A_Core& cpu, const std::filesystem::path& filename);
+        KernelBIOS(MIPS_R3000A_Core& cpu, std::span<uint8_t> mainRAM, CdromDrive& cdrom, const std::filesystem::path& filename);
         ~KernelBIOS() = default;
 
         uint8_t read8(uint32_t address);
@@ -26,17 +32,25 @@ namespace festation
 
         bool loadBIOSROMFile(const std::filesystem::path& filename);
 
-        inline std::vector<uint8_t>& getBIOSData() { return biosROM; }
+        inline std::span<const uint8_t> getBIOSData() const { return biosROM; }
+        inline uint64_t getImageHash() const { return biosImage ? biosImage->getHash() : 0; }
 
-        void checkKernerlTTYOutput();
+        inline KernelHLE& getHLE() { return hle; }
 
-    // private:
-    //     void checkKernelAFunctions();
-    //     void checkKernelAFunctions();
-    //     void checkKernelAFunctions();
+        void reset();
+        void serialize(StateSerializer& serializer);
     
     private:
-        std::vector<uint8_t> biosROM;
+        /** @brief Registered on the CPU PC hooks, HLE first so calls it completes don't reach the TTY capture */
+        void registerKernelHooks();
+        bool captureTTYOutput(uint32_t vectorAddress);
+
+    private:
+        /** @brief Keeps the shared mapping alive, biosROM points into it */
+        std::shared_ptr<const BiosImage> biosImage;
+        std::span<const uint8_t> biosROM;
+        KernelTTY tty;
         MIPS_R3000A_Core& cpu;
+        KernelHLE hle;
     };
 };
@@ -0,0 +1,88 @@
+#include "bios_image_cache.hpp"
+#include "utils/logger.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace festation {
+    static constexpr size_t BIOS_IMAGE_SIZE = 512 * 1024;
+
+    static constexpr uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325;
+    static constexpr uint64_t FNV_PRIME = 0x100000001B3;
+
+    struct CachedPath {
+        std::weak_ptr<const BiosImage> image;
+        std::filesystem::file_time_type lastWriteTime;
+    };
+
+    static std::mutex s_cacheMutex;
+    static std::unordered_map<std::filesystem::path, CachedPath> s_imagesByPath;
+    static std::unordered_map<uint64_t, std::weak_ptr<const BiosImage>> s_imagesByHash;
+
+    static auto hashImage(std::span<const uint8_t> data) -> uint64_t
+    {
+        uint64_t hash = FNV_OFFSET_BASIS;
+
+        for (uint8_t byte : data) {
+            hash = (hash ^ byte) * FNV_PRIME;
+        }
+
+        return hash;
+    }
+};
+
+festation::BiosImage::BiosImage(MappedFile&& file, uint64_t hash)
+    : m_file(std::move(file)), m_hash(hash)
+{
+    const std::span<const std::byte> bytes = m_file.data();
+    m_data = { reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size() };
+}
+
+auto festation::BiosImageCache::acquire(const std::filesystem::path& path) -> std::shared_ptr<const BiosImage>
+{
+    std::error_code errorCode;
+    const std::filesystem::path key = std::filesystem::weakly_canonical(path, errorCode);
+    const std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(path, errorCode);
+
+    if (errorCode) {
+        LOG_ERROR("BIOS ROM file {} doesn't exist", path.string());
+        return nullptr;
+    }
+
+    std::scoped_lock lock(s_cacheMutex);
+
+    /** @brief Only hit while the file is untouched, a replaced ROM gets mapped again */
+    if (auto it = s_imagesByPath.find(key); it != s_imagesByPath.end() && it->second.lastWriteTime == lastWriteTime) {
+        if (std::shared_ptr<const BiosImage> image = it->second.image.lock())
+            return image;
+    }
+
+    MappedFile file;
+
+    if (!file.open(path)) {
+        LOG_ERROR("Couldn't map BIOS ROM file {}", path.string());
+        return nullptr;
+    }
+
+    if (file.size() != BIOS_IMAGE_SIZE) {
+        LOG_ERROR("BIOS ROM file {} doesn't match proper PSX BIOS file size (512KB)", path.string());
+        return nullptr;
+    }
+
+    /** @brief The whole ROM is hashed right away, so the read ahead also serves the first instructions */
+    file.willNeed(0, file.size());
+
+    const std::span<const std::byte> bytes = file.data();
+    const uint64_t hash = hashImage({ reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size() });
+
+    std::shared_ptr<const BiosImage> image = s_imagesByHash[hash].lock();
+
+    if (!image) {
+        image = std::make_shared<const BiosImage>(std::move(file), hash);
+        s_imagesByHash[hash] = image;
+    }
+
+    s_imagesByPath[key] = { .image = image, .lastWriteTime = lastWriteTime };
+
+    return image;
+}
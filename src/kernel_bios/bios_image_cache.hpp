@@ -0,0 +1,34 @@
+#pragma once
+
+#include "utils/mapped_file.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace festation {
+    /** @brief BIOS ROM mapped read-only, shared by every machine using the same image */
+    class BiosImage {
+    public:
+        BiosImage(MappedFile&& file, uint64_t hash);
+
+        auto data() const -> std::span<const uint8_t> { return m_data; }
+        auto getHash() const -> uint64_t { return m_hash; }
+
+    private:
+        MappedFile m_file;
+        std::span<const uint8_t> m_data;
+        uint64_t m_hash;
+    };
+
+    /**
+     * @brief Process-wide cache of BIOS images keyed by path and content hash. An image is mapped
+     * once and stays mapped while any machine holds it, identical files under different paths share a mapping.
+     */
+    class BiosImageCache {
+    public:
+        /** @brief Returns nullptr if the file can't be mapped or isn't a 512KB PSX BIOS */
+        static auto acquire(const std::filesystem::path& path) -> std::shared_ptr<const BiosImage>;
+    };
+};
@@ -0,0 +1,1001 @@
+#include "kernel_hle.hpp"
+#include "tty.hpp"
+#include "cdrom/cdrom.hpp"
+#include "cpu/psx_cw33300_cpu.hpp"
+#include "cpu/cpu_masks_types_utils.hpp"
+#include "memory/memory_map_masks.hpp"
+#include "savestate/state_serializer.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace festation
+{
+    static constexpr uint32_t HLE_ERROR = 0xFFFFFFFF;
+
+    /** @brief Kernel FCBs use fds 0-15, files opened natively are numbered after them */
+    static constexpr uint32_t FIRST_HLE_FILE_DESCRIPTOR = 16;
+    static constexpr size_t MAX_HLE_OPEN_FILES = 16;
+    static constexpr size_t CD_USER_DATA_SIZE = 2048;
+
+    enum SeekType : uint32_t
+    {
+        SEEK_FROM_START = 0,
+        SEEK_FROM_CURRENT = 1,
+    };
+
+    // Kernel tables, pointer and size (in bytes) of each array at a fixed address
+    static constexpr uint32_t TCB_ARRAY_POINTER_ADDRESS = 0x110;
+    static constexpr uint32_t TCB_ARRAY_SIZE_ADDRESS = 0x114;
+    static constexpr uint32_t EVCB_ARRAY_POINTER_ADDRESS = 0x120;
+    static constexpr uint32_t EVCB_ARRAY_SIZE_ADDRESS = 0x124;
+
+    static constexpr uint32_t TCB_SIZE = 0xC0;
+    static constexpr uint32_t TCB_STATUS_FREE = 0x1000;
+    static constexpr uint32_t THREAD_HANDLE_BASE = 0xFF000000;
+
+    static constexpr uint32_t EVCB_SIZE = 0x1C;
+    static constexpr uint32_t EVCB_CLASS_OFFSET = 0x00;
+    static constexpr uint32_t EVCB_STATUS_OFFSET = 0x04;
+    static constexpr uint32_t EVCB_SPEC_OFFSET = 0x08;
+    static constexpr uint32_t EVCB_MODE_OFFSET = 0x0C;
+    static constexpr uint32_t EVCB_FUNCTION_OFFSET = 0x10;
+    static constexpr uint32_t EVENT_HANDLE_BASE = 0xF1000000;
+
+    enum EventStatus : uint32_t
+    {
+        EVENT_STATUS_FREE = 0x0000,
+        EVENT_STATUS_DISABLED = 0x1000,
+        EVENT_STATUS_BUSY = 0x2000,
+        EVENT_STATUS_READY = 0x4000,
+    };
+
+    enum EventMode : uint32_t
+    {
+        EVENT_MODE_CALLBACK = 0x1000,
+        EVENT_MODE_READY = 0x2000,
+    };
+
+    /** @brief open/lseek/read/write/close/ioctl/isatty/getc/putc, HLE and BIOS fds can't be mixed within them */
+    static auto isFileFunction(KernelVector vector, uint32_t function) -> bool
+    {
+        switch (vector)
+        {
+        case KernelVector::A0:
+            return function <= 0x09 && function != 0x06;   // A(06h) is exit
+        case KernelVector::B0:
+            return function >= 0x32 && function <= 0x3B && function != 0x38;   // B(38h) is exit
+        default:
+            return false;
+        }
+    }
+
+    /** @brief Argument holding the fd of a file call, nullopt for open (takes a path) and the rest */
+    static auto getFileDescriptorArgument(KernelVector vector, uint32_t function) -> std::optional<size_t>
+    {
+        if (!isFileFunction(vector, function))
+            return std::nullopt;
+
+        const uint32_t index = (vector == KernelVector::A0) ? function : function - 0x32;
+
+        if (index == 0x00)
+            return std::nullopt;
+
+        return (index == 0x09) ? 1 : 0;     // putc(char, fd)
+    }
+
+    static auto toUpperAscii(uint8_t chr) -> uint8_t
+    {
+        return (chr >= 'a' && chr <= 'z') ? chr - ('a' - 'A') : chr;
+    }
+
+    static auto toLowerAscii(uint8_t chr) -> uint8_t
+    {
+        return (chr >= 'A' && chr <= 'Z') ? chr + ('a' - 'A') : chr;
+    }
+};
+
+festation::KernelHLE::KernelHLE(MIPS_R3000A_Core& cpu, std::span<uint8_t> mainRAM, CdromDrive& cdrom, KernelTTY& tty)
+    : m_cpu(cpu), m_mainRAM(mainRAM), m_cdrom(cdrom), m_tty(tty), m_openFiles(MAX_HLE_OPEN_FILES)
+{
+    for (auto& enabledFunctions : m_enabledFunctions) {
+        enabledFunctions.set();
+    }
+}
+
+auto festation::KernelHLE::tryHandleCall(KernelVector vector, uint32_t function) -> bool
+{
+    if (function >= KERNEL_FUNCTIONS_COUNT)
+        return false;
+
+    const size_t vectorIndex = std::to_underlying(vector);
+    const HleFunction handler = getFunctionTables()[vectorIndex][function];
+
+    /** @brief The BIOS doesn't know fds opened here, calls on them stay native even after HLE is switched off */
+    const std::optional<size_t> fdArgument = getFileDescriptorArgument(vector, function);
+    const bool isHleFileCall = fdArgument && getOpenFile(getArgument(*fdArgument)) != nullptr;
+
+    if (!handler || (!isHleFileCall && (!m_isEnabled || !m_enabledFunctions[vectorIndex][function])))
+        return false;
+
+    /** @brief Stores would land in the I-cache on hardware, the BIOS only does that while flushing it */
+    if (m_cpu.isCacheIsolated())
+        return false;
+
+    const std::optional<uint32_t> result = (this->*handler)();
+
+    if (!result)
+        return false;
+
+    PSXRegs& regs = m_cpu.getCPURegs();
+    const uint32_t returnAddress = getRegister(GprRegs::ra);
+
+    if (regs.isLoadDelaySlot())
+        regs.consumeLoadedData();
+
+    regs.gpr_regs[GprRegs::v0] = *result;
+    regs.pc = returnAddress;
+
+    return true;
+}
+
+auto festation::KernelHLE::setFunctionEnabled(KernelVector vector, uint8_t function, bool enabled) -> void
+{
+    if (!isFileFunction(vector, function)) {
+        m_enabledFunctions[std::to_underlying(vector)][function] = enabled;
+        return;
+    }
+
+    for (KernelVector fileVector : { KernelVector::A0, KernelVector::B0 }) {
+        for (uint32_t fileFunction = 0; fileFunction < KERNEL_FUNCTIONS_COUNT; fileFunction++) {
+            if (isFileFunction(fileVector, fileFunction))
+                m_enabledFunctions[std::to_underlying(fileVector)][fileFunction] = enabled;
+        }
+    }
+}
+
+auto festation::KernelHLE::isFunctionImplemented(KernelVector vector, uint8_t function) const -> bool
+{
+    return getFunctionTables()[std::to_underlying(vector)][function] != nullptr;
+}
+
+auto festation::KernelHLE::reset() -> void
+{
+    for (std::optional<OpenFile>& file : m_openFiles) {
+        file.reset();
+    }
+}
+
+auto festation::KernelHLE::serialize(StateSerializer& serializer) -> void
+{
+    uint32_t version = 1;
+
+    if (!serializer.beginSection(makeSectionTag("HLEK"), version))
+        return;
+
+    for (std::optional<OpenFile>& file : m_openFiles) {
+        bool isOpen = file.has_value();
+        serializer.doBool(isOpen);
+
+        if (!isOpen) {
+            file.reset();
+            continue;
+        }
+
+        std::vector<char> path = file ? std::vector<char>(file->path.begin(), file->path.end()) : std::vector<char>{};
+        uint32_t position = file ? file->position : 0;
+
+        serializer.doVector(path);
+        serializer.doValue(position);
+
+        if (serializer.isLoading()) {
+            file = OpenFile{ .path = std::string(path.begin(), path.end()), .data = {}, .position = position };
+
+            if (auto data = m_cdrom.readDiscFile(file->path)) {
+                file->data = std::move(*data);
+            }
+            else {
+                LOG_WARN("HLE kernel: {} can't be read from the inserted disc, it's left empty", file->path);
+            }
+        }
+    }
+
+    serializer.endSection();
+}
+
+auto festation::KernelHLE::getFunctionTables() -> const std::array<FunctionTable, KERNEL_VECTORS_COUNT>&
+{
+    static const std::array<FunctionTable, KERNEL_VECTORS_COUNT> tables = []() {
+        std::array<FunctionTable, KERNEL_VECTORS_COUNT> result{};
+        FunctionTable& a0 = result[std::to_underlying(KernelVector::A0)];
+        FunctionTable& b0 = result[std::to_underlying(KernelVector::B0)];
+
+        a0[0x00] = &KernelHLE::callOpen;
+        a0[0x01] = &KernelHLE::callLseek;
+        a0[0x02] = &KernelHLE::callRead;
+        a0[0x03] = &KernelHLE::callWrite;
+        a0[0x04] = &KernelHLE::callClose;
+        a0[0x05] = &KernelHLE::callIoctl;
+        a0[0x07] = &KernelHLE::callIsatty;
+        a0[0x08] = &KernelHLE::callGetc;
+        a0[0x09] = &KernelHLE::callPutc;
+        a0[0x15] = &KernelHLE::callStrcat;
+        a0[0x16] = &KernelHLE::callStrncat;
+        a0[0x17] = &KernelHLE::callStrcmp;
+        a0[0x18] = &KernelHLE::callStrncmp;
+        a0[0x19] = &KernelHLE::callStrcpy;
+        a0[0x1A] = &KernelHLE::callStrncpy;
+        a0[0x1B] = &KernelHLE::callStrlen;
+        a0[0x1C] = &KernelHLE::callStrchr;  // index
+        a0[0x1D] = &KernelHLE::callStrrchr; // rindex
+        a0[0x1E] = &KernelHLE::callStrchr;
+        a0[0x1F] = &KernelHLE::callStrrchr;
+        a0[0x25] = &KernelHLE::callToupper;
+        a0[0x26] = &KernelHLE::callTolower;
+        a0[0x27] = &KernelHLE::callBcopy;
+        a0[0x28] = &KernelHLE::callBzero;
+        a0[0x29] = &KernelHLE::callBcmp;
+        a0[0x2A] = &KernelHLE::callMemcpy;
+        a0[0x2B] = &KernelHLE::callMemset;
+        a0[0x3C] = &KernelHLE::callPutchar;
+        a0[0xA4] = &KernelHLE::callCdGetLbn;
+        a0[0xA5] = &KernelHLE::callCdReadSector;
+
+        b0[0x07] = &KernelHLE::callDeliverEvent;
+        b0[0x08] = &KernelHLE::callOpenEvent;
+        b0[0x09] = &KernelHLE::callCloseEvent;
+        b0[0x0A] = &KernelHLE::callWaitEvent;
+        b0[0x0B] = &KernelHLE::callTestEvent;
+        b0[0x0C] = &KernelHLE::callEnableEvent;
+        b0[0x0D] = &KernelHLE::callDisableEvent;
+        b0[0x0F] = &KernelHLE::callCloseThread;
+        b0[0x32] = &KernelHLE::callOpen;
+        b0[0x33] = &KernelHLE::callLseek;
+        b0[0x34] = &KernelHLE::callRead;
+        b0[0x35] = &KernelHLE::callWrite;
+        b0[0x36] = &KernelHLE::callClose;
+        b0[0x37] = &KernelHLE::callIoctl;
+        b0[0x39] = &KernelHLE::callIsatty;
+        b0[0x3A] = &KernelHLE::callGetc;
+        b0[0x3B] = &KernelHLE::callPutc;
+        b0[0x3D] = &KernelHLE::callPutchar;
+
+        return result;
+    }();
+
+    return tables;
+}
+
+auto festation::KernelHLE::getRegister(size_t index) const -> uint32_t
+{
+    /** @brief A load still in its delay slot (e.g. the jump's one) is visible to the callee's code */
+    const PSXRegs& regs = m_cpu.getCPURegs();
+
+    if (regs.isLoadDelaySlot() && regs.getLoadReg() == index)
+        return regs.getLoadValue();
+
+    return regs.gpr_regs[index];
+}
+
+auto festation::KernelHLE::getArgument(size_t index) const -> uint32_t
+{
+    return getRegister(GprRegs::a0 + index);
+}
+
+auto festation::KernelHLE::translate(uint32_t address, size_t size) const -> std::optional<size_t>
+{
+    const uint32_t physicalAddress = address & PHYSICAL_MEMORY_MASK;
+
+    if (physicalAddress > MAIN_RAM_END)
+        return std::nullopt;
+
+    const size_t offset = physicalAddress & MAIN_RAM_SIZE_MASK;
+
+    /** @brief Ranges wrapping around a RAM mirror are left to the BIOS code */
+    if (offset + size > m_mainRAM.size())
+        return std::nullopt;
+
+    return offset;
+}
+
+auto festation::KernelHLE::readString(uint32_t address) const -> std::optional<std::string_view>
+{
+    const std::optional<size_t> offset = translate(address, 1);
+
+    if (!offset)
+        return std::nullopt;
+
+    const auto start = m_mainRAM.begin() + *offset;
+    const auto end = std::find(start, m_mainRAM.end(), 0);
+
+    if (end == m_mainRAM.end())
+        return std::nullopt;
+
+    return std::string_view{ reinterpret_cast<const char*>(&*start), static_cast<size_t>(end - start) };
+}
+
+auto festation::KernelHLE::readFileName(uint32_t address) const -> std::optional<std::string_view>
+{
+    std::optional<std::string_view> name = readString(address);
+
+    if (!name)
+        return std::nullopt;
+
+    /** @brief Only the CD-ROM device is handled, memory cards (bu00:) and the rest go through the BIOS */
+    constexpr std::string_view DEVICE = "cdrom:";
+
+    if (name->size() < DEVICE.size() || !std::ranges::equal(name->substr(0, DEVICE.size()), DEVICE,
+        [](char a, char b) { return toLowerAscii(a) == b; }))
+        return std::nullopt;
+
+    return name->substr(DEVICE.size());
+}
+
+auto festation::KernelHLE::getOpenFile(uint32_t fd) -> OpenFile*
+{
+    if (fd < FIRST_HLE_FILE_DESCRIPTOR || fd - FIRST_HLE_FILE_DESCRIPTOR >= m_openFiles.size())
+        return nullptr;
+
+    std::optional<OpenFile>& file = m_openFiles[fd - FIRST_HLE_FILE_DESCRIPTOR];
+    return file ? &*file : nullptr;
+}
+
+auto festation::KernelHLE::readWord(uint32_t address) const -> uint32_t
+{
+    uint32_t value;
+    std::memcpy(&value, m_mainRAM.data() + (address & MAIN_RAM_SIZE_MASK), sizeof(uint32_t));
+    return value;
+}
+
+auto festation::KernelHLE::writeWord(uint32_t address, uint32_t value) -> void
+{
+    std::memcpy(m_mainRAM.data() + (address & MAIN_RAM_SIZE_MASK), &value, sizeof(uint32_t));
+}
+
+auto festation::KernelHLE::callStrcat() -> std::optional<uint32_t>
+{
+    const uint32_t dst = getArgument(0);
+    const uint32_t src = getArgument(1);
+
+    if (dst == 0 || src == 0)
+        return 0;
+
+    const auto dstString = readString(dst);
+    const auto srcString = readString(src);
+
+    if (!dstString || !srcString)
+        return std::nullopt;
+
+    const auto offset = translate(dst, dstString->size() + srcString->size() + 1);
+
+    if (!offset)
+        return std::nullopt;
+
+    std::memmove(&m_mainRAM[*offset + dstString->size()], srcString->data(), srcString->size());
+    m_mainRAM[*offset + dstString->size() + srcString->size()] = 0;
+
+    return dst;
+}
+
+auto festation::KernelHLE::callStrncat() -> std::optional<uint32_t>
+{
+    const uint32_t dst = getArgument(0);
+    const uint32_t src = getArgument(1);
+    const int32_t maxLength = static_cast<int32_t>(getArgument(2));
+
+    if (dst == 0 || src == 0)
+        return 0;
+
+    const auto dstString = readString(dst);
+    const auto srcString = readString(src);
+
+    if (!dstString || !srcString)
+        return std::nullopt;
+
+    const size_t length = std::min<size_t>(srcString->size(), std::max(maxLength, 0));
+    const auto offset = translate(dst, dstString->size() + length + 1);
+
+    if (!offset)
+        return std::nullopt;
+
+    std::memmove(&m_mainRAM[*offset + dstString->size()], srcString->data(), length);
+    m_mainRAM[*offset + dstString->size() + length] = 0;
+
+    return dst;
+}
+
+auto festation::KernelHLE::callStrcmp() -> std::optional<uint32_t>
+{
+    const uint32_t str1 = getArgument(0);
+    const uint32_t str2 = getArgument(1);
+
+    if (str1 == 0 || str2 == 0)
+        return (str1 == str2) ? 0 : (str1 == 0) ? HLE_ERROR : 1;
+
+    const auto string1 = readString(str1);
+    const auto string2 = readString(str2);
+
+    if (!string1 || !string2)
+        return std::nullopt;
+
+    /** @brief Both terminators take part, so the first difference is always within the shortest string + 1 */
+    for (size_t i = 0; i <= std::min(string1->size(), string2->size()); i++) {
+        const uint8_t chr1 = (i < string1->size()) ? (*string1)[i] : 0;
+        const uint8_t chr2 = (i < string2->size()) ? (*string2)[i] : 0;
+
+        if (chr1 != chr2)
+            return static_cast<uint32_t>(chr1 - chr2);
+    }
+
+    return 0;
+}
+
+auto festation::KernelHLE::callStrncmp() -> std::optional<uint32_t>
+{
+    const uint32_t str1 = getArgument(0);
+    const uint32_t str2 = getArgument(1);
+    const int32_t maxLength = static_cast<int32_t>(getArgument(2));
+
+    if (str1 == 0 || str2 == 0)
+        return (str1 == str2) ? 0 : (str1 == 0) ? HLE_ERROR : 1;
+
+    const auto string1 = readString(str1);
+    const auto string2 = readString(str2);
+
+    if (!string1 || !string2)
+        return std::nullopt;
+
+    const size_t length = std::min<size_t>(std::min(string1->size(), string2->size()) + 1, std::max(maxLength, 0));
+
+    for (size_t i = 0; i < length; i++) {
+        const uint8_t chr1 = (i < string1->size()) ? (*string1)[i] : 0;
+        const uint8_t chr2 = (i < string2->size()) ? (*string2)[i] : 0;
+
+        if (chr1 != chr2)
+            return static_cast<uint32_t>(chr1 - chr2);
+    }
+
+    return 0;
+}
+
+auto festation::KernelHLE::callStrcpy() -> std::optional<uint32_t>
+{
+    const uint32_t dst = getArgument(0);
+    const uint32_t src = getArgument(1);
+
+    if (dst == 0 || src == 0)
+        return 0;
+
+    const auto srcString = readString(src);
+
+    if (!srcString)
+        return std::nullopt;
+
+    const auto offset = translate(dst, srcString->size() + 1);
+
+    if (!offset)
+        return std::nullopt;
+
+    std::memmove(&m_mainRAM[*offset], srcString->data(), srcString->size());
+    m_mainRAM[*offset + srcString->size()] = 0;
+
+    return dst;
+}
+
+auto festation::KernelHLE::callStrncpy() -> std::optional<uint32_t>
+{
+    const uint32_t dst = getArgument(0);
+    const uint32_t src = getArgument(1);
+    const int32_t maxLength = static_cast<int32_t>(getArgument(2));
+
+    if (dst == 0 || src == 0)
+        return 0;
+
+    const auto srcString = readString(src);
+    const size_t length = std::max(maxLength, 0);
+
+    if (!srcString)
+        return std::nullopt;
+
+    const auto offset = translate(dst, length);
+
+    if (!offset)
+        return std::nullopt;
+
+    /** @brief Shorter sources are zero padded up to maxLength */
+    const size_t copyLength = std::min(srcString->size(), length);
+    std::memmove(&m_mainRAM[*offset], srcString->data(), copyLength);
+    std::fill_n(&m_mainRAM[*offset + copyLength], length - copyLength, 0);
+
+    return dst;
+}
+
+auto festation::KernelHLE::callStrlen() -> std::optional<uint32_t>
+{
+    const uint32_t src = getArgument(0);
+
+    if (src == 0)
+        return 0;
+
+    const auto string = readString(src);
+
+    if (!string)
+        return std::nullopt;
+
+    return static_cast<uint32_t>(string->size());
+}
+
+auto festation::KernelHLE::callStrchr() -> std::optional<uint32_t>
+{
+    const uint32_t src = getArgument(0);
+    const char chr = static_cast<char>(getArgument(1));
+
+    if (src == 0)
+        return 0;
+
+    const auto string = readString(src);
+
+    /** @brief Searching for the terminator is left to the BIOS code */
+    if (!string || chr == 0)
+        return std::nullopt;
+
+    const size_t position = string->find(chr);
+    return (position == std::string_view::npos) ? 0 : src + static_cast<uint32_t>(position);
+}
+
+auto festation::KernelHLE::callStrrchr() -> std::optional<uint32_t>
+{
+    const uint32_t src = getArgument(0);
+    const char chr = static_cast<char>(getArgument(1));
+
+    if (src == 0)
+        return 0;
+
+    const auto string = readString(src);
+
+    if (!string || chr == 0)
+        return std::nullopt;
+
+    const size_t position = string->rfind(chr);
+    return (position == std::string_view::npos) ? 0 : src + static_cast<uint32_t>(position);
+}
+
+auto festation::KernelHLE::callToupper() -> std::optional<uint32_t>
+{
+    return toUpperAscii(static_cast<uint8_t>(getArgument(0)));
+}
+
+auto festation::KernelHLE::callTolower() -> std::optional<uint32_t>
+{
+    return toLowerAscii(static_cast<uint8_t>(getArgument(0)));
+}
+
+auto festation::KernelHLE::callBcopy() -> std::optional<uint32_t>
+{
+    const uint32_t src = getArgument(0);
+    const uint32_t dst = getArgument(1);
+    const int32_t length = static_cast<int32_t>(getArgument(2));
+
+    if (src != 0 && dst != 0 && length > 0) {
+        const auto srcOffset = translate(src, length);
+        const auto dstOffset = translate(dst, length);
+
+        if (!srcOffset || !dstOffset)
+            return std::nullopt;
+
+        /** @brief Byte by byte forward copy like the BIOS loop, overlapping ranges end up the same */
+        for (int32_t i = 0; i < length; i++) {
+            m_mainRAM[*dstOffset + i] = m_mainRAM[*srcOffset + i];
+        }
+    }
+
+    /** @brief No return value, v0 is left as it was */
+    return getRegister(GprRegs::v0);
+}
+
+auto festation::KernelHLE::callBzero() -> std::optional<uint32_t>
+{
+    const uint32_t dst = getArgument(0);
+    const int32_t length = static_cast<int32_t>(getArgument(1));
+
+    if (dst == 0 || length <= 0)
+        return 0;
+
+    const auto offset = translate(dst, length);
+
+    if (!offset)
+        return std::nullopt;
+
+    std::fill_n(&m_mainRAM[*offset], length, 0);
+
+    return dst;
+}
+
+auto festation::KernelHLE::callBcmp() -> std::optional<uint32_t>
+{
+    const uint32_t ptr1 = getArgument(0);
+    const uint32_t ptr2 = getArgument(1);
+    const int32_t length = static_cast<int32_t>(getArgument(2));
+
+    if (ptr1 == 0 || ptr2 == 0 || length <= 0)
+        return 0;
+
+    const auto offset1 = translate(ptr1, length);
+    const auto offset2 = translate(ptr2, length);
+
+    if (!offset1 || !offset2)
+        return std::nullopt;
+
+    for (int32_t i = 0; i < length; i++) {
+        const uint8_t byte1 = m_mainRAM[*offset1 + i];
+        const uint8_t byte2 = m_mainRAM[*offset2 + i];
+
+        if (byte1 != byte2)
+            return static_cast<uint32_t>(byte1 - byte2);
+    }
+
+    return 0;
+}
+
+auto festation::KernelHLE::callMemcpy() -> std::optional<uint32_t>
+{
+    const uint32_t dst = getArgument(0);
+    const uint32_t src = getArgument(1);
+    const int32_t length = static_cast<int32_t>(getArgument(2));
+
+    if (dst == 0 || src == 0)
+        return 0;
+
+    if (length <= 0)
+        return dst;
+
+    const auto dstOffset = translate(dst, length);
+    const auto srcOffset = translate(src, length);
+
+    if (!dstOffset || !srcOffset)
+        return std::nullopt;
+
+    for (int32_t i = 0; i < length; i++) {
+        m_mainRAM[*dstOffset + i] = m_mainRAM[*srcOffset + i];
+    }
+
+    return dst;
+}
+
+auto festation::KernelHLE::callMemset() -> std::optional<uint32_t>
+{
+    const uint32_t dst = getArgument(0);
+    const uint8_t fill = static_cast<uint8_t>(getArgument(1));
+    const int32_t length = static_cast<int32_t>(getArgument(2));
+
+    if (dst == 0)
+        return 0;
+
+    if (length <= 0)
+        return dst;
+
+    const auto offset = translate(dst, length);
+
+    if (!offset)
+        return std::nullopt;
+
+    std::fill_n(&m_mainRAM[*offset], length, fill);
+
+    return dst;
+}
+
+auto festation::KernelHLE::callPutchar() -> std::optional<uint32_t>
+{
+    const uint32_t chr = getArgument(0);
+    m_tty.kernel_putchar(static_cast<char>(chr & 0xFF));
+    return chr;
+}
+
+auto festation::KernelHLE::callOpen() -> std::optional<uint32_t>
+{
+    const auto path = readFileName(getArgument(0));
+    const uint32_t accessMode = getArgument(1);
+
+    /** @brief Writes to the CD fail on the BIOS side too, let it report them */
+    if (!path || (accessMode & 0x2))
+        return std::nullopt;
+
+    const auto freeSlot = std::ranges::find_if(m_openFiles, [](const auto& file) { return !file.has_value(); });
+
+    if (freeSlot == m_openFiles.end())
+        return std::nullopt;
+
+    auto data = m_cdrom.readDiscFile(*path);
+
+    if (!data)
+        return HLE_ERROR;
+
+    *freeSlot = OpenFile{ .path = std::string(*path), .data = std::move(*data), .position = 0 };
+
+    return FIRST_HLE_FILE_DESCRIPTOR + static_cast<uint32_t>(freeSlot - m_openFiles.begin());
+}
+
+auto festation::KernelHLE::callLseek() -> std::optional<uint32_t>
+{
+    OpenFile* file = getOpenFile(getArgument(0));
+    const int32_t offset = static_cast<int32_t>(getArgument(1));
+
+    if (!file)
+        return std::nullopt;
+
+    switch (getArgument(2))
+    {
+    case SEEK_FROM_START:
+        file->position = offset;
+        break;
+    case SEEK_FROM_CURRENT:
+        file->position += offset;
+        break;
+    default:
+        return HLE_ERROR;
+    }
+
+    return file->position;
+}
+
+auto festation::KernelHLE::callRead() -> std::optional<uint32_t>
+{
+    OpenFile* file = getOpenFile(getArgument(0));
+    const uint32_t dst = getArgument(1);
+    const int32_t length = static_cast<int32_t>(getArgument(2));
+
+    if (!file)
+        return std::nullopt;
+
+    if (length <= 0 || file->position >= file->data.size())
+        return 0;
+
+    const size_t readSize = std::min<size_t>(length, file->data.size() - file->position);
+    const auto offset = translate(dst, readSize);
+
+    if (!offset)
+        return HLE_ERROR;
+
+    std::memcpy(&m_mainRAM[*offset], file->data.data() + file->position, readSize);
+    file->position += static_cast<uint32_t>(readSize);
+
+    return static_cast<uint32_t>(readSize);
+}
+
+auto festation::KernelHLE::callWrite() -> std::optional<uint32_t>
+{
+    /** @brief Files opened here are on the CD, read only */
+    if (!getOpenFile(getArgument(0)))
+        return std::nullopt;
+
+    return HLE_ERROR;
+}
+
+auto festation::KernelHLE::callIoctl() -> std::optional<uint32_t>
+{
+    if (!getOpenFile(getArgument(0)))
+        return std::nullopt;
+
+    return HLE_ERROR;
+}
+
+auto festation::KernelHLE::callIsatty() -> std::optional<uint32_t>
+{
+    if (!getOpenFile(getArgument(0)))
+        return std::nullopt;
+
+    return 0;
+}
+
+auto festation::KernelHLE::callGetc() -> std::optional<uint32_t>
+{
+    OpenFile* file = getOpenFile(getArgument(0));
+
+    if (!file)
+        return std::nullopt;
+
+    if (file->position >= file->data.size())
+        return HLE_ERROR;
+
+    return file->data[file->position++];
+}
+
+auto festation::KernelHLE::callPutc() -> std::optional<uint32_t>
+{
+    if (!getOpenFile(getArgument(1)))
+        return std::nullopt;
+
+    return HLE_ERROR;
+}
+
+auto festation::KernelHLE::callClose() -> std::optional<uint32_t>
+{
+    const uint32_t fd = getArgument(0);
+
+    if (!getOpenFile(fd))
+        return std::nullopt;
+
+    m_openFiles[fd - FIRST_HLE_FILE_DESCRIPTOR].reset();
+
+    return fd;
+}
+
+auto festation::KernelHLE::callCdGetLbn() -> std::optional<uint32_t>
+{
+    const auto path = readString(getArgument(0));
+
+    if (!path)
+        return std::nullopt;
+
+    auto location = m_cdrom.findDiscFile(*path);
+    return location ? location->lda : HLE_ERROR;
+}
+
+auto festation::KernelHLE::callCdReadSector() -> std::optional<uint32_t>
+{
+    const int32_t count = static_cast<int32_t>(getArgument(0));
+    const uint32_t sector = getArgument(1);
+    const uint32_t dst = getArgument(2);
+
+    if (count <= 0)
+        return std::nullopt;
+
+    const auto offset = translate(dst, count * CD_USER_DATA_SIZE);
+
+    if (!offset)
+        return std::nullopt;
+
+    if (!m_cdrom.readDiscSectors(sector, std::span(m_mainRAM).subspan(*offset, count * CD_USER_DATA_SIZE)))
+        return HLE_ERROR;
+
+    return count;
+}
+
+auto festation::KernelHLE::getEventAddress(uint32_t handle) const -> std::optional<uint32_t>
+{
+    if ((handle & 0xFFFF0000) != EVENT_HANDLE_BASE)
+        return std::nullopt;
+
+    const uint32_t arrayAddress = readWord(EVCB_ARRAY_POINTER_ADDRESS);
+    const uint32_t arraySize = readWord(EVCB_ARRAY_SIZE_ADDRESS);
+    const uint32_t index = handle & 0xFFFF;
+
+    if ((index + 1) * EVCB_SIZE > arraySize || !translate(arrayAddress, arraySize))
+        return std::nullopt;
+
+    return arrayAddress + index * EVCB_SIZE;
+}
+
+auto festation::KernelHLE::callDeliverEvent() -> std::optional<uint32_t>
+{
+    const uint32_t eventClass = getArgument(0);
+    const uint32_t spec = getArgument(1);
+    const uint32_t arrayAddress = readWord(EVCB_ARRAY_POINTER_ADDRESS);
+    const uint32_t arraySize = readWord(EVCB_ARRAY_SIZE_ADDRESS);
+
+    if (!translate(arrayAddress, arraySize))
+        return std::nullopt;
+
+    auto isDelivered = [&](uint32_t event) {
+        return readWord(event + EVCB_CLASS_OFFSET) == eventClass && readWord(event + EVCB_SPEC_OFFSET) == spec &&
+            readWord(event + EVCB_STATUS_OFFSET) == EVENT_STATUS_BUSY;
+    };
+
+    /** @brief Callbacks have to run as guest code, any event needing one sends the whole call to the BIOS */
+    for (uint32_t event = arrayAddress; event + EVCB_SIZE <= arrayAddress + arraySize; event += EVCB_SIZE) {
+        if (isDelivered(event) && readWord(event + EVCB_MODE_OFFSET) == EVENT_MODE_CALLBACK && readWord(event + EVCB_FUNCTION_OFFSET) != 0)
+            return std::nullopt;
+    }
+
+    for (uint32_t event = arrayAddress; event + EVCB_SIZE <= arrayAddress + arraySize; event += EVCB_SIZE) {
+        if (isDelivered(event) && readWord(event + EVCB_MODE_OFFSET) == EVENT_MODE_READY)
+            writeWord(event + EVCB_STATUS_OFFSET, EVENT_STATUS_READY);
+    }
+
+    return getRegister(GprRegs::v0);
+}
+
+auto festation::KernelHLE::callOpenEvent() -> std::optional<uint32_t>
+{
+    const uint32_t arrayAddress = readWord(EVCB_ARRAY_POINTER_ADDRESS);
+    const uint32_t arraySize = readWord(EVCB_ARRAY_SIZE_ADDRESS);
+
+    if (!translate(arrayAddress, arraySize))
+        return std::nullopt;
+
+    for (uint32_t index = 0; (index + 1) * EVCB_SIZE <= arraySize; index++) {
+        const uint32_t event = arrayAddress + index * EVCB_SIZE;
+
+        if (readWord(event + EVCB_STATUS_OFFSET) != EVENT_STATUS_FREE)
+            continue;
+
+        writeWord(event + EVCB_CLASS_OFFSET, getArgument(0));
+        writeWord(event + EVCB_SPEC_OFFSET, getArgument(1));
+        writeWord(event + EVCB_MODE_OFFSET, getArgument(2));
+        writeWord(event + EVCB_FUNCTION_OFFSET, getArgument(3));
+        writeWord(event + EVCB_STATUS_OFFSET, EVENT_STATUS_DISABLED);
+
+        return EVENT_HANDLE_BASE | index;
+    }
+
+    return HLE_ERROR;
+}
+
+auto festation::KernelHLE::callCloseEvent() -> std::optional<uint32_t>
+{
+    const auto event = getEventAddress(getArgument(0));
+
+    if (!event)
+        return std::nullopt;
+
+    writeWord(*event + EVCB_STATUS_OFFSET, EVENT_STATUS_FREE);
+    return 1;
+}
+
+auto festation::KernelHLE::callWaitEvent() -> std::optional<uint32_t>
+{
+    const auto event = getEventAddress(getArgument(0));
+
+    /** @brief Only the ready case returns right away, the BIOS code spins (with IRQs delivering) otherwise */
+    if (!event || readWord(*event + EVCB_STATUS_OFFSET) != EVENT_STATUS_READY)
+        return std::nullopt;
+
+    writeWord(*event + EVCB_STATUS_OFFSET, EVENT_STATUS_BUSY);
+    return 1;
+}
+
+auto festation::KernelHLE::callTestEvent() -> std::optional<uint32_t>
+{
+    const auto event = getEventAddress(getArgument(0));
+
+    if (!event)
+        return std::nullopt;
+
+    if (readWord(*event + EVCB_STATUS_OFFSET) != EVENT_STATUS_READY)
+        return 0;
+
+    writeWord(*event + EVCB_STATUS_OFFSET, EVENT_STATUS_BUSY);
+    return 1;
+}
+
+auto festation::KernelHLE::callEnableEvent() -> std::optional<uint32_t>
+{
+    const auto event = getEventAddress(getArgument(0));
+
+    if (!event)
+        return std::nullopt;
+
+    if (readWord(*event + EVCB_STATUS_OFFSET) != EVENT_STATUS_FREE)
+        writeWord(*event + EVCB_STATUS_OFFSET, EVENT_STATUS_BUSY);
+
+    return 1;
+}
+
+auto festation::KernelHLE::callDisableEvent() -> std::optional<uint32_t>
+{
+    const auto event = getEventAddress(getArgument(0));
+
+    if (!event)
+        return std::nullopt;
+
+    if (readWord(*event + EVCB_STATUS_OFFSET) != EVENT_STATUS_FREE)
+        writeWord(*event + EVCB_STATUS_OFFSET, EVENT_STATUS_DISABLED);
+
+    return 1;
+}
+
+auto festation::KernelHLE::callCloseThread() -> std::optional<uint32_t>
+{
+    const uint32_t handle = getArgument(0);
+    const uint32_t arrayAddress = readWord(TCB_ARRAY_POINTER_ADDRESS);
+    const uint32_t arraySize = readWord(TCB_ARRAY_SIZE_ADDRESS);
+    const uint32_t index = handle & 0xFFFF;
+
+    if ((handle & 0xFFFF0000) != THREAD_HANDLE_BASE || (index + 1) * TCB_SIZE > arraySize || !translate(arrayAddress, arraySize))
+        return std::nullopt;
+
+    writeWord(arrayAddress + index * TCB_SIZE, TCB_STATUS_FREE);
+    return 1;
+}
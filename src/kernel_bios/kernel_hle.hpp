@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace festation {
+    class MIPS_R3000A_Core;
+    class CdromDrive;
+    class KernelTTY;
+    class StateSerializer;
+
+    enum class KernelVector : uint8_t {
+        A0,
+        B0,
+        C0,
+    };
+
+    static constexpr size_t KERNEL_VECTORS_COUNT = 3;
+    static constexpr size_t KERNEL_FUNCTIONS_COUNT = 256;
+
+    /**
+     * @brief Native implementations of kernel calls made through the A0h/B0h/C0h vectors. A call is run
+     * here when the CPU lands on a vector and the function has an HLE entry that's enabled, otherwise (or
+     * when the arguments need something only the BIOS code can do, e.g. calling back into the game) the
+     * BIOS code runs it as usual. Kernel structures (events, threads) are the BIOS ones in RAM, so HLE and
+     * LLE calls can be freely mixed. Opt-in (--hle): calls take no emulated cycles, so timing differs from the BIOS.
+     */
+    class KernelHLE {
+    public:
+        KernelHLE(MIPS_R3000A_Core& cpu, std::span<uint8_t> mainRAM, CdromDrive& cdrom, KernelTTY& tty);
+
+        /** @brief Returns true if the call was completed natively (v0 set and back at ra) */
+        auto tryHandleCall(KernelVector vector, uint32_t function) -> bool;
+
+        auto setEnabled(bool enabled) -> void { m_isEnabled = enabled; }
+        auto isEnabled() const -> bool { return m_isEnabled; }
+
+        /**
+         * @brief Per function switch back to the BIOS code (LLE), e.g. to compare results in accuracy tests.
+         * File calls (open, read, close...) are switched as a whole, fds opened natively are unknown to the BIOS.
+         */
+        auto setFunctionEnabled(KernelVector vector, uint8_t function, bool enabled) -> void;
+        auto isFunctionImplemented(KernelVector vector, uint8_t function) const -> bool;
+
+        /** @brief Forgets the files opened natively, the kernel tables in RAM are the BIOS' business */
+        auto reset() -> void;
+
+        /** @brief Files opened through HLE are stored by path and position, they're read again from the disc on load */
+        auto serialize(StateSerializer& serializer) -> void;
+
+    private:
+        using HleFunction = auto (KernelHLE::*)() -> std::optional<uint32_t>;
+        using FunctionTable = std::array<HleFunction, KERNEL_FUNCTIONS_COUNT>;
+
+        struct OpenFile {
+            std::string path;
+            std::vector<uint8_t> data;
+            uint32_t position;
+        };
+
+        static auto getFunctionTables() -> const std::array<FunctionTable, KERNEL_VECTORS_COUNT>&;
+
+        auto getRegister(size_t index) const -> uint32_t;
+        auto getArgument(size_t index) const -> uint32_t;
+        /** @brief Offset into main RAM of [address, address + size), nullopt if any of it lies elsewhere */
+        auto translate(uint32_t address, size_t size) const -> std::optional<size_t>;
+        auto readString(uint32_t address) const -> std::optional<std::string_view>;
+        auto readFileName(uint32_t address) const -> std::optional<std::string_view>;
+        auto getOpenFile(uint32_t fd) -> OpenFile*;
+
+        // Memory and strings
+        auto callStrcat() -> std::optional<uint32_t>;
+        auto callStrncat() -> std::optional<uint32_t>;
+        auto callStrcmp() -> std::optional<uint32_t>;
+        auto callStrncmp() -> std::optional<uint32_t>;
+        auto callStrcpy() -> std::optional<uint32_t>;
+        auto callStrncpy() -> std::optional<uint32_t>;
+        auto callStrlen() -> std::optional<uint32_t>;
+        auto callStrchr() -> std::optional<uint32_t>;
+        auto callStrrchr() -> std::optional<uint32_t>;
+        auto callToupper() -> std::optional<uint32_t>;
+        auto callTolower() -> std::optional<uint32_t>;
+        auto callBcopy() -> std::optional<uint32_t>;
+        auto callBzero() -> std::optional<uint32_t>;
+        auto callBcmp() -> std::optional<uint32_t>;
+        auto callMemcpy() -> std::optional<uint32_t>;
+        auto callMemset() -> std::optional<uint32_t>;
+        auto callPutchar() -> std::optional<uint32_t>;
+
+        // Files (cdrom: device only) and CD
+        auto callOpen() -> std::optional<uint32_t>;
+        auto callLseek() -> std::optional<uint32_t>;
+        auto callRead() -> std::optional<uint32_t>;
+        auto callWrite() -> std::optional<uint32_t>;
+        auto callClose() -> std::optional<uint32_t>;
+        auto callIoctl() -> std::optional<uint32_t>;
+        auto callIsatty() -> std::optional<uint32_t>;
+        auto callGetc() -> std::optional<uint32_t>;
+        auto callPutc() -> std::optional<uint32_t>;
+        auto callCdGetLbn() -> std::optional<uint32_t>;
+        auto callCdReadSector() -> std::optional<uint32_t>;
+
+        // Events and threads
+        auto callDeliverEvent() -> std::optional<uint32_t>;
+        auto callOpenEvent() -> std::optional<uint32_t>;
+        auto callCloseEvent() -> std::optional<uint32_t>;
+        auto callWaitEvent() -> std::optional<uint32_t>;
+        auto callTestEvent() -> std::optional<uint32_t>;
+        auto callEnableEvent() -> std::optional<uint32_t>;
+        auto callDisableEvent() -> std::optional<uint32_t>;
+        auto callCloseThread() -> std::optional<uint32_t>;
+
+        /** @brief Guest address of the event control block behind a handle, nullopt if it's not a valid one */
+        auto getEventAddress(uint32_t handle) const -> std::optional<uint32_t>;
+        auto readWord(uint32_t address) const -> uint32_t;
+        auto writeWord(uint32_t address, uint32_t value) -> void;
+
+    private:
+        MIPS_R3000A_Core& m_cpu;
+        std::span<uint8_t> m_mainRAM;
+        CdromDrive& m_cdrom;
+        KernelTTY& m_tty;
+
+        bool m_isEnabled{ false };
+        std::array<std::bitset<KERNEL_FUNCTIONS_COUNT>, KERNEL_VECTORS_COUNT> m_enabledFunctions{};
+        std::vector<std::optional<OpenFile>> m_openFiles{};
+    };
+};
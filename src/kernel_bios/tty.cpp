@@ -5,26 +5,16 @@
 #include <print>
 #include <vector>
 
-namespace festation
+void festation::KernelTTY::kernel_putchar(char chr)
 {
-    static std::vector<char> bufferedOutputStream;
-
-    static void _putchar(char chr)
-    {
-        if (chr != '\n' && chr != '\0') {
-            bufferedOutputStream.push_back(chr);
-            return;
-        }
+    if (chr != '\n' && chr != '\0') {
+        bufferedOutputStream.push_back(chr);
+        return;
+    }
 
-        bufferedOutputStream.push_back('\0');
+    bufferedOutputStream.push_back('\0');
 
-        LOG_KERNEL("{}", bufferedOutputStream.data());
+    LOG_KERNEL("{}", bufferedOutputStream.data());
 
-        bufferedOutputStream.clear();
-    }
-};
-
-void festation::kernel_putchar(char chr)
-{
-    _putchar(chr);
+    bufferedOutputStream.clear();
 }
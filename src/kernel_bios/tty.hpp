@@ -1,6 +1,16 @@
 #pragma once
 
+#include <vector>
+
 namespace festation
 {
-    void kernel_putchar(char chr);                
+    /** @brief Kernel putchar output, buffered per machine and logged a line at a time */
+    class KernelTTY
+    {
+    public:
+        void kernel_putchar(char chr);
+
+    private:
+        std::vector<char> bufferedOutputStream;
+    };
 };
@@ -1,26 +1,408 @@
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <optional>
 #include <sstream>
+#include <string_view>
+#include <utility>
 
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
 #include "psx_system.hpp"
+#include "host/frame_pacer.hpp"
+#include "host/instance_runner.hpp"
+#include "host/lockstep_harness.hpp"
+#include "host/run_ahead.hpp"
+#include "savestate/rewind_buffer.hpp"
 #include "utils/logger.hpp"
 
 #include <glm/vec4.hpp>
-#include <thread>
 
 namespace festation
 {
     static constexpr const char* EMU_TITLE = "Festation (PSX Emulator)";
     static constexpr const int EMU_WIDTH = 1024;
     static constexpr const int EMU_HEIGHT = 512;
+    static constexpr const double EMU_TARGET_FPS = 60.0;
+    static constexpr const char* QUICK_SAVE_STATE_FILE = "quicksave.fst";
+    /** @brief One snapshot every 4 frames, ~256MB hold a few minutes of history with the deltas */
+    static constexpr const uint32_t REWIND_CAPTURE_INTERVAL_FRAMES = 4;
+    static constexpr const size_t REWIND_MEMORY_BUDGET = 256ull * 1024 * 1024;
+    /** @brief Frames emulated ahead of the presented one (0 disables run-ahead), 1-2 covers most games */
+    static constexpr const uint32_t RUN_AHEAD_FRAMES = 0;
+    /** @brief Headless runs without a movie to replay stop after this many frames (10s) */
+    static constexpr const uint64_t DEFAULT_HEADLESS_FRAMES = 600;
+    /** @brief Lockstep runs stop comparing after this many instructions per EXE (~5s of emulated time) */
+    static constexpr const uint64_t DEFAULT_LOCKSTEP_INSTRUCTIONS = 80'000'000;
+    static constexpr const size_t LOCKSTEP_CONTEXT_BLOCKS = 16;
+    /** @brief Test EXEs under res/tests (the ones picked by hand below), run by --lockstep when no --exe is given */
+    static constexpr const std::array<std::string_view, 20> TEST_EXES = {
+        "psxtest_cpu.exe",
+        "psxtest_cpx.exe",
+        "cpu.ps-exe",
+        "PeterLemon-PSX/Demo/hit-greensrc/hit-green.exe",
+        "PeterLemon-PSX/Demo/printgpu/PRINTGPU.exe",
+        "PeterLemon-PSX/Demo/PSXNICCC/PSXNICCC.exe",
+        "PeterLemon-PSX/Demo/vblank/VBLANK.exe",
+        "PeterLemon-PSX/HelloWorld/16BPP/HelloWorld16BPP.exe",
+        "PeterLemon-PSX/GPU/16BPP/RenderRectangle/RenderRectangle16BPP.exe",
+        "PeterLemon-PSX/GPU/16BPP/RenderPolygon/RenderPolygon16BPP.exe",
+        "PeterLemon-PSX/GPU/16BPP/RenderTexturePolygon/CLUT4BPP/RenderTexturePolygonCLUT4BPP.exe",
+        "PeterLemon-PSX/GPU/16BPP/MemoryTransfer/MemoryTransfer16BPP.exe",
+        "PeterLemon-PSX/GPU/24BPP/MemoryTransfer/MemoryTransfer24BPP.exe",
+        "Jakub-PSX/dma/chain-looping/chain-looping.exe",
+        "Jakub-PSX/dma/chopping/chopping.exe",
+        "Jakub-PSX/dma/otc-test/otc-test.exe",
+        "Jakub-PSX/gpu/quad/quad.exe",
+        "Jakub-PSX/gpu/rectangles/rectangles.exe",
+        "Jakub-PSX/gpu/triangle/triangle.exe",
+        "Jakub-PSX/timers/timers.exe",
+    };
+    /** @brief One instruction out of this many is profiled, low enough overhead to leave on */
+    static constexpr const uint32_t DEFAULT_PROFILE_SAMPLING_PERIOD = 1000;
+    /** @brief Keyboard keys of the digital pad and their bit in the pad's button word (L3/R3 are analog only) */
+    static constexpr const std::array<std::pair<int, uint16_t>, 14> PAD_KEY_BINDINGS = { {
+        { GLFW_KEY_RIGHT_SHIFT, 1 << 0 },   // Select
+        { GLFW_KEY_ENTER, 1 << 3 },         // Start
+        { GLFW_KEY_UP, 1 << 4 },
+        { GLFW_KEY_RIGHT, 1 << 5 },
+        { GLFW_KEY_DOWN, 1 << 6 },
+        { GLFW_KEY_LEFT, 1 << 7 },
+        { GLFW_KEY_1, 1 << 8 },             // L2
+        { GLFW_KEY_3, 1 << 9 },             // R2
+        { GLFW_KEY_Q, 1 << 10 },            // L1
+        { GLFW_KEY_E, 1 << 11 },            // R1
+        { GLFW_KEY_S, 1 << 12 },            // Triangle
+        { GLFW_KEY_C, 1 << 13 },            // Circle
+        { GLFW_KEY_X, 1 << 14 },            // Cross
+        { GLFW_KEY_Z, 1 << 15 },            // Square
+    } };
 };
 
+struct LaunchOptions {
+    std::filesystem::path exePath;
+    std::filesystem::path discPath;
+    bool fastBoot;
+    bool kernelHle;
+    std::filesystem::path recordMoviePath;
+    std::filesystem::path replayMoviePath;
+    std::filesystem::path profileOutputPrefix;
+    std::filesystem::path profileSymbolsPath;
+    std::filesystem::path tracePath;
+    uint32_t profileSamplingPeriod;
+    festation::CpuBackend cpuBackend;
+    std::optional<festation::CpuBackend> lockstepBackend;
+    uint64_t lockstepInstructions;
+    bool headless;
+    uint64_t headlessFrames;
+    uint32_t headlessInstances;
+};
+
+static auto parseCpuBackend(std::string_view name) -> std::optional<festation::CpuBackend>
+{
+    auto backend = std::find(festation::CPU_BACKEND_NAMES.begin(), festation::CPU_BACKEND_NAMES.end(), name);
+
+    if (backend == festation::CPU_BACKEND_NAMES.end()) {
+        LOG_ERROR("Unknown CPU backend {} (interpreter, threaded)", name);
+        return std::nullopt;
+    }
+
+    return static_cast<festation::CpuBackend>(backend - festation::CPU_BACKEND_NAMES.begin());
+}
+
+/** @brief Nothing when an option can't be used as given, the error is already logged */
+static auto parseLaunchOptions(int argc, char** argv) -> std::optional<LaunchOptions>
+{
+    LaunchOptions options{ .fastBoot = false, .kernelHle = false, .profileSamplingPeriod = festation::DEFAULT_PROFILE_SAMPLING_PERIOD,
+        .cpuBackend = festation::CpuBackend::Interpreter, .lockstepBackend = std::nullopt, .lockstepInstructions = festation::DEFAULT_LOCKSTEP_INSTRUCTIONS, .headless = false, .headlessFrames = festation::DEFAULT_HEADLESS_FRAMES, .headlessInstances = 1 };
+
+    for (int i = 1; i < argc; i++) {
+        const std::string_view argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (argument == "--headless")
+            options.headless = true;
+        else if (argument == "--fast-boot")
+            options.fastBoot = true;
+        else if (argument == "--hle")
+            options.kernelHle = true;
+        else if (argument == "--exe" && hasValue)
+            options.exePath = argv[++i];
+        else if (argument == "--disc" && hasValue)
+            options.discPath = argv[++i];
+        else if (argument == "--record" && hasValue)
+            options.recordMoviePath = argv[++i];
+        else if (argument == "--replay" && hasValue)
+            options.replayMoviePath = argv[++i];
+        else if (argument == "--profile" && hasValue)
+            options.profileOutputPrefix = argv[++i];
+        else if (argument == "--profile-period" && hasValue)
+            options.profileSamplingPeriod = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (argument == "--trace" && hasValue)
+            options.tracePath = argv[++i];
+        else if (argument == "--symbols" && hasValue)
+            options.profileSymbolsPath = argv[++i];
+        else if (argument == "--cpu" && hasValue) {
+            std::optional<festation::CpuBackend> backend = parseCpuBackend(argv[++i]);
+
+            if (!backend)
+                return std::nullopt;
+
+            options.cpuBackend = *backend;
+        }
+        else if (argument == "--lockstep" && hasValue) {
+            options.lockstepBackend = parseCpuBackend(argv[++i]);
+
+            if (!options.lockstepBackend)
+                return std::nullopt;
+        }
+        else if (argument == "--lockstep-instructions" && hasValue)
+            options.lockstepInstructions = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--frames" && hasValue)
+            options.headlessFrames = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--instances" && hasValue)
+            options.headlessInstances = std::max(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)), 1u);
+        else
+            LOG_WARN("Ignoring unknown argument {}", argument);
+    }
+
+    return options;
+}
+
+/** @brief FNV-1a, enough to tell two runs apart when checking replays */
+static auto hashMemory(std::span<const uint8_t> data) -> uint64_t
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (uint8_t byte : data) {
+        hash = (hash ^ byte) * 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+/** @brief Sideloads the EXE or inserts the disc, which fast boot jumps straight into */
+static auto bootMachine(festation::PSXSystem& psxSystem, const LaunchOptions& options) -> bool
+{
+    psxSystem.setFastBoot(options.fastBoot);
+    psxSystem.setKernelHleEnabled(options.kernelHle);
+    psxSystem.setCpuBackend(options.cpuBackend);
+
+    if (!options.discPath.empty()) {
+        if (!psxSystem.insertDisc(options.discPath))
+            return false;
+
+        return !options.fastBoot || psxSystem.bootDisc();
+    }
+
+    if (!options.exePath.empty()) {
+        psxSystem.sideloadExeFile(options.exePath);
+    }
+
+    return true;
+}
+
+/** @brief No presentation nor pacing, a replayed movie runs to its last frame. Returns the process exit code */
+static auto runHeadless(festation::PSXSystem& psxSystem, const LaunchOptions& options) -> int
+{
+    const festation::MovieController& movieController = psxSystem.getMovieController();
+    const bool isReplaying = movieController.getMode() == festation::MovieMode::Playing;
+    uint64_t framesCount = 0;
+
+    psxSystem.setOutputMode(festation::RenderOutputMode::DrawOnly);
+    const auto startTime = std::chrono::steady_clock::now();
+
+    while (isReplaying ? !movieController.isPlaybackFinished() : framesCount < options.headlessFrames) {
+        psxSystem.runFrame();
+        framesCount++;
+    }
+
+    const double elapsedSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    LOG_INFO("Headless: {} frames in {:.3f}s ({:.2f} FPS), RAM hash {:016X}", framesCount, elapsedSecs, 
+        framesCount / elapsedSecs, hashMemory(psxSystem.getMainRAM()));
+
+    if (isReplaying && movieController.isDesynced()) {
+        LOG_ERROR("Headless: replay desynced");
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Batch run of independent machines on every core, each one with its own hidden window's GL context.
+ * Contexts are made current on whichever worker runs the slice. Returns the process exit code
+ */
+static auto runHeadlessInstances(GLFWwindow* mainWindow, const LaunchOptions& options) -> int
+{
+    std::vector<GLFWwindow*> contexts{ mainWindow };
+    std::vector<std::unique_ptr<festation::PSXSystem>> systems;
+
+    for (uint32_t i = 1; i < options.headlessInstances; i++) {
+        GLFWwindow* context = glfwCreateWindow(festation::EMU_WIDTH, festation::EMU_HEIGHT, festation::EMU_TITLE, NULL, NULL);
+
+        if (!context) {
+            LOG_ERROR("Headless: couldn't create a GL context for instance {}", i);
+            break;
+        }
+
+        contexts.push_back(context);
+    }
+
+    /** @brief Windows (and GL objects in each instance) have to be created from the main thread */
+    for (GLFWwindow* context : contexts) {
+        glfwMakeContextCurrent(context);
+        auto& psxSystem = systems.emplace_back(std::make_unique<festation::PSXSystem>());
+        psxSystem->setFrameEndCallback([]() {});
+        psxSystem->setOutputMode(festation::RenderOutputMode::DrawOnly);
+
+        /** @brief With fast boot only the first instance runs the BIOS, the others restore its snapshot */
+        if (!bootMachine(*psxSystem, options)) {
+            LOG_ERROR("Headless: couldn't boot instance {}", systems.size() - 1);
+        }
+    }
+
+    glfwMakeContextCurrent(NULL);
+
+    festation::InstanceRunner runner({ .workersCount = 0, .framesPerSlice = 1, .pinWorkersToCpus = true });
+    std::vector<festation::SessionId> sessionIds;
+    const auto startTime = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < systems.size(); i++) {
+        sessionIds.push_back(runner.addSession(*systems[i], {
+            .preferredCpu = std::nullopt,
+            .framesToRun = options.headlessFrames,
+            .onSliceBegin = [context = contexts[i]](festation::PSXSystem&) { glfwMakeContextCurrent(context); },
+            .onSliceEnd = [](festation::PSXSystem&) { glfwMakeContextCurrent(NULL); return true; },
+        }));
+    }
+
+    runner.waitUntilFinished();
+
+    const double elapsedSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    uint64_t totalFrames = 0;
+
+    for (size_t i = 0; i < systems.size(); i++) {
+        const festation::SessionStats stats = runner.getSessionStats(sessionIds[i]);
+        totalFrames += stats.framesRun;
+
+        LOG_INFO("Headless instance {}: {} frames, {:.3f}s busy, {} of {} slices stolen, RAM hash {:016X}", i, stats.framesRun,
+            std::chrono::duration<double>(stats.busyTime).count(), stats.slicesStolen, stats.slicesRun, hashMemory(systems[i]->getMainRAM()));
+    }
+
+    LOG_INFO("Headless: {} instances on {} workers, {} frames in {:.3f}s ({:.2f} FPS total), fairness {:.3f}", systems.size(),
+        runner.getWorkersCount(), totalFrames, elapsedSecs, totalFrames / elapsedSecs, runner.getFairnessIndex());
+
+    /** @brief Each instance releases its GL objects, so its context has to be current */
+    for (size_t i = 0; i < systems.size(); i++) {
+        glfwMakeContextCurrent(contexts[i]);
+        systems[i].reset();
+    }
+
+    glfwMakeContextCurrent(mainWindow);
+
+    return 0;
+}
+
+/**
+ * @brief Runs each EXE (--exe, or every test EXE) on the interpreter and on the given backend side by side,
+ * stopping at the first divergence. Returns the process exit code
+ */
+static auto runLockstep(const LaunchOptions& options) -> int
+{
+    std::vector<std::filesystem::path> exePaths;
+
+    if (!options.exePath.empty()) {
+        exePaths.push_back(options.exePath);
+    }
+    else {
+        for (std::string_view testExe : festation::TEST_EXES) {
+            exePaths.push_back(std::filesystem::current_path() / "../../../res/tests" / testExe);
+        }
+    }
+
+    const std::string_view backendName = festation::CPU_BACKEND_NAMES[std::to_underlying(*options.lockstepBackend)];
+    int exitCode = 0;
+
+    for (const std::filesystem::path& exePath : exePaths) {
+        if (!std::filesystem::exists(exePath)) {
+            LOG_WARN("Lockstep: skipping missing {}", exePath.string());
+            continue;
+        }
+
+        festation::PSXSystem reference;
+        festation::PSXSystem candidate;
+
+        for (festation::PSXSystem* psxSystem : { &reference, &candidate }) {
+            psxSystem->setFrameEndCallback([]() {});
+            psxSystem->setOutputMode(festation::RenderOutputMode::DrawOnly);
+            psxSystem->setFastBoot(options.fastBoot);
+        }
+
+        reference.setCpuBackend(festation::CpuBackend::Interpreter);
+        candidate.setCpuBackend(*options.lockstepBackend);
+        reference.sideloadExeFile(exePath);
+
+        festation::LockstepHarness harness(reference, candidate, {
+            .maxInstructions = options.lockstepInstructions,
+            .contextBlocks = festation::LOCKSTEP_CONTEXT_BLOCKS,
+        });
+
+        const festation::LockstepResult result = harness.run();
+
+        if (result.divergence) {
+            LOG_ERROR("Lockstep ({}): {} diverged after {} instructions\n{}", backendName, exePath.filename().string(),
+                result.instructionsCompared, *result.divergence);
+            exitCode = 1;
+            continue;
+        }
+
+        LOG_INFO("Lockstep ({}): {} in sync, {} instructions in {} blocks", backendName, exePath.filename().string(),
+            result.instructionsCompared, result.blocksCompared);
+    }
+
+    return exitCode;
+}
+
+enum class SaveStateRequest {
+    None,
+    Save,
+    Load,
+};
+
+/** @brief Handled from the main loop, key callbacks run from the frame end callback while VBlank is being dispatched */
+static SaveStateRequest saveStateRequest = SaveStateRequest::None;
+
+/** @brief Pad buttons held on the keyboard, active low like the pad sends them */
+static auto readHostPadButtons(GLFWwindow* window) -> uint16_t
+{
+    uint16_t buttons = 0xFFFF;
+
+    for (const auto& [key, mask] : festation::PAD_KEY_BINDINGS) {
+        if (glfwGetKey(window, key) == GLFW_PRESS)
+            buttons &= ~mask;
+    }
+
+    return buttons;
+}
+
 static void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (action != GLFW_PRESS)
+        return;
+
+    if (key == GLFW_KEY_F5)
+        saveStateRequest = SaveStateRequest::Save;
+    else if (key == GLFW_KEY_F8)
+        saveStateRequest = SaveStateRequest::Load;
+}
+
 void APIENTRY GLDebugCallback(GLenum source, GLenum type, GLuint id,
                               GLenum severity, GLsizei length,
                               const GLchar* message, const void* userParam)
@@ -28,10 +410,17 @@ void APIENTRY GLDebugCallback(GLenum source, GLenum type, GLuint id,
     LOG_ERROR("{}", message);
 }
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
     LOG_INFO("Hello, from Festation!");
 
+    std::optional<LaunchOptions> parsedOptions = parseLaunchOptions(argc, argv);
+
+    if (!parsedOptions)
+        return -1;
+
+    LaunchOptions options = std::move(*parsedOptions);
+
     GLFWwindow* window;
 
     /* Initialize the library */
@@ -45,6 +434,10 @@ int main(int, char**)
     
     glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
+    /** @brief The renderer still needs a GL context when running headless */
+    if (options.headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     /* Create a windowed mode window and its OpenGL context */
     window = glfwCreateWindow(festation::EMU_WIDTH, festation::EMU_HEIGHT, festation::EMU_TITLE, NULL, NULL);
     
@@ -55,6 +448,7 @@ int main(int, char**)
     }
 
     glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetKeyCallback(window, keyCallback);
 
     /* Make the window's context current */
     glfwMakeContextCurrent(window);
@@ -78,11 +472,26 @@ int main(int, char**)
         glDebugMessageControl(GL_DEBUG_SOURCE_SHADER_COMPILER, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
     }
 
+    if (options.lockstepBackend) {
+        const int exitCode = runLockstep(options);
+        glfwTerminate();
+        return exitCode;
+    }
+
+    if (options.headless && options.headlessInstances > 1) {
+        const int exitCode = runHeadlessInstances(window, options);
+        glfwTerminate();
+        return exitCode;
+    }
+
     festation::PSXSystem psxSystem;
 
-    float time = (float)glfwGetTime();
-    float delta = 0.0f;
-    
+    festation::RewindBuffer rewindBuffer(festation::REWIND_MEMORY_BUDGET);
+    uint32_t framesSinceRewindCapture = 0;
+
+    festation::FramePacer framePacer(festation::EMU_TARGET_FPS);
+    framePacer.setMode(festation::FramePacingMode::HighResolutionDeadline);
+
     std::filesystem::path path;
     // path = std::filesystem::current_path().concat("/../../../res/tests/psxtest_cpu.exe");
     // path = std::filesystem::current_path().concat("/../../../res/tests/psxtest_cpx.exe");
@@ -105,12 +514,17 @@ int main(int, char**)
     // path = std::filesystem::current_path().concat("/../../../res/tests/Jakub-PSX/gpu/triangle/triangle.exe");
     // path = std::filesystem::current_path().concat("/../../../res/tests/Jakub-PSX/timers/timers.exe");
 
+    /** @brief Command line wins over the test EXE picked above */
+    if (options.exePath.empty() && options.discPath.empty())
+        options.exePath = path;
+
+    path = options.discPath.empty() ? options.exePath : options.discPath;
+
     psxSystem.setFrameEndCallback([&]() {
-        float current = (float)glfwGetTime();
-        delta = current - time;
-        time = current;
+        double frameTimeSecs = std::chrono::duration<double>(framePacer.getLastFrameTime()).count();
+        double fps = (frameTimeSecs > 0.0) ? 1.0 / frameTimeSecs : 0.0;
 
-        std::string windowTitle =  std::format("{} | {} | {:.2f} FPS", festation::EMU_TITLE, (path.empty()) ? "No disc" : path.filename().string(), 1.0f / delta);
+        std::string windowTitle =  std::format("{} | {} | {:.2f} FPS", festation::EMU_TITLE, (path.empty()) ? "No disc" : path.filename().string(), fps);
         glfwSetWindowTitle(window, windowTitle.c_str());
 
         // int display_w, display_h;
@@ -123,16 +537,49 @@ int main(int, char**)
         /* Poll for and process events */
         glfwPollEvents();
 
-        float idleTime = (1.f / 60) - delta;
+        framePacer.waitForNextFrame();
+    });
+
+    if (!bootMachine(psxSystem, options)) {
+        LOG_ERROR("Couldn't boot {}", path.string());
+        glfwTerminate();
+        return -1;
+    }
 
-        if (idleTime > 0) {
-            int64_t sleepTimeMs = idleTime * 1000;
-            std::this_thread::sleep_for(std::chrono::milliseconds(sleepTimeMs));
+    if (!options.replayMoviePath.empty()) {
+        auto movie = festation::Movie::loadFromFile(options.replayMoviePath);
+
+        if (!movie || !psxSystem.startMoviePlayback(std::move(*movie))) {
+            LOG_ERROR("Couldn't start replaying {}", options.replayMoviePath.string());
+            glfwTerminate();
+            return -1;
         }
-    });
+    }
+    else if (!options.recordMoviePath.empty()) {
+        psxSystem.startMovieRecording();
+    }
+
+    festation::CpuProfiler& profiler = psxSystem.getCpuProfiler();
+
+    /** @brief Profiles from the game's entry, BIOS boot is left out */
+    if (!options.profileOutputPrefix.empty()) {
+        if (!options.profileSymbolsPath.empty() && !profiler.loadSymbols(options.profileSymbolsPath))
+            LOG_WARN("Couldn't read symbols from {}", options.profileSymbolsPath.string());
+
+        profiler.start(options.profileSamplingPeriod);
+    }
+
+    if (!options.tracePath.empty() && !psxSystem.startExecutionTrace(options.tracePath))
+        LOG_WARN("Couldn't create the execution trace {}", options.tracePath.string());
+
+    /** @brief Run-ahead, rewind and state loads would break the movie's timeline */
+    const bool isMovieActive = psxSystem.getMovieController().getMode() != festation::MovieMode::Idle;
+    festation::RunAhead runAhead(psxSystem, isMovieActive ? 0 : festation::RUN_AHEAD_FRAMES);
+    int exitCode = 0;
 
-    if (!path.empty()) {
-        psxSystem.sideloadExeFile(path);
+    if (options.headless) {
+        exitCode = runHeadless(psxSystem, options);
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
     }
 
     /* Loop until the user closes the window */
@@ -144,10 +591,64 @@ int main(int, char**)
             continue;
         }
 
-        psxSystem.run();
+        psxSystem.setPadButtons(readHostPadButtons(window));
+        runAhead.runFrame();
+
+        if (psxSystem.getMovieController().isPlaybackFinished()) {
+            psxSystem.stopMovie();
+            LOG_INFO("Replay finished");
+        }
+
+        if (saveStateRequest == SaveStateRequest::Save) {
+            if (psxSystem.saveStateToFile(festation::QUICK_SAVE_STATE_FILE))
+                LOG_INFO("State saved to {}", festation::QUICK_SAVE_STATE_FILE);
+        }
+        else if (saveStateRequest == SaveStateRequest::Load && !isMovieActive) {
+            if (psxSystem.loadStateFromFile(festation::QUICK_SAVE_STATE_FILE))
+                LOG_INFO("State loaded from {}", festation::QUICK_SAVE_STATE_FILE);
+        }
+
+        saveStateRequest = SaveStateRequest::None;
+
+        if (isMovieActive) {
+            continue;
+        }
+
+        if (glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_PRESS) {
+            if (auto state = rewindBuffer.pop())
+                psxSystem.loadState(*state);
+
+            framesSinceRewindCapture = 0;
+        }
+        else if (++framesSinceRewindCapture == festation::REWIND_CAPTURE_INTERVAL_FRAMES) {
+            std::vector<uint8_t> state = rewindBuffer.acquireStateBuffer();
+            psxSystem.saveState(state);
+            rewindBuffer.push(std::move(state));
+            framesSinceRewindCapture = 0;
+        }
+    }
+
+    if (psxSystem.getMovieController().getMode() == festation::MovieMode::Recording) {
+        if (psxSystem.stopMovie().saveToFile(options.recordMoviePath))
+            LOG_INFO("Movie saved to {}", options.recordMoviePath.string());
+    }
+
+    if (!options.headless)
+        LOG_INFO("{}", framePacer.getHistogram().toString());
+
+    psxSystem.stopExecutionTrace();
+
+    if (profiler.isEnabled()) {
+        profiler.stop();
+
+        const std::filesystem::path foldedPath = std::filesystem::path(options.profileOutputPrefix).concat(".folded");
+        const std::filesystem::path hotSpotsPath = std::filesystem::path(options.profileOutputPrefix).concat("_hotspots.txt");
+
+        if (profiler.exportFoldedStacks(foldedPath) && profiler.exportHotSpots(hotSpotsPath))
+            LOG_INFO("Profile saved to {} and {}", foldedPath.string(), hotSpotsPath.string());
     }
 
     glfwTerminate();
     
-    return 0;
+    return exitCode;
 }
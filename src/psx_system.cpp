@@ -2,27 +2,96 @@
 #include "cdrom/cdrom.hpp"
 #include "interrupts/interrupts.hpp"
 #include "memory/memory_map_masks.hpp"
+#include "savestate/boot_snapshot_cache.hpp"
 #include "utils/logger.hpp"
 #include "utils/file_reader.hpp"
 
+#include <algorithm>
 #include <stdlib.h>
 #include <assert.h>
 #include <cstring>
+#include <fstream>
+#include <string_view>
 #include <utility>
 
 static constexpr const uint32_t CYCLES_FER_FRAME_NTSC = 565'045;
-static bool canSend = false;
-static uint8_t currentByte = 0;
+/** @brief Bumped on any layout change of a section that can't be handled by its own version */
+static constexpr const uint32_t SAVE_STATE_VERSION = 7;
+/** @brief Shell entry, the kernel is fully initialized by then */
+static constexpr const uint32_t SHELL_ENTRY_POINT = 0x80030000;
+static constexpr const uint32_t EXE_HEADER_SIZE = 2048;
+/** @brief Kernel's default when neither the EXE header nor SYSTEM.CNF sets one */
+static constexpr const uint32_t DEFAULT_STACK_POINTER = 0x801FFFF0;
+
+namespace festation
+{
+    struct DiscBootConfig {
+        std::string bootFile;
+        uint32_t stackPointer;
+    };
+
+    /** @brief "BOOT = cdrom:\SLUS_000.00;1" and "STACK = 801FFFF0" lines, anything else is ignored */
+    static auto parseSystemCnf(std::string_view text) -> DiscBootConfig
+    {
+        DiscBootConfig config{ .bootFile = "PSX.EXE;1", .stackPointer = DEFAULT_STACK_POINTER };
+
+        auto trim = [](std::string_view value) {
+            const size_t start = value.find_first_not_of(" \t\r");
+            const size_t end = value.find_last_not_of(" \t\r");
+            return (start == std::string_view::npos) ? std::string_view{} : value.substr(start, end - start + 1);
+        };
+
+        while (!text.empty()) {
+            const size_t lineEnd = text.find('\n');
+            const std::string_view line = text.substr(0, lineEnd);
+            text = (lineEnd == std::string_view::npos) ? std::string_view{} : text.substr(lineEnd + 1);
 
-festation::PSXSystem::PSXSystem()
-    : m_cpu(this, m_interruptsHandler), m_mainRAM(MAIN_RAM_SIZE), m_bios(KernelBIOS(m_cpu)),
-        m_cdrom(m_interruptsHandler, m_scheduler) , m_dma(*this), 
-            m_timers({{m_interruptsHandler, m_scheduler}, {m_interruptsHandler, m_scheduler}, {m_interruptsHandler, m_scheduler}})
+            const size_t separator = line.find('=');
+
+            if (separator == std::string_view::npos)
+                continue;
+
+            const std::string_view key = trim(line.substr(0, separator));
+            std::string_view value = trim(line.substr(separator + 1));
+
+            if (key == "BOOT") {
+                /** @brief Some discs pass arguments after the path */
+                value = value.substr(0, value.find_first_of(" \t"));
+                value = value.substr(value.find(':') + 1);
+                config.bootFile = value.substr(std::min(value.find_first_not_of('\\'), value.size()));
+            }
+            else if (key == "STACK") {
+                config.stackPointer = static_cast<uint32_t>(std::strtoul(std::string(value).c_str(), nullptr, 16));
+            }
+        }
+
+        return config;
+    }
+};
+
+auto festation::SystemPaths::getDefault() -> SystemPaths
 {
-    m_scheduler.scheduleEvent({ EventType::VBlank, CYCLES_FER_FRAME_NTSC, 
-        [this]() {
-            onFrameEnded();
-        } });
+    const std::filesystem::path resourcesPath = std::filesystem::current_path() / "../../../res";
+
+    return {
+        .biosFile = resourcesPath / "bios/SCPH1001.BIN",
+        .shadersDirectory = resourcesPath / "shaders",
+        .bootSnapshotsDirectory = std::filesystem::current_path() / "boot_snapshots",
+    };
+}
+
+festation::PSXSystem::PSXSystem(const SystemPaths& paths)
+    : m_cpu(this, m_interruptsHandler), m_mainRAM(MAIN_RAM_SIZE), m_bios(m_cpu, m_mainRAM, m_cdrom, paths.biosFile),
+        m_cdrom(m_interruptsHandler, m_scheduler) , m_dma(*this), m_gpu(paths.shadersDirectory), 
+            m_timers({{0, m_interruptsHandler, m_scheduler}, {1, m_interruptsHandler, m_scheduler}, {2, m_interruptsHandler, m_scheduler}}),
+                m_bootSnapshotsDirectory(paths.bootSnapshotsDirectory)
+{
+    m_scheduler.setEventHandler(EventType::VBlank, [this](uint64_t) { onFrameEnded(); });
+    m_scheduler.scheduleEvent(EventType::VBlank, CYCLES_FER_FRAME_NTSC);
+
+    m_cdrom.setInterruptObserver([this](CdromInterruptType type) {
+        m_movie.onCdromInterrupt(m_totalElapsedCycles, type);
+    });
 }
 
 festation::PSXSystem::~PSXSystem()
@@ -33,11 +102,22 @@ auto festation::PSXSystem::reset() -> void
 {
     m_cpu.reset();
     m_dma.reset();
-    m_mainRAM.clear();
-    m_scheduler = Scheduler();
+    std::ranges::fill(m_mainRAM, 0);
+    m_scheduler.reset();
+    m_scheduler.scheduleEvent(EventType::VBlank, CYCLES_FER_FRAME_NTSC);
     m_totalElapsedCycles = 0;
-    /** @todo Reset the rest of the components.  */
-    // m_interruptsHandler.reset();
+
+    for (auto& timer : m_timers) {
+        timer.reset();
+    }
+
+    m_interruptsHandler.reset();
+    m_cdrom.reset();
+    m_gpu.reset();
+    m_bios.reset();
+    m_isPadSending = false;
+    m_padCurrentByte = 0;
+    m_latchedPadButtons = 0xFFFF;
 }
 
 // IMPLEMENT READ16 AND READ32 AS MULTIPLE READ8 SIMPLIFIES IMPLEMENTATION
@@ -71,17 +151,19 @@ auto festation::PSXSystem::read8(uint32_t address) -> uint8_t
         case 0x1F801040:
             LOG_DEBUG("Read8 from Joypad/memory Card port DATA 0x{:08X}", masked_address);
             {
-                static uint8_t stubStartResponse[5] = { 0xFF, 0x41, 0x5A, 0xFF, 0xBF };
+                /** @brief Digital pad: Hi-Z, ID (41h 5Ah), buttons low and high */
+                const uint8_t padResponse[5] = { 0xFF, 0x41, 0x5A, 
+                    uint8_t(m_latchedPadButtons & 0xFF), uint8_t(m_latchedPadButtons >> 8) };
 
-                if (!canSend)
+                if (!m_isPadSending)
                     return 0xFF;
 
-                uint8_t byte = stubStartResponse[currentByte++];
+                uint8_t byte = padResponse[m_padCurrentByte++];
 
-                if (currentByte == 5)
+                if (m_padCurrentByte == 5)
                 {
-                    canSend = false;
-                    currentByte = 0;
+                    m_isPadSending = false;
+                    m_padCurrentByte = 0;
                 }
 
                 return byte;
@@ -357,8 +439,9 @@ auto festation::PSXSystem::write8(uint32_t address, uint8_t value) -> void
         case 0x1F801040:
             {
                 if (value == 0x01) {
-                    currentByte = 0;
-                    canSend = true;
+                    m_padCurrentByte = 0;
+                    m_isPadSending = true;
+                    m_latchedPadButtons = m_movie.onPadPoll(m_totalElapsedCycles, m_padButtons);
                 } 
             }
             LOG_DEBUG("Write8 ({:02X}h) to Joypad/Memory Card DATA port 0x{:08X}", value, masked_address);
@@ -510,6 +593,8 @@ auto festation::PSXSystem::write32(uint32_t address, uint32_t value) -> void
         case 0x1F801814:
             // LOG_DEBUG("Writting {:08X}h to GPU IO port 0x{:08X}", value, masked_address);
             m_gpu.write32(masked_address, value);
+            // Display mode (GP1(08h)) sets the timer 0 dotclock rate
+            m_timers[0].setDotClockDivider(m_gpu.getDotClockDivider());
             break;
         case 0x1F801070:
             LOG_DEBUG("Write32 ({:08X}h) to I_STAT INT port 0x{:08X}", value, masked_address);
@@ -568,21 +653,41 @@ auto festation::PSXSystem::write32(uint32_t address, uint32_t value) -> void
     }
 }
 
-auto festation::PSXSystem::run() -> void
+auto festation::PSXSystem::run() -> uint32_t
+{
+    const CpuRunResult result = m_cpu.run(m_scheduler.getCyclesUntilNextEvent());
+    advanceTime(result.cycles);
+
+    return result.instructions;
+}
+
+auto festation::PSXSystem::advanceTime(uint64_t cycles) -> void
 {
-    uint8_t cycles = m_cpu.executeInstruction();
-    m_bios.checkKernerlTTYOutput();
     m_scheduler.step(cycles);
     m_totalElapsedCycles += cycles;
 }
 
+auto festation::PSXSystem::runFrame() -> void
+{
+    m_hasFrameEnded = false;
+
+    while (!m_hasFrameEnded) {
+        run();
+    }
+}
+
+auto festation::PSXSystem::setOutputMode(RenderOutputMode mode) -> void
+{
+    m_outputMode = mode;
+    m_gpu.setOutputMode(mode);
+}
+
 auto festation::PSXSystem::runWholeFrame() -> void
 {
     int32_t totalFrameCycles = CYCLES_FER_FRAME_NTSC;
 
     while (totalFrameCycles > 0) {
-        uint8_t cycles = m_cpu.executeInstruction();
-        m_bios.checkKernerlTTYOutput();
+        uint32_t cycles = m_cpu.executeInstruction();
         m_totalElapsedCycles += cycles;
         totalFrameCycles -= cycles;
     }
@@ -593,26 +698,87 @@ auto festation::PSXSystem::runWholeFrame() -> void
 
 auto festation::PSXSystem::sideloadExeFile(const std::filesystem::path& path) -> void
 {
+    runBiosUntilShell();
+
+    LOG_INFO("READY TO SIDELOAD EXEs!");
+
+    std::vector<uint8_t> exe = festation::readFile<uint8_t>(path);
+    loadExe(exe, std::nullopt);
+}
+
+auto festation::PSXSystem::bootDisc() -> bool
+{
+    DiscBootConfig config{ .bootFile = "PSX.EXE;1", .stackPointer = DEFAULT_STACK_POINTER };
+
+    if (auto systemCnf = m_cdrom.readDiscFile("SYSTEM.CNF;1")) {
+        config = parseSystemCnf({ reinterpret_cast<const char*>(systemCnf->data()), systemCnf->size() });
+    }
+
+    auto exe = m_cdrom.readDiscFile(config.bootFile);
+
+    if (!exe) {
+        LOG_ERROR("Couldn't read boot file {} from the disc (error {})", config.bootFile, std::to_underlying(exe.error()));
+        return false;
+    }
+
+    runBiosUntilShell();
+
+    LOG_INFO("Booting {} from the disc", config.bootFile);
+
+    return loadExe(*exe, config.stackPointer);
+}
+
+auto festation::PSXSystem::runBiosUntilShell() -> void
+{
+    const uint64_t biosHash = m_bios.getImageHash();
+
+    if (m_isFastBootEnabled) {
+        if (auto snapshot = BootSnapshotCache::find(m_bootSnapshotsDirectory, biosHash)) {
+            /** @brief The drive state is whichever disc was in when it was taken, the current one starts afresh */
+            if (loadState(*snapshot)) {
+                m_cdrom.reset();
+                return;
+            }
+
+            LOG_WARN("Boot snapshot for BIOS {:016X} can't be loaded anymore, booting the BIOS again", biosHash);
+            BootSnapshotCache::invalidate(m_bootSnapshotsDirectory, biosHash);
+            reset();
+        }
+    }
+
     uint32_t& pcRef = m_cpu.getCPURegs().pc;
 
-    while (pcRef != 0x80030000)
+    while (pcRef != SHELL_ENTRY_POINT)
     {
-        uint8_t cycles = m_cpu.executeInstruction();
-        m_bios.checkKernerlTTYOutput();
+        uint32_t cycles = m_cpu.executeInstruction();
         m_totalElapsedCycles += cycles;
     }
 
-    LOG_INFO("READY TO SIDELOAD EXEs!");
+    if (m_isFastBootEnabled) {
+        std::vector<uint8_t> snapshot;
+        saveState(snapshot);
+        BootSnapshotCache::store(m_bootSnapshotsDirectory, biosHash, std::move(snapshot));
+    }
+}
 
-    std::vector<uint8_t> exe = festation::readFile<uint8_t>(path);
-    
-    constexpr size_t HEADER_SIZE = 2048;
+auto festation::PSXSystem::loadExe(std::span<const uint8_t> exe, std::optional<uint32_t> defaultStackPointer) -> bool
+{
+    if (exe.size() < EXE_HEADER_SIZE || std::memcmp(exe.data(), "PS-X EXE", 8) != 0) {
+        LOG_ERROR("Not a PS-X EXE file");
+        return false;
+    }
 
-    uint32_t initialPC = *reinterpret_cast<uint32_t*>(&exe[0x10]);
-    uint32_t initialR28 = *reinterpret_cast<uint32_t*>(&exe[0x14]);
-    uint32_t startExeRamAddress = *reinterpret_cast<uint32_t*>(&exe[0x18]) & MAIN_RAM_SIZE_MASK;
-    uint32_t exeSize = *reinterpret_cast<uint32_t*>(&exe[0x1C]); // 2KB multiples
-    uint32_t initialR29_R30 = *reinterpret_cast<uint32_t*>(&exe[0x30]);
+    uint32_t& pcRef = m_cpu.getCPURegs().pc;
+
+    uint32_t initialPC = *reinterpret_cast<const uint32_t*>(&exe[0x10]);
+    uint32_t initialR28 = *reinterpret_cast<const uint32_t*>(&exe[0x14]);
+    uint32_t startExeRamAddress = *reinterpret_cast<const uint32_t*>(&exe[0x18]) & MAIN_RAM_SIZE_MASK;
+    uint32_t exeSize = *reinterpret_cast<const uint32_t*>(&exe[0x1C]); // 2KB multiples
+    uint32_t initialR29_R30 = *reinterpret_cast<const uint32_t*>(&exe[0x30]);
+
+    if (initialR29_R30 == 0) {
+        initialR29_R30 = defaultStackPointer.value_or(0);
+    }
 
     m_cpu.getCPURegs().gpr_regs[28] = initialR28;
 
@@ -621,10 +787,19 @@ auto festation::PSXSystem::sideloadExeFile(const std::filesystem::path& path) ->
         m_cpu.getCPURegs().gpr_regs[30] = initialR29_R30;
     }
 
+    exeSize = std::min({ exeSize, static_cast<uint32_t>(exe.size() - EXE_HEADER_SIZE), static_cast<uint32_t>(MAIN_RAM_SIZE - startExeRamAddress) });
+
     std::memcpy(m_mainRAM.data() + startExeRamAddress, 
-        exe.data() + HEADER_SIZE, exeSize);
+        exe.data() + EXE_HEADER_SIZE, exeSize);
 
     pcRef = initialPC;
+
+    return true;
+}
+
+auto festation::PSXSystem::insertDisc(const std::filesystem::path& path) -> bool
+{
+    return m_cdrom.insertDisc(path);
 }
 
 auto festation::PSXSystem::onFrameEnded() -> void
@@ -632,10 +807,142 @@ auto festation::PSXSystem::onFrameEnded() -> void
     assert(m_frameEndCallback);
 
     m_gpu.renderFrame();
-    m_frameEndCallback();
 
-    m_scheduler.scheduleEvent({ EventType::VBlank, CYCLES_FER_FRAME_NTSC, 
-        [this]() {
-            onFrameEnded();
-        } });
+    if (m_outputMode == RenderOutputMode::Present) {
+        m_frameEndCallback();
+    }
+
+    m_movie.onFrameEnded();
+
+    m_hasFrameEnded = true;
+
+    m_scheduler.scheduleEvent(EventType::VBlank, CYCLES_FER_FRAME_NTSC);
+}
+
+auto festation::PSXSystem::saveState(std::vector<uint8_t>& output) -> void
+{
+    /** @brief RAM and VRAM dominate the size, avoid growing the buffer while writing them */
+    output.reserve(output.size() + MAIN_RAM_SIZE + 2 * VRAM_WIDTH * VRAM_HEIGHT * sizeof(uint16_t));
+
+    StateSerializer serializer(output);
+    serialize(serializer);
+}
+
+auto festation::PSXSystem::loadState(std::span<const uint8_t> input) -> std::expected<void, SaveStateError>
+{
+    StateSerializer headerReader(input);
+    uint32_t version = SAVE_STATE_VERSION;
+
+    if (!headerReader.beginSection(makeSectionTag("FEST"), version)) {
+        return std::unexpected(SaveStateError::InvalidFormatError);
+    }
+
+    if (version != SAVE_STATE_VERSION) {
+        LOG_ERROR("Save state version {} isn't supported (expected {})", version, SAVE_STATE_VERSION);
+        return std::unexpected(SaveStateError::UnsupportedVersionError);
+    }
+
+    /**
+     * @brief Header checked apart so the machine is left untouched on a mismatch. Anything failing later is
+     * rolled back to this snapshot, the host VRAM isn't in it: it's only replaced once the whole load succeeded.
+     */
+    m_rollbackState.clear();
+    StateSerializer rollbackWriter(m_rollbackState);
+    serialize(rollbackWriter, false);
+
+    StateSerializer serializer(input);
+    serialize(serializer);
+
+    if (serializer.hasError()) {
+        LOG_ERROR("Save state is corrupted, the previous state is restored");
+
+        StateSerializer rollbackReader{ std::span<const uint8_t>(m_rollbackState) };
+        serialize(rollbackReader, false);
+        assert(!rollbackReader.hasError());
+
+        m_gpu.finishStateLoad();
+        return std::unexpected(SaveStateError::CorruptedDataError);
+    }
+
+    m_gpu.finishStateLoad();
+    return {};
+}
+
+auto festation::PSXSystem::saveStateToFile(const std::filesystem::path& path) -> std::expected<void, SaveStateError>
+{
+    std::vector<uint8_t> state;
+    saveState(state);
+
+    std::ofstream fileStream{ path, std::ios::binary | std::ios::trunc };
+    fileStream.write(reinterpret_cast<const char*>(state.data()), state.size());
+
+    if (!fileStream) {
+        LOG_ERROR("Couldn't write save state to {}", path.string());
+        return std::unexpected(SaveStateError::FileError);
+    }
+
+    return {};
+}
+
+auto festation::PSXSystem::loadStateFromFile(const std::filesystem::path& path) -> std::expected<void, SaveStateError>
+{
+    std::error_code errorCode;
+
+    if (!std::filesystem::is_regular_file(path, errorCode)) {
+        LOG_ERROR("Save state {} doesn't exist", path.string());
+        return std::unexpected(SaveStateError::FileError);
+    }
+
+    std::vector<uint8_t> state = festation::readFile<uint8_t>(path);
+    return loadState(state);
+}
+
+auto festation::PSXSystem::startMovieRecording() -> void
+{
+    std::vector<uint8_t> initialState;
+    saveState(initialState);
+    m_movie.startRecording(std::move(initialState), m_totalElapsedCycles);
+}
+
+auto festation::PSXSystem::startMoviePlayback(Movie&& movie) -> std::expected<void, SaveStateError>
+{
+    if (auto result = loadState(movie.initialState); !result) {
+        return result;
+    }
+
+    m_movie.startPlayback(std::move(movie), m_totalElapsedCycles);
+    return {};
+}
+
+auto festation::PSXSystem::stopMovie() -> Movie
+{
+    return m_movie.stop();
+}
+
+auto festation::PSXSystem::serialize(StateSerializer& serializer, bool withRenderedVram) -> void
+{
+    uint32_t version = SAVE_STATE_VERSION;
+
+    if (!serializer.beginSection(makeSectionTag("FEST"), version))
+        return;
+
+    serializer.doValue(m_totalElapsedCycles);
+    serializer.doSpan(std::span(m_mainRAM));
+    serializer.doBool(m_isPadSending);
+    serializer.doValue(m_padCurrentByte);
+    serializer.doValue(m_latchedPadButtons);
+
+    m_scheduler.serialize(serializer);
+    m_interruptsHandler.serialize(serializer);
+    m_cpu.serialize(serializer);
+    m_cdrom.serialize(serializer);
+    m_bios.serialize(serializer);
+    m_dma.serialize(serializer);
+    m_gpu.serialize(serializer, withRenderedVram);
+
+    for (auto& timer : m_timers) {
+        timer.serialize(serializer);
+    }
+
+    serializer.endSection();
 }
\ No newline at end of file
@@ -8,17 +8,34 @@
 #include "gpu/gpu.hpp"
 #include "scheduler/scheduler.hpp"
 #include "timer/timer.hpp"
+#include "savestate/movie.hpp"
+#include "savestate/state_serializer.hpp"
 
 #include <vector>
 #include <array>
+#include <expected>
 #include <filesystem>
+#include <optional>
+#include <span>
 
 namespace festation
 {
+    /** @brief Host files a machine is built from, nothing in the core looks at the working directory by itself */
+    struct SystemPaths
+    {
+        std::filesystem::path biosFile;
+        std::filesystem::path shadersDirectory;
+        /** @brief Post-BIOS snapshots for fast boot, empty keeps them in memory only */
+        std::filesystem::path bootSnapshotsDirectory;
+
+        /** @brief Layout of the repository's res folder, relative to the build output directory */
+        static auto getDefault() -> SystemPaths;
+    };
+
     class PSXSystem
     {
     public:
-        PSXSystem();
+        PSXSystem(const SystemPaths& paths = SystemPaths::getDefault());
         ~PSXSystem();
 
         auto reset() -> void;
@@ -36,12 +53,65 @@ namespace festation
         auto write16(uint32_t address, uint16_t value) -> void;
         auto write32(uint32_t address, uint32_t value) -> void;
 
-        auto run() -> void;
+        /** @brief Runs one step of the CPU backend (a single instruction for the interpreter), returns the instructions executed */
+        auto run() -> uint32_t;
         auto runWholeFrame() -> void;
+        /**
+         * @brief Moves the machine time forward, dispatching the events that got due. Block based CPU backends
+         * call it in the middle of a block before touching memory, so devices see the time of that instruction.
+         */
+        auto advanceTime(uint64_t cycles) -> void;
+        auto getCyclesUntilNextEvent() const -> uint64_t { return m_scheduler.getCyclesUntilNextEvent(); }
+        /** @brief Runs until the next VBlank has been handled */
+        auto runFrame() -> void;
         auto sideloadExeFile(const std::filesystem::path& path) -> void;
+        auto insertDisc(const std::filesystem::path& path) -> bool;
+        /** @brief Loads the inserted disc's boot EXE (SYSTEM.CNF, PSX.EXE otherwise) and jumps to it, skipping the shell */
+        auto bootDisc() -> bool;
+
+        /** @brief Restores a snapshot taken at the shell entry point instead of running the BIOS intro (sideload and disc boot) */
+        auto setFastBoot(bool enabled) -> void { m_isFastBootEnabled = enabled; }
+        /** @brief Native kernel calls (off by default, enabled with --hle), off runs every A0h/B0h/C0h call through the BIOS code */
+        auto setKernelHleEnabled(bool enabled) -> void { m_bios.getHLE().setEnabled(enabled); }
+        auto setCpuBackend(CpuBackend backend) -> void { m_cpu.setBackend(backend); }
+
+        inline auto getCdrom() -> CdromDrive& { return m_cdrom; }
+        inline auto getMainRAM() -> std::span<uint8_t> { return m_mainRAM; }
+        inline auto getCpu() -> MIPS_R3000A_Core& { return m_cpu; }
+        inline auto getCpuProfiler() -> CpuProfiler& { return m_cpu.getProfiler(); }
+        auto startExecutionTrace(const std::filesystem::path& path) -> bool { return m_cpu.startExecutionTrace(path); }
+        auto stopExecutionTrace() -> void { m_cpu.stopExecutionTrace(); }
+
+        /** @brief Digital pad buttons, active low (0xFFFF = nothing pressed) */
+        auto setPadButtons(uint16_t buttons) -> void { m_padButtons = buttons; }
+
+        /** @brief Movie starts from a snapshot of the current state, pad polls and CD-ROM IRQs are logged from there */
+        auto startMovieRecording() -> void;
+        /** @brief Loads the movie's initial state, host pad input is ignored until the movie is stopped */
+        auto startMoviePlayback(Movie&& movie) -> std::expected<void, SaveStateError>;
+        auto stopMovie() -> Movie;
+        auto getMovieController() const -> const MovieController& { return m_movie; }
+
+        /** @brief Anything but Present also skips the frame end callback (swap, pacing and input polling) */
+        auto setOutputMode(RenderOutputMode mode) -> void;
+
+        /**
+         * @brief Snapshot of the whole machine, appended to output. Must be called between instructions
+         * (not from the frame end callback), the inserted disc is referenced by the caller, not stored.
+         */
+        auto saveState(std::vector<uint8_t>& output) -> void;
+        auto loadState(std::span<const uint8_t> input) -> std::expected<void, SaveStateError>;
+        auto saveStateToFile(const std::filesystem::path& path) -> std::expected<void, SaveStateError>;
+        auto loadStateFromFile(const std::filesystem::path& path) -> std::expected<void, SaveStateError>;
 
     private:
         auto onFrameEnded() -> void;
+        /** @brief Without the rendered VRAM (host GPU contents), loading such a state leaves them as they are */
+        auto serialize(StateSerializer& serializer, bool withRenderedVram = true) -> void;
+        /** @brief Runs the BIOS until it's about to enter the shell, the point EXEs are loaded at */
+        auto runBiosUntilShell() -> void;
+        /** @brief Stack from the EXE header, defaultStackPointer when it's 0 (the BIOS one is kept if that's empty too) */
+        auto loadExe(std::span<const uint8_t> exe, std::optional<uint32_t> defaultStackPointer) -> bool;
 
     private:
         Scheduler m_scheduler;
@@ -53,7 +123,18 @@ namespace festation
         DmaControl m_dma;
         PsxGpu m_gpu;
         std::array<Timer, 3> m_timers;
-        uint64_t m_totalElapsedCycles;
+        uint64_t m_totalElapsedCycles{};
         std::function<void(void)> m_frameEndCallback;
+        RenderOutputMode m_outputMode{ RenderOutputMode::Present };
+        uint16_t m_padButtons{ 0xFFFF };
+        uint16_t m_latchedPadButtons{ 0xFFFF };
+        bool m_isPadSending{};
+        uint8_t m_padCurrentByte{};
+        MovieController m_movie{};
+        bool m_hasFrameEnded{};
+        /** @brief Machine state before the last load, restored if it fails. Kept to reuse its buffer */
+        std::vector<uint8_t> m_rollbackState{};
+        std::filesystem::path m_bootSnapshotsDirectory;
+        bool m_isFastBootEnabled{};
     };
 };
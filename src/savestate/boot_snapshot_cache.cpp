@@ -0,0 +1,89 @@
+#include "boot_snapshot_cache.hpp"
+#include "utils/file_reader.hpp"
+#include "utils/logger.hpp"
+
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace festation {
+    static std::mutex s_snapshotsMutex;
+    static std::unordered_map<uint64_t, std::shared_ptr<const std::vector<uint8_t>>> s_snapshots;
+
+    static auto getSnapshotPath(const std::filesystem::path& directory, uint64_t biosHash) -> std::filesystem::path
+    {
+        return directory / std::format("boot_{:016X}.fst", biosHash);
+    }
+};
+
+auto festation::BootSnapshotCache::find(const std::filesystem::path& directory, uint64_t biosHash) -> std::shared_ptr<const std::vector<uint8_t>>
+{
+    std::scoped_lock lock(s_snapshotsMutex);
+
+    if (auto it = s_snapshots.find(biosHash); it != s_snapshots.end())
+        return it->second;
+
+    if (directory.empty())
+        return nullptr;
+
+    const std::filesystem::path path = getSnapshotPath(directory, biosHash);
+    std::error_code errorCode;
+
+    if (!std::filesystem::is_regular_file(path, errorCode))
+        return nullptr;
+
+    auto snapshot = std::make_shared<const std::vector<uint8_t>>(festation::readFile<uint8_t>(path));
+    s_snapshots[biosHash] = snapshot;
+
+    return snapshot;
+}
+
+auto festation::BootSnapshotCache::store(const std::filesystem::path& directory, uint64_t biosHash, std::vector<uint8_t>&& state) -> void
+{
+    auto snapshot = std::make_shared<const std::vector<uint8_t>>(std::move(state));
+
+    std::scoped_lock lock(s_snapshotsMutex);
+    s_snapshots[biosHash] = snapshot;
+
+    if (directory.empty())
+        return;
+
+    std::error_code errorCode;
+    std::filesystem::create_directories(directory, errorCode);
+
+    /** @brief Written aside and renamed, other processes booting the same BIOS never see a partial file */
+    const std::filesystem::path path = getSnapshotPath(directory, biosHash);
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += std::format(".{}.tmp", std::chrono::steady_clock::now().time_since_epoch().count());
+
+    {
+        std::ofstream fileStream{ temporaryPath, std::ios::binary | std::ios::trunc };
+        fileStream.write(reinterpret_cast<const char*>(snapshot->data()), snapshot->size());
+
+        if (!fileStream) {
+            LOG_WARN("Couldn't write boot snapshot to {}", temporaryPath.string());
+            std::filesystem::remove(temporaryPath, errorCode);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, errorCode);
+
+    if (errorCode) {
+        LOG_WARN("Couldn't write boot snapshot to {}", path.string());
+        std::filesystem::remove(temporaryPath, errorCode);
+    }
+}
+
+auto festation::BootSnapshotCache::invalidate(const std::filesystem::path& directory, uint64_t biosHash) -> void
+{
+    std::scoped_lock lock(s_snapshotsMutex);
+    s_snapshots.erase(biosHash);
+
+    if (!directory.empty()) {
+        std::error_code errorCode;
+        std::filesystem::remove(getSnapshotPath(directory, biosHash), errorCode);
+    }
+}
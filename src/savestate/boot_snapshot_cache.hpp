@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace festation {
+    /**
+     * @brief Machine states right after the BIOS initialized the kernel (shell entry point), one per BIOS
+     * image hash. Kept in memory for the whole process and on disk as <directory>/boot_<hash>.fst,
+     * so only the first launch with a given BIOS pays for the boot.
+     */
+    class BootSnapshotCache {
+    public:
+        /** @brief Empty directory only looks in memory */
+        static auto find(const std::filesystem::path& directory, uint64_t biosHash) -> std::shared_ptr<const std::vector<uint8_t>>;
+        static auto store(const std::filesystem::path& directory, uint64_t biosHash, std::vector<uint8_t>&& state) -> void;
+        /** @brief Drops a snapshot the current build can't load anymore (e.g. the save state version changed) */
+        static auto invalidate(const std::filesystem::path& directory, uint64_t biosHash) -> void;
+    };
+};
@@ -0,0 +1,190 @@
+#include "movie.hpp"
+#include "utils/file_reader.hpp"
+#include "utils/logger.hpp"
+
+#include <fstream>
+#include <utility>
+
+namespace festation {
+    static constexpr uint32_t MOVIE_FORMAT_VERSION = 1;
+};
+
+auto festation::Movie::saveToFile(const std::filesystem::path& path) const -> std::expected<void, SaveStateError>
+{
+    std::vector<uint8_t> output;
+    StateSerializer serializer(output);
+    uint32_t version = MOVIE_FORMAT_VERSION;
+
+    /** @brief The serializer works on mutable references, saving never modifies them */
+    Movie& movie = const_cast<Movie&>(*this);
+
+    serializer.beginSection(makeSectionTag("FMOV"), version);
+    serializer.doValue(movie.framesCount);
+    serializer.doVector(movie.initialState);
+    serializer.doVector(movie.events);
+    serializer.endSection();
+
+    std::ofstream fileStream{ path, std::ios::binary | std::ios::trunc };
+    fileStream.write(reinterpret_cast<const char*>(output.data()), output.size());
+
+    if (!fileStream) {
+        LOG_ERROR("Couldn't write movie to {}", path.string());
+        return std::unexpected(SaveStateError::FileError);
+    }
+
+    return {};
+}
+
+auto festation::Movie::loadFromFile(const std::filesystem::path& path) -> std::expected<Movie, SaveStateError>
+{
+    std::error_code errorCode;
+
+    if (!std::filesystem::is_regular_file(path, errorCode)) {
+        LOG_ERROR("Movie {} doesn't exist", path.string());
+        return std::unexpected(SaveStateError::FileError);
+    }
+
+    std::vector<uint8_t> input = festation::readFile<uint8_t>(path);
+    StateSerializer serializer{ std::span<const uint8_t>(input) };
+    uint32_t version = MOVIE_FORMAT_VERSION;
+
+    if (!serializer.beginSection(makeSectionTag("FMOV"), version)) {
+        return std::unexpected(SaveStateError::InvalidFormatError);
+    }
+
+    if (version != MOVIE_FORMAT_VERSION) {
+        return std::unexpected(SaveStateError::UnsupportedVersionError);
+    }
+
+    Movie movie{};
+    serializer.doValue(movie.framesCount);
+    serializer.doVector(movie.initialState);
+    serializer.doVector(movie.events);
+    serializer.endSection();
+
+    if (serializer.hasError()) {
+        return std::unexpected(SaveStateError::CorruptedDataError);
+    }
+
+    return movie;
+}
+
+auto festation::MovieController::startRecording(std::vector<uint8_t>&& initialState, uint64_t startCycle) -> void
+{
+    m_movie = Movie{ .initialState = std::move(initialState), .events = {}, .framesCount = 0 };
+    m_mode = MovieMode::Recording;
+    m_startCycle = startCycle;
+    m_currentFrame = 0;
+    m_nextEvent = 0;
+    m_isDesynced = false;
+}
+
+auto festation::MovieController::startPlayback(Movie&& movie, uint64_t startCycle) -> void
+{
+    m_movie = std::move(movie);
+    m_mode = MovieMode::Playing;
+    m_startCycle = startCycle;
+    m_currentFrame = 0;
+    m_nextEvent = 0;
+    m_isDesynced = false;
+}
+
+auto festation::MovieController::stop() -> Movie
+{
+    if (m_mode == MovieMode::Recording) {
+        m_movie.framesCount = m_currentFrame;
+    }
+
+    m_mode = MovieMode::Idle;
+    return std::exchange(m_movie, {});
+}
+
+auto festation::MovieController::isPlaybackFinished() const -> bool
+{
+    return m_mode == MovieMode::Playing && m_currentFrame >= m_movie.framesCount;
+}
+
+auto festation::MovieController::onPadPoll(uint64_t cycle, uint16_t hostButtons) -> uint16_t
+{
+    switch (m_mode)
+    {
+    case MovieMode::Recording:
+        m_movie.events.push_back({
+            .cycle = cycle - m_startCycle,
+            .type = MovieEventType::PadPoll,
+            .reserved = 0,
+            .value = hostButtons,
+            .padding = 0,
+        });
+        return hostButtons;
+    case MovieMode::Playing:
+    {
+        /** @brief Host input is ignored during playback, buttons come from the movie (or none past a desync) */
+        const MovieEvent* event = matchPlaybackEvent(MovieEventType::PadPoll, cycle);
+        return event ? event->value : 0xFFFF;
+    }
+    default:
+        return hostButtons;
+    }
+}
+
+auto festation::MovieController::onCdromInterrupt(uint64_t cycle, uint8_t interruptType) -> void
+{
+    switch (m_mode)
+    {
+    case MovieMode::Recording:
+        m_movie.events.push_back({
+            .cycle = cycle - m_startCycle,
+            .type = MovieEventType::CdromInterrupt,
+            .reserved = 0,
+            .value = interruptType,
+            .padding = 0,
+        });
+        break;
+    case MovieMode::Playing:
+        if (const MovieEvent* event = matchPlaybackEvent(MovieEventType::CdromInterrupt, cycle);
+            event && event->value != interruptType) {
+            reportDesync("CD-ROM interrupt type differs", cycle);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+auto festation::MovieController::onFrameEnded() -> void
+{
+    if (m_mode != MovieMode::Idle) {
+        m_currentFrame++;
+    }
+}
+
+auto festation::MovieController::matchPlaybackEvent(MovieEventType type, uint64_t cycle) -> const MovieEvent*
+{
+    if (m_isDesynced)
+        return nullptr;
+
+    if (m_nextEvent == m_movie.events.size()) {
+        reportDesync("no more recorded events", cycle);
+        return nullptr;
+    }
+
+    const MovieEvent& event = m_movie.events[m_nextEvent];
+
+    if (event.type != type || event.cycle != cycle - m_startCycle) {
+        reportDesync("event doesn't match the recording", cycle);
+        return nullptr;
+    }
+
+    m_nextEvent++;
+    return &event;
+}
+
+auto festation::MovieController::reportDesync(const char* reason, uint64_t cycle) -> void
+{
+    if (!m_isDesynced) {
+        LOG_ERROR("Movie desync at cycle {} (frame {}): {}", cycle - m_startCycle, m_currentFrame, reason);
+    }
+
+    m_isDesynced = true;
+}
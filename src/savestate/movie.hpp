@@ -0,0 +1,74 @@
+#pragma once
+
+#include "state_serializer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <vector>
+
+namespace festation {
+    enum class MovieEventType : uint8_t {
+        /** @brief A pad transfer started, value holds the buttons (active low) the machine saw */
+        PadPoll,
+        /** @brief Sync marker, value holds the CD-ROM INT type. Only checked on playback */
+        CdromInterrupt,
+    };
+
+    /** @brief Cycles are counted from the movie's initial state */
+    struct MovieEvent {
+        uint64_t cycle;
+        MovieEventType type;
+        uint8_t reserved;
+        uint16_t value;
+        uint32_t padding;
+    };
+
+    /** @brief Starting save state plus every external input after it, which is enough to replay the session exactly */
+    struct Movie {
+        std::vector<uint8_t> initialState;
+        std::vector<MovieEvent> events;
+        uint64_t framesCount;
+
+        auto saveToFile(const std::filesystem::path& path) const -> std::expected<void, SaveStateError>;
+        static auto loadFromFile(const std::filesystem::path& path) -> std::expected<Movie, SaveStateError>;
+    };
+
+    enum class MovieMode {
+        Idle,
+        Recording,
+        Playing,
+    };
+
+    class MovieController {
+    public:
+        auto startRecording(std::vector<uint8_t>&& initialState, uint64_t startCycle) -> void;
+        auto startPlayback(Movie&& movie, uint64_t startCycle) -> void;
+        auto stop() -> Movie;
+
+        auto getMode() const -> MovieMode { return m_mode; }
+        auto getMovie() const -> const Movie& { return m_movie; }
+        auto getCurrentFrame() const -> uint64_t { return m_currentFrame; }
+        auto isDesynced() const -> bool { return m_isDesynced; }
+        auto isPlaybackFinished() const -> bool;
+
+        /** @brief Returns the buttons the machine has to see: the host ones while recording, the recorded ones on playback */
+        auto onPadPoll(uint64_t cycle, uint16_t hostButtons) -> uint16_t;
+        auto onCdromInterrupt(uint64_t cycle, uint8_t interruptType) -> void;
+        auto onFrameEnded() -> void;
+
+    private:
+        /** @brief Next recorded event if it matches the one just emulated, reports a desync otherwise */
+        auto matchPlaybackEvent(MovieEventType type, uint64_t cycle) -> const MovieEvent*;
+        auto reportDesync(const char* reason, uint64_t cycle) -> void;
+
+    private:
+        Movie m_movie{};
+        MovieMode m_mode{ MovieMode::Idle };
+        uint64_t m_startCycle{};
+        uint64_t m_currentFrame{};
+        size_t m_nextEvent{};
+        bool m_isDesynced{};
+    };
+};
@@ -0,0 +1,286 @@
+#include "rewind_buffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace festation {
+    /** @brief Snapshots waiting for the worker, older ones are dropped if it can't keep up */
+    static constexpr size_t MAX_PENDING_STATES = 4;
+    /** @brief Shorter zero runs are cheaper to keep inside a literal than to split it */
+    static constexpr size_t MIN_ZERO_RUN = 4;
+    static constexpr size_t MAX_FREE_BUFFERS = 2;
+
+    static auto writeVarUint(std::vector<uint8_t>& output, size_t value) -> void
+    {
+        while (value >= 0x80) {
+            output.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    static auto readVarUint(std::span<const uint8_t> input, size_t& position) -> size_t
+    {
+        size_t value = 0;
+
+        for (size_t shift = 0; position < input.size(); shift += 7) {
+            const uint8_t byte = input[position++];
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+                break;
+        }
+
+        return value;
+    }
+
+    static inline auto getXorByte(std::span<const uint8_t> older, std::span<const uint8_t> newer, size_t index) -> uint8_t
+    {
+        const uint8_t olderByte = (index < older.size()) ? older[index] : 0;
+        const uint8_t newerByte = (index < newer.size()) ? newer[index] : 0;
+        return olderByte ^ newerByte;
+    }
+
+    static inline auto loadWord(std::span<const uint8_t> data, size_t index) -> uint64_t
+    {
+        uint64_t word;
+        std::memcpy(&word, data.data() + index, sizeof(uint64_t));
+        return word;
+    }
+};
+
+festation::RewindBuffer::RewindBuffer(size_t memoryBudgetBytes)
+    : m_memoryBudget(memoryBudgetBytes)
+{
+    m_worker = std::jthread([this](std::stop_token stopToken) {
+        workerLoop(stopToken);
+    });
+}
+
+festation::RewindBuffer::~RewindBuffer()
+{
+    m_worker.request_stop();
+    m_wakeUp.notify_all();
+}
+
+auto festation::RewindBuffer::acquireStateBuffer() -> std::vector<uint8_t>
+{
+    std::scoped_lock lock(m_mutex);
+
+    if (m_freeBuffers.empty())
+        return {};
+
+    std::vector<uint8_t> buffer = std::move(m_freeBuffers.back());
+    m_freeBuffers.pop_back();
+    buffer.clear();
+    return buffer;
+}
+
+auto festation::RewindBuffer::push(std::vector<uint8_t>&& state) -> void
+{
+    {
+        std::scoped_lock lock(m_mutex);
+
+        if (m_pendingStates.size() == MAX_PENDING_STATES) {
+            m_pendingStates.pop_front();
+            m_stats.droppedSnapshots++;
+        }
+
+        m_pendingStates.push_back(std::move(state));
+    }
+
+    m_wakeUp.notify_one();
+}
+
+auto festation::RewindBuffer::pop() -> std::optional<std::vector<uint8_t>>
+{
+    std::unique_lock lock(m_mutex);
+    waitUntilIdle(lock);
+
+    if (!m_newestState)
+        return std::nullopt;
+
+    std::vector<uint8_t> result = std::move(*m_newestState);
+    m_newestState.reset();
+
+    if (!m_deltas.empty()) {
+        Delta& delta = m_deltas.back();
+        std::vector<uint8_t> previousState(result);
+        applyXorDelta(delta, previousState);
+
+        m_deltasBytes -= delta.encoded.size();
+        m_deltas.pop_back();
+        m_newestState = std::move(previousState);
+    }
+
+    m_stats.snapshotsCount = m_deltas.size() + (m_newestState ? 1 : 0);
+    m_stats.storedBytes = m_deltasBytes + (m_newestState ? m_newestState->size() : 0);
+    return result;
+}
+
+auto festation::RewindBuffer::clear() -> void
+{
+    std::unique_lock lock(m_mutex);
+    m_pendingStates.clear();
+    waitUntilIdle(lock);
+
+    m_newestState.reset();
+    m_deltas.clear();
+    m_deltasBytes = 0;
+    m_stats.snapshotsCount = 0;
+    m_stats.storedBytes = 0;
+}
+
+auto festation::RewindBuffer::getStats() const -> RewindStats
+{
+    std::scoped_lock lock(m_mutex);
+    return m_stats;
+}
+
+auto festation::RewindBuffer::waitUntilIdle(std::unique_lock<std::mutex>& lock) -> void
+{
+    m_idle.wait(lock, [this]() {
+        return m_pendingStates.empty() && !m_isEncoding;
+    });
+}
+
+auto festation::RewindBuffer::workerLoop(std::stop_token stopToken) -> void
+{
+    while (!stopToken.stop_requested()) {
+        std::vector<uint8_t> state;
+
+        {
+            std::unique_lock lock(m_mutex);
+
+            if (!m_wakeUp.wait(lock, stopToken, [this]() { return !m_pendingStates.empty(); }))
+                break;
+
+            state = std::move(m_pendingStates.front());
+            m_pendingStates.pop_front();
+            m_isEncoding = true;
+        }
+
+        storeState(std::move(state));
+
+        {
+            std::scoped_lock lock(m_mutex);
+            m_isEncoding = false;
+        }
+
+        m_idle.notify_all();
+    }
+}
+
+auto festation::RewindBuffer::storeState(std::vector<uint8_t>&& state) -> void
+{
+    std::optional<std::vector<uint8_t>> previousState{};
+
+    {
+        std::scoped_lock lock(m_mutex);
+        previousState = std::move(m_newestState);
+        m_newestState.reset();
+    }
+
+    Delta delta{};
+
+    /** @brief Nobody else touches the history while m_isEncoding is set, so encoding can run unlocked */
+    if (previousState) {
+        delta.olderStateSize = previousState->size();
+        encodeXorDelta(*previousState, state, delta.encoded);
+        delta.encoded.shrink_to_fit();
+    }
+
+    std::scoped_lock lock(m_mutex);
+
+    if (previousState) {
+        m_deltasBytes += delta.encoded.size();
+        m_deltas.push_back(std::move(delta));
+
+        if (m_freeBuffers.size() < MAX_FREE_BUFFERS) {
+            m_freeBuffers.push_back(std::move(*previousState));
+        }
+    }
+
+    m_newestState = std::move(state);
+
+    while (!m_deltas.empty() && m_deltasBytes + m_newestState->size() > m_memoryBudget) {
+        m_deltasBytes -= m_deltas.front().encoded.size();
+        m_deltas.pop_front();
+        m_stats.droppedSnapshots++;
+    }
+
+    m_stats.snapshotsCount = m_deltas.size() + 1;
+    m_stats.storedBytes = m_deltasBytes + m_newestState->size();
+}
+
+/**
+ * @brief Stream of (zero run length, literal length, literal bytes) records, lengths as LEB128.
+ * Sizes may differ (e.g. a pending GPU blit), the shorter state reads as zero padded.
+ */
+auto festation::RewindBuffer::encodeXorDelta(std::span<const uint8_t> older, std::span<const uint8_t> newer, std::vector<uint8_t>& output) -> void
+{
+    const size_t length = std::max(older.size(), newer.size());
+    const size_t commonLength = std::min(older.size(), newer.size());
+    size_t index = 0;
+
+    while (index < length) {
+        const size_t zeroRunStart = index;
+
+        while (index + sizeof(uint64_t) <= commonLength && loadWord(older, index) == loadWord(newer, index)) {
+            index += sizeof(uint64_t);
+        }
+
+        while (index < length && getXorByte(older, newer, index) == 0) {
+            index++;
+        }
+
+        const size_t literalStart = index;
+        size_t literalEnd = index;
+
+        while (literalEnd < length) {
+            size_t zerosEnd = literalEnd;
+
+            while (zerosEnd < length && zerosEnd - literalEnd < MIN_ZERO_RUN && getXorByte(older, newer, zerosEnd) == 0) {
+                zerosEnd++;
+            }
+
+            if (zerosEnd == length || zerosEnd - literalEnd == MIN_ZERO_RUN)
+                break;
+
+            literalEnd = zerosEnd + 1;
+        }
+
+        writeVarUint(output, literalStart - zeroRunStart);
+        writeVarUint(output, literalEnd - literalStart);
+
+        for (size_t i = literalStart; i < literalEnd; i++) {
+            output.push_back(getXorByte(older, newer, i));
+        }
+
+        index = literalEnd;
+    }
+}
+
+auto festation::RewindBuffer::applyXorDelta(const Delta& delta, std::vector<uint8_t>& state) -> void
+{
+    state.resize(std::max(state.size(), delta.olderStateSize));
+
+    const std::span<const uint8_t> encoded = delta.encoded;
+    size_t position = 0;
+    size_t index = 0;
+
+    while (position < encoded.size()) {
+        index += readVarUint(encoded, position);
+        const size_t literalLength = readVarUint(encoded, position);
+
+        assert(index + literalLength <= state.size() && position + literalLength <= encoded.size());
+
+        for (size_t i = 0; i < literalLength; i++) {
+            state[index++] ^= encoded[position++];
+        }
+    }
+
+    state.resize(delta.olderStateSize);
+}
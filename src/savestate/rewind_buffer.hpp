@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace festation {
+    struct RewindStats {
+        uint64_t snapshotsCount;
+        uint64_t storedBytes;
+        uint64_t droppedSnapshots;
+    };
+
+    /**
+     * @brief History of save states for rewinding. Only the newest state is kept whole, every older one
+     * is stored as the XOR against the state that followed it, run-length encoded (RAM and VRAM barely
+     * change between snapshots so the deltas are mostly zero runs). Encoding runs on a worker thread.
+     */
+    class RewindBuffer {
+    public:
+        explicit RewindBuffer(size_t memoryBudgetBytes);
+        ~RewindBuffer();
+
+        RewindBuffer(const RewindBuffer&) = delete;
+        RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+        /** @brief Recycled buffer to save the next state into, avoids a multi MB allocation per snapshot */
+        auto acquireStateBuffer() -> std::vector<uint8_t>;
+
+        /** @brief Takes a whole serialized state, it's delta encoded against the previous one in the background */
+        auto push(std::vector<uint8_t>&& state) -> void;
+
+        /** @brief Removes and returns the newest snapshot, successive calls walk back in time */
+        auto pop() -> std::optional<std::vector<uint8_t>>;
+
+        auto clear() -> void;
+        auto getStats() const -> RewindStats;
+
+    private:
+        struct Delta {
+            std::vector<uint8_t> encoded;
+            size_t olderStateSize;
+        };
+
+        auto workerLoop(std::stop_token stopToken) -> void;
+        auto storeState(std::vector<uint8_t>&& state) -> void;
+        auto waitUntilIdle(std::unique_lock<std::mutex>& lock) -> void;
+
+        static auto encodeXorDelta(std::span<const uint8_t> older, std::span<const uint8_t> newer, std::vector<uint8_t>& output) -> void;
+        static auto applyXorDelta(const Delta& delta, std::vector<uint8_t>& state) -> void;
+
+    private:
+        size_t m_memoryBudget;
+
+        /** @brief Whole copy of the newest snapshot, the base every delta is applied from */
+        std::optional<std::vector<uint8_t>> m_newestState{};
+        /** @brief Oldest first, back() turns m_newestState into the snapshot before it */
+        std::deque<Delta> m_deltas{};
+        size_t m_deltasBytes{};
+        RewindStats m_stats{};
+
+        std::deque<std::vector<uint8_t>> m_pendingStates{};
+        std::vector<std::vector<uint8_t>> m_freeBuffers{};
+        bool m_isEncoding{};
+
+        mutable std::mutex m_mutex;
+        std::condition_variable_any m_wakeUp;
+        std::condition_variable_any m_idle;
+        std::jthread m_worker;
+    };
+};
@@ -0,0 +1,83 @@
+#include "state_serializer.hpp"
+#include "utils/logger.hpp"
+
+#include <cassert>
+
+festation::StateSerializer::StateSerializer(std::vector<uint8_t>& output)
+    : m_output(&output), m_position(output.size())
+{
+}
+
+festation::StateSerializer::StateSerializer(std::span<const uint8_t> input)
+    : m_input(input)
+{
+}
+
+auto festation::StateSerializer::beginSection(uint32_t tag, uint32_t& version) -> bool
+{
+    if (m_hasError)
+        return false;
+
+    uint32_t storedTag = tag;
+    uint32_t size = 0;
+
+    doValue(storedTag);
+    doValue(version);
+    doValue(size);
+
+    if (isLoading() && (m_hasError || storedTag != tag)) {
+        LOG_ERROR("Save state: expected section {:08X}h, found {:08X}h", tag, storedTag);
+        m_hasError = true;
+        return false;
+    }
+
+    /** @brief Position right after the header, used to patch (saving) or check (loading) the payload size */
+    m_openSections.push_back(isLoading() ? m_position + size : m_position);
+    return true;
+}
+
+auto festation::StateSerializer::endSection() -> void
+{
+    assert(!m_openSections.empty());
+
+    const size_t mark = m_openSections.back();
+    m_openSections.pop_back();
+
+    if (m_hasError)
+        return;
+
+    if (isLoading()) {
+        /** @brief Newer minor revisions may append fields, older readers just skip them */
+        if (m_position > mark || mark > m_input.size()) {
+            m_hasError = true;
+            return;
+        }
+
+        m_position = mark;
+    }
+    else {
+        uint32_t size = static_cast<uint32_t>(m_position - mark);
+        std::memcpy(m_output->data() + mark - sizeof(uint32_t), &size, sizeof(uint32_t));
+    }
+}
+
+auto festation::StateSerializer::doBytes(void* data, size_t size) -> void
+{
+    if (m_hasError)
+        return;
+
+    if (isLoading()) {
+        if (size > m_input.size() - m_position) {
+            m_hasError = true;
+            return;
+        }
+
+        std::memcpy(data, m_input.data() + m_position, size);
+    }
+    else {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        m_output->insert(m_output->end(), bytes, bytes + size);
+    }
+
+    m_position += size;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace festation {
+    enum class SaveStateError {
+        FileError,
+        InvalidFormatError,
+        UnsupportedVersionError,
+        CorruptedDataError,
+    };
+
+    inline constexpr auto makeSectionTag(const char (&name)[5]) -> uint32_t
+    {
+        return static_cast<uint32_t>(name[0]) | (static_cast<uint32_t>(name[1]) << 8)
+            | (static_cast<uint32_t>(name[2]) << 16) | (static_cast<uint32_t>(name[3]) << 24);
+    }
+
+    /**
+     * @brief Single code path for saving and loading: components describe their state once with the do* calls
+     * and the serializer either appends it to the output buffer or reads it back, depending on the mode.
+     * State is laid out in tagged sections (tag, version, size) so each component can evolve on its own.
+     */
+    class StateSerializer {
+    public:
+        /** @brief Saving mode, data is appended to output */
+        explicit StateSerializer(std::vector<uint8_t>& output);
+        /** @brief Loading mode */
+        explicit StateSerializer(std::span<const uint8_t> input);
+
+        auto isLoading() const -> bool { return m_output == nullptr; }
+        auto hasError() const -> bool { return m_hasError; }
+
+        /**
+         * @brief Saving writes the section header with the current version. Loading checks the tag
+         * and returns the stored version in version (components may need it to read older layouts).
+         */
+        auto beginSection(uint32_t tag, uint32_t& version) -> bool;
+        auto endSection() -> void;
+
+        auto doBytes(void* data, size_t size) -> void;
+
+        template<class T> requires std::is_trivially_copyable_v<T>
+        auto doValue(T& value) -> void {
+            doBytes(&value, sizeof(T));
+        }
+
+        auto doBool(bool& value) -> void {
+            uint8_t raw = value;
+            doValue(raw);
+            value = raw != 0;
+        }
+
+        template<class T, size_t N> requires std::is_trivially_copyable_v<T>
+        auto doArray(std::array<T, N>& array) -> void {
+            doBytes(array.data(), sizeof(T) * N);
+        }
+
+        template<class T> requires std::is_trivially_copyable_v<T>
+        auto doSpan(std::span<T> span) -> void {
+            doBytes(span.data(), span.size_bytes());
+        }
+
+        /** @brief Element count is stored too, the vector is resized on load */
+        template<class T> requires std::is_trivially_copyable_v<T>
+        auto doVector(std::vector<T>& vector) -> void {
+            uint32_t size = static_cast<uint32_t>(vector.size());
+            doValue(size);
+
+            if (isLoading()) {
+                if (size * sizeof(T) > m_input.size() - m_position) {
+                    m_hasError = true;
+                    return;
+                }
+
+                vector.resize(size);
+            }
+
+            doBytes(vector.data(), size * sizeof(T));
+        }
+
+    private:
+        std::vector<uint8_t>* m_output{};
+        std::span<const uint8_t> m_input{};
+        size_t m_position{};
+        std::vector<size_t> m_openSections{};
+        bool m_hasError{};
+    };
+};
@@ -1,7 +1,7 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
 
 namespace festation {
     enum class EventType {
@@ -15,19 +15,29 @@ namespace festation {
         Timer0Int,
         Timer1Int,
         Timer2Int,
+        Count,
     };
 
+    inline constexpr size_t EVENT_TYPES_COUNT = static_cast<size_t>(EventType::Count);
+
+    /**
+     * @brief Plain data so pending events can be saved with the rest of the machine state.
+     * What happens when it fires is decided by the handler registered for its type.
+     */
     struct Event {
         EventType type;
         uint64_t time;
-        std::function<void(void)> callback;
+        /** @brief Insertion order, keeps events due on the same cycle dispatched in a stable order */
+        uint64_t sequence;
+        /** @brief Handler specific argument (e.g. the CD-ROM command an INT3 responds to) */
+        uint64_t param;
 
         bool operator<(const Event& other) const {
-            return this->time < other.time;
+            return this->time < other.time || (this->time == other.time && this->sequence < other.sequence);
         }
 
         bool operator>(const Event& other) const {
-            return this->time > other.time;
+            return other < *this;
         }
     };
 };
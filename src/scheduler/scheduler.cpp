@@ -1,29 +1,100 @@
 #include "scheduler.hpp"
 #include "event_types.hpp"
+#include "savestate/state_serializer.hpp"
 
-auto festation::Scheduler::scheduleEvent(Event&& event) -> void
+#include <algorithm>
+#include <cassert>
+
+namespace festation {
+    static constexpr uint32_t SCHEDULER_STATE_VERSION = 1;
+};
+
+auto festation::Scheduler::setEventHandler(EventType type, EventHandler handler) -> void
+{
+    m_eventHandlers[static_cast<size_t>(type)] = std::move(handler);
+}
+
+auto festation::Scheduler::scheduleEvent(EventType type, uint64_t delay, uint64_t param) -> void
 {
-    event.time += m_globalTime;
-    m_eventsQueue.push(event);
+    m_eventsHeap.push_back({
+        .type = type,
+        .time = m_globalTime + delay,
+        .sequence = m_nextSequence++,
+        .param = param,
+    });
+
+    std::ranges::push_heap(m_eventsHeap, std::greater<Event>{});
+}
+
+auto festation::Scheduler::cancelEvents(EventType type) -> void
+{
+    const size_t removedEvents = std::erase_if(m_eventsHeap, [type](const Event& event) { return event.type == type; });
+
+    if (removedEvents != 0) {
+        std::ranges::make_heap(m_eventsHeap, std::greater<Event>{});
+    }
 }
 
 auto festation::Scheduler::step(uint64_t cycles) -> void
 {
-    m_globalTime += cycles;
+    const uint64_t targetTime = m_globalTime + cycles;
 
-    while (eventPending()) {
+    while (eventPending(targetTime)) {
+        m_globalTime = std::max(m_globalTime, m_eventsHeap.front().time);
         dispatchNearestEvent();
     }
+
+    m_globalTime = targetTime;
+}
+
+auto festation::Scheduler::getCyclesUntilNextEvent() const -> uint64_t
+{
+    if (m_eventsHeap.empty())
+        return UINT64_MAX;
+
+    const uint64_t nextEventTime = m_eventsHeap.front().time;
+
+    return (nextEventTime > m_globalTime) ? nextEventTime - m_globalTime : 0;
+}
+
+auto festation::Scheduler::reset() -> void
+{
+    m_eventsHeap.clear();
+    m_globalTime = 0;
+    m_nextSequence = 0;
+}
+
+auto festation::Scheduler::serialize(StateSerializer& serializer) -> void
+{
+    uint32_t version = SCHEDULER_STATE_VERSION;
+
+    if (!serializer.beginSection(makeSectionTag("SCHD"), version))
+        return;
+
+    serializer.doValue(m_globalTime);
+    serializer.doValue(m_nextSequence);
+    serializer.doVector(m_eventsHeap);
+
+    /** @brief Heap order is saved as is, but never trust it blindly */
+    if (serializer.isLoading()) {
+        std::ranges::make_heap(m_eventsHeap, std::greater<Event>{});
+    }
+
+    serializer.endSection();
 }
 
-auto festation::Scheduler::eventPending() const -> bool
+auto festation::Scheduler::eventPending(uint64_t time) const -> bool
 {
-    return !m_eventsQueue.empty() && m_globalTime >= m_eventsQueue.top().time;
+    return !m_eventsHeap.empty() && time >= m_eventsHeap.front().time;
 }
 
 auto festation::Scheduler::dispatchNearestEvent() -> void
 {
-    Event event = m_eventsQueue.top();
-    m_eventsQueue.pop();
-    event.callback();
-}
\ No newline at end of file
+    std::ranges::pop_heap(m_eventsHeap, std::greater<Event>{});
+    Event event = m_eventsHeap.back();
+    m_eventsHeap.pop_back();
+
+    const EventHandler& handler = m_eventHandlers[static_cast<size_t>(event.type)];
+    assert(handler);
+    handler(event.param);
+}
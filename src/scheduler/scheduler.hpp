@@ -2,23 +2,43 @@
 
 #include "event_types.hpp"
 
-#include <queue>
+#include <array>
+#include <functional>
+#include <vector>
 
 namespace festation {
-    class Scheduler {
-        /** @brief Greater-comparison performed to achieve a min-heap */
-        using EventsQueue = std::priority_queue<Event, std::vector<Event>, std::greater<Event>>;
+    class StateSerializer;
 
+    class Scheduler {
     public:
-        auto scheduleEvent(Event&& event) -> void;
+        using EventHandler = std::function<void(uint64_t param)>;
+
+        /** @brief Handlers are set once by the components owning each event type and survive reset/state loads */
+        auto setEventHandler(EventType type, EventHandler handler) -> void;
+        auto scheduleEvent(EventType type, uint64_t delay, uint64_t param = 0) -> void;
+        /** @brief Drops every pending event of that type (e.g. a timer IRQ its setup changed) */
+        auto cancelEvents(EventType type) -> void;
+        /** @brief Advances the time, dispatching due events with the time set to the cycle each was due on */
         auto step(uint64_t cycles) -> void;
 
+        /** @brief Drops every pending event and rewinds the time, handlers are kept */
+        auto reset() -> void;
+
+        auto getGlobalTime() const -> uint64_t { return m_globalTime; }
+        /** @brief 0 when an event is already due, UINT64_MAX with nothing scheduled */
+        auto getCyclesUntilNextEvent() const -> uint64_t;
+
+        auto serialize(StateSerializer& serializer) -> void;
+
     private:
-        auto eventPending() const -> bool;
+        auto eventPending(uint64_t time) const -> bool;
         auto dispatchNearestEvent() -> void;
 
     private:
-        EventsQueue m_eventsQueue{};
+        /** @brief Min-heap (std::greater) kept in a plain vector so it can be serialized */
+        std::vector<Event> m_eventsHeap{};
+        std::array<EventHandler, EVENT_TYPES_COUNT> m_eventHandlers{};
         uint64_t m_globalTime{};
+        uint64_t m_nextSequence{};
     };
 };
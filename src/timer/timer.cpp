@@ -1,11 +1,26 @@
 #include "timer.hpp"
+#include "savestate/state_serializer.hpp"
 
+#include <algorithm>
 #include <utility>
 
-festation::Timer::Timer(InterruptsHandler& interruptsHandler, Scheduler& scheduler)
-    : m_interruptsHandler(interruptsHandler), m_scheduler(scheduler)
+namespace festation {
+    static constexpr uint32_t COUNTER_MODE_WRITABLE_BITS = 0x3FF;     // Bits 10-12 (IRQ, reached flags) are read-only
+    static constexpr uint64_t COUNTER_VALUES = 0x10000;
+    static constexpr uint16_t COUNTER_MAX = 0xFFFF;
+
+    /** @brief Video clock is 11/7 of the CPU clock, NTSC scanlines are 3413 video cycles long */
+    static constexpr uint64_t VIDEO_CLOCK_TICKS = 11;
+    static constexpr uint64_t VIDEO_CLOCK_CYCLES = 7;
+    static constexpr uint64_t VIDEO_CYCLES_PER_SCANLINE_NTSC = 3413;
+    static constexpr uint32_t DEFAULT_DOT_CLOCK_DIVIDER = 10;     // 256 pixels wide
+    static constexpr uint64_t SYSTEM_CLOCK_DIV8 = 8;
+};
+
+festation::Timer::Timer(uint32_t id, InterruptsHandler& interruptsHandler, Scheduler& scheduler)
+    : m_interruptsHandler(interruptsHandler), m_scheduler(scheduler), m_id(id), m_dotClockDivider(DEFAULT_DOT_CLOCK_DIVIDER)
 {
-    
+    m_scheduler.setEventHandler(getIrqEventType(), [this](uint64_t) { onIrqEvent(); });
 }
 
 auto festation::Timer::read8(uint32_t address) -> uint8_t
@@ -13,14 +28,10 @@ auto festation::Timer::read8(uint32_t address) -> uint8_t
     switch (address & 0xF)
     {
     case 0:
+        sync();
         return m_currentCounterReg.raw & 0xFF;
     case 4:
-    {
-        uint32_t result = m_counterModeReg.raw & 0xFF;
-        m_counterModeReg.reachedTarget = 0;
-        m_counterModeReg.reachedMax = 0;
-        return result;
-    }
+        return readCounterMode() & 0xFF;
     case 8:
         return m_targetCounterReg.raw & 0xFF;
     default:
@@ -33,14 +44,10 @@ auto festation::Timer::read16(uint32_t address) -> uint16_t
     switch (address & 0xF)
     {
     case 0:
-        return 0xFFFF;
+        sync();
+        return m_currentCounterReg.current;
     case 4:
-    {
-        uint32_t result = m_counterModeReg.raw & 0xFFFF;
-        m_counterModeReg.reachedTarget = 0;
-        m_counterModeReg.reachedMax = 0;
-        return result;
-    }
+        return readCounterMode() & 0xFFFF;
     case 8:
         return m_targetCounterReg.raw & 0xFFFF;
     default:
@@ -53,14 +60,10 @@ auto festation::Timer::read32(uint32_t address) -> uint32_t
     switch (address & 0xF)
     {
     case 0:
-        return 0xFFFFFFFF;
+        sync();
+        return m_currentCounterReg.current;
     case 4:
-    {
-        uint32_t result = m_counterModeReg.raw;
-        m_counterModeReg.reachedTarget = 0;
-        m_counterModeReg.reachedMax = 0;
-        return result;
-    }
+        return readCounterMode();
     case 8:
         return m_targetCounterReg.raw;
     default:
@@ -73,14 +76,17 @@ auto festation::Timer::write8(uint32_t address, uint8_t value) -> void
     switch (address & 0xF)
     {
     case 0:
+        sync();
         m_currentCounterReg.current = value;
+        scheduleIrqEvent();
         break;
     case 4:
-        m_counterModeReg.raw = (m_counterModeReg.raw & 0xFFFFFF00) | value;
-        processCounterModeChange();
+        writeCounterMode((m_counterModeReg.raw & 0xFFFFFF00) | value);
         break;
     case 8:
+        sync();
         m_targetCounterReg.target = value;
+        scheduleIrqEvent();
         break;
     default:
         std::unreachable();
@@ -92,14 +98,17 @@ auto festation::Timer::write16(uint32_t address, uint16_t value) -> void
     switch (address & 0xF)
     {
     case 0:
+        sync();
         m_currentCounterReg.current = value;
+        scheduleIrqEvent();
         break;
     case 4:
-        m_counterModeReg.raw = (m_counterModeReg.raw & 0xFFFF0000) | value;
-        processCounterModeChange();
+        writeCounterMode((m_counterModeReg.raw & 0xFFFF0000) | value);
         break;
     case 8:
+        sync();
         m_targetCounterReg.target = value;
+        scheduleIrqEvent();
         break;
     default:
         std::unreachable();
@@ -111,23 +120,232 @@ auto festation::Timer::write32(uint32_t address, uint32_t value) -> void
     switch (address & 0xF)
     {
     case 0:
-        m_currentCounterReg.raw = value;
+        sync();
+        m_currentCounterReg.current = value & 0xFFFF;
+        scheduleIrqEvent();
         break;
     case 4:
-        m_counterModeReg.raw = value;
-        processCounterModeChange();
+        writeCounterMode(value);
         break;
     case 8:
+        sync();
         m_targetCounterReg.raw = value;
+        scheduleIrqEvent();
         break;
     default:
         std::unreachable();
     }
 }
 
-auto festation::Timer::processCounterModeChange() -> void
+auto festation::Timer::reset() -> void
+{
+    m_currentCounterReg.raw = 0;
+    m_counterModeReg.raw = 0;
+    m_targetCounterReg.raw = 0;
+    m_dotClockDivider = DEFAULT_DOT_CLOCK_DIVIDER;
+    m_syncTime = m_scheduler.getGlobalTime();
+    m_syncPhase = 0;
+    m_hasIrqFired = false;
+}
+
+auto festation::Timer::setDotClockDivider(uint32_t divider) -> void
 {
+    if (divider == m_dotClockDivider)
+        return;
+
+    sync();
+    m_dotClockDivider = divider;
+
+    if (m_id == 0 && (m_counterModeReg.clockSrc & 1)) {
+        m_syncPhase = 0;
+        scheduleIrqEvent();
+    }
+}
+
+auto festation::Timer::getClockRate() const -> ClockRate
+{
+    switch (m_id)
+    {
+    case 0:
+        if (m_counterModeReg.clockSrc & 1)
+            return { VIDEO_CLOCK_TICKS, VIDEO_CLOCK_CYCLES * m_dotClockDivider };
+        break;
+    case 1:
+        if (m_counterModeReg.clockSrc & 1)
+            return { VIDEO_CLOCK_TICKS, VIDEO_CLOCK_CYCLES * VIDEO_CYCLES_PER_SCANLINE_NTSC };
+        break;
+    case 2:
+        // Sync modes 0 and 3 stop the counter, 1 and 2 let it run
+        if (m_counterModeReg.syncEnabled && (m_counterModeReg.syncMode == 0 || m_counterModeReg.syncMode == 3))
+            return { 0, 1 };
+
+        if (m_counterModeReg.clockSrc & 2)
+            return { 1, SYSTEM_CLOCK_DIV8 };
+        break;
+    default:
+        std::unreachable();
+    }
+
+    return { 1, 1 };
+}
+
+auto festation::Timer::sync() -> void
+{
+    const uint64_t now = m_scheduler.getGlobalTime();
+    const ClockRate rate = getClockRate();
+    const uint64_t scaledElapsed = (now - m_syncTime) * rate.ticks + m_syncPhase;
+    const uint64_t ticks = scaledElapsed / rate.cycles;
+
+    m_syncTime = now;
+    m_syncPhase = scaledElapsed % rate.cycles;
+
+    if (ticks == 0)
+        return;
+
+    const uint64_t ticksToTarget = getTicksUntil(m_targetCounterReg.target);
+    const uint64_t ticksToMax = getTicksUntil(COUNTER_MAX);
+
+    if (ticksToTarget != 0 && ticksToTarget <= ticks)
+        m_counterModeReg.reachedTarget = 1;
+
+    if (ticksToMax != 0 && ticksToMax <= ticks)
+        m_counterModeReg.reachedMax = 1;
+
+    advanceCounter(ticks);
+}
+
+auto festation::Timer::advanceCounter(uint64_t ticks) -> void
+{
+    const uint64_t counter = m_currentCounterReg.current;
+    const uint64_t target = m_targetCounterReg.target;
+
+    // Reset at target: 0 to target over and over, unless it starts past it, then it wraps through FFFFh first
+    if (m_counterModeReg.whenResetCounter && counter <= target) {
+        m_currentCounterReg.current = (counter + ticks) % (target + 1);
+        return;
+    }
+
+    const uint64_t ticksToWrap = COUNTER_VALUES - counter;
+
+    if (ticks < ticksToWrap) {
+        m_currentCounterReg.current = counter + ticks;
+        return;
+    }
+
+    const uint64_t period = m_counterModeReg.whenResetCounter ? target + 1 : COUNTER_VALUES;
+    m_currentCounterReg.current = (ticks - ticksToWrap) % period;
+}
+
+auto festation::Timer::getTicksUntil(uint16_t value) const -> uint64_t
+{
+    const uint64_t counter = m_currentCounterReg.current;
+    const uint64_t target = m_targetCounterReg.target;
+
+    if (m_counterModeReg.whenResetCounter && counter <= target) {
+        if (value > target)
+            return 0;
+
+        const uint64_t period = target + 1;
+        const uint64_t ticks = (value + period - counter) % period;
+        return (ticks != 0) ? ticks : period;
+    }
+
+    if (value > counter)
+        return value - counter;
+
+    // Back to it after wrapping, past target that's only possible for values the reset cycle goes through
+    if (m_counterModeReg.whenResetCounter && value > target)
+        return 0;
+
+    return COUNTER_VALUES - counter + value;
+}
+
+auto festation::Timer::scheduleIrqEvent() -> void
+{
+    m_scheduler.cancelEvents(getIrqEventType());
+
+    if (!m_counterModeReg.irqOnceRepeatMode && m_hasIrqFired)
+        return;
+
+    const ClockRate rate = getClockRate();
+    uint64_t ticks = UINT64_MAX;
+
+    if (m_counterModeReg.targetReachedIrq) {
+        if (uint64_t ticksToTarget = getTicksUntil(m_targetCounterReg.target))
+            ticks = std::min(ticks, ticksToTarget);
+    }
+
+    if (m_counterModeReg.maxReachedIrq) {
+        if (uint64_t ticksToMax = getTicksUntil(COUNTER_MAX))
+            ticks = std::min(ticks, ticksToMax);
+    }
+
+    if (rate.ticks == 0 || ticks == UINT64_MAX)
+        return;
+
+    // First cycle at which that many ticks have elapsed, counting the part of a tick already there
+    const uint64_t cycles = (ticks * rate.cycles - m_syncPhase + rate.ticks - 1) / rate.ticks;
+    m_scheduler.scheduleEvent(getIrqEventType(), cycles);
+}
+
+auto festation::Timer::onIrqEvent() -> void
+{
+    sync();
+
+    const bool hasReachedTarget = m_counterModeReg.targetReachedIrq && m_currentCounterReg.current == m_targetCounterReg.target;
+    const bool hasReachedMax = m_counterModeReg.maxReachedIrq && m_currentCounterReg.current == COUNTER_MAX;
+
+    if (hasReachedTarget || hasReachedMax) {
+        m_hasIrqFired = true;
+
+        // Pulse mode keeps bit 10 low for a few cycles only, toggle mode flips it and requests on 1 to 0
+        if (m_counterModeReg.irqPulseToggleMode)
+            m_counterModeReg.irqRequest ^= 1;
+
+        if (!m_counterModeReg.irqPulseToggleMode || !m_counterModeReg.irqRequest)
+            m_interruptsHandler.setInterruptSource(static_cast<InterruptSource>(Tmr0Src << m_id));
+    }
+
+    scheduleIrqEvent();
+}
+
+auto festation::Timer::writeCounterMode(uint32_t value) -> void
+{
+    sync();
+
+    m_counterModeReg.raw = (m_counterModeReg.raw & ~COUNTER_MODE_WRITABLE_BITS) | (value & COUNTER_MODE_WRITABLE_BITS);
     m_counterModeReg.irqRequest = 1;
     m_currentCounterReg.current = 0;
-    
+    m_syncPhase = 0;
+    m_hasIrqFired = false;
+
+    scheduleIrqEvent();
+}
+
+auto festation::Timer::readCounterMode() -> uint32_t
+{
+    sync();
+
+    const uint32_t result = m_counterModeReg.raw;
+    m_counterModeReg.reachedTarget = 0;
+    m_counterModeReg.reachedMax = 0;
+
+    return result;
+}
+
+auto festation::Timer::serialize(StateSerializer& serializer) -> void
+{
+    uint32_t version = 2;
+
+    if (!serializer.beginSection(makeSectionTag("TIMR"), version))
+        return;
+
+    serializer.doValue(m_currentCounterReg.raw);
+    serializer.doValue(m_counterModeReg.raw);
+    serializer.doValue(m_targetCounterReg.raw);
+    serializer.doValue(m_dotClockDivider);
+    serializer.doValue(m_syncTime);
+    serializer.doValue(m_syncPhase);
+    serializer.doBool(m_hasIrqFired);
+    serializer.endSection();
 }
@@ -4,9 +4,16 @@
 #include "scheduler/scheduler.hpp"
 
 namespace festation {
+    class StateSerializer;
+
+    /**
+     * @brief Root counter 0-2. Nothing ticks: the counter is worked out from the scheduler time whenever it's
+     * read or its setup changes, and target/FFFFh IRQs are scheduler events at the cycle the counter gets there.
+     * Sync modes gating on hblank/vblank (timers 0 and 1) aren't emulated, those counters run freely.
+     */
     class Timer {
     public:
-        Timer(InterruptsHandler& interruptsHandler, Scheduler& scheduler);
+        Timer(uint32_t id, InterruptsHandler& interruptsHandler, Scheduler& scheduler);
 
         auto read8(uint32_t address) -> uint8_t;
         auto read16(uint32_t address) -> uint16_t;
@@ -15,13 +22,42 @@ namespace festation {
         auto write16(uint32_t address, uint16_t value) -> void;
         auto write32(uint32_t address, uint32_t value) -> void;
 
+        /** @brief Must follow a scheduler reset, the counter restarts from time 0 */
+        auto reset() -> void;
+        /** @brief Video clock cycles per dot (GPU horizontal resolution), rate of timer 0 dotclock source */
+        auto setDotClockDivider(uint32_t divider) -> void;
+
+        auto serialize(StateSerializer& serializer) -> void;
+
     private:
-        auto processCounterModeChange() -> void;
+        /** @brief Counter ticks per CPU cycles, as a fraction to stay exact */
+        struct ClockRate {
+            uint64_t ticks;
+            uint64_t cycles;
+        };
+
+        auto getClockRate() const -> ClockRate;
+        /** @brief Brings the counter and the reached flags up to the scheduler time */
+        auto sync() -> void;
+        auto advanceCounter(uint64_t ticks) -> void;
+        /** @brief Ticks (at least one) until the counter is value again, 0 if it never gets there */
+        auto getTicksUntil(uint16_t value) const -> uint64_t;
+        /** @brief Replaces the pending IRQ event, if any IRQ is enabled. Counter must be synced */
+        auto scheduleIrqEvent() -> void;
+        auto onIrqEvent() -> void;
+        auto writeCounterMode(uint32_t value) -> void;
+        auto readCounterMode() -> uint32_t;
+
+        auto getIrqEventType() const -> EventType { return static_cast<EventType>(static_cast<size_t>(EventType::Timer0Int) + m_id); }
 
     private:
         InterruptsHandler& m_interruptsHandler;
         Scheduler& m_scheduler;
-        float clockDivisor{};
+        uint32_t m_id;
+        uint32_t m_dotClockDivider;
+        uint64_t m_syncTime{};      // Scheduler time the counter was last brought up to
+        uint64_t m_syncPhase{};     // Part of a tick already elapsed at m_syncTime, in ClockRate::ticks units
+        bool m_hasIrqFired{};       // One-shot mode only fires once per mode write
 
         union {
             struct {
@@ -0,0 +1,135 @@
+#include "cpu/execution_trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <format>
+#include <print>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Offline companion of the CPU execution trace (--trace):
+ *   FestationTrace dump <trace> [--from N] [--count N]   Prints records as text
+ *   FestationTrace diff <traceA> <traceB> [--context N]  Stops at the first record that differs
+ */
+
+static constexpr uint64_t DEFAULT_DIFF_CONTEXT = 16;
+
+static auto parseNumber(std::string_view text) -> uint64_t
+{
+    return std::strtoull(std::string(text).c_str(), nullptr, 0);
+}
+
+static auto dumpTrace(const std::string& path, uint64_t from, uint64_t count) -> int
+{
+    festation::ExecutionTraceReader reader;
+
+    if (!reader.open(path)) {
+        std::println(stderr, "Can't open {} or it isn't an execution trace", path);
+        return 1;
+    }
+
+    festation::TraceRecord record;
+    uint64_t index = 0;
+
+    for (; index < from + count && reader.next(record); index++) {
+        if (index >= from)
+            std::println("{:>10}  {}", index, festation::formatTraceRecord(record));
+    }
+
+    if (reader.hasError()) {
+        std::println(stderr, "{} is truncated after record {}", path, index);
+        return 1;
+    }
+
+    return 0;
+}
+
+static auto diffTraces(const std::string& pathA, const std::string& pathB, uint64_t context) -> int
+{
+    festation::ExecutionTraceReader readerA;
+    festation::ExecutionTraceReader readerB;
+
+    if (!readerA.open(pathA) || !readerB.open(pathB)) {
+        std::println(stderr, "Can't open both traces");
+        return 1;
+    }
+
+    if (readerA.getRegisters() != readerB.getRegisters())
+        std::println("Warning: traces start from different register files");
+
+    std::deque<std::string> history;
+    festation::TraceRecord recordA;
+    festation::TraceRecord recordB;
+
+    for (uint64_t index = 0;; index++) {
+        const bool hasA = readerA.next(recordA);
+        const bool hasB = readerB.next(recordB);
+
+        if (!hasA || !hasB) {
+            if (hasA == hasB) {
+                std::println("Traces are identical ({} records)", index);
+                return 0;
+            }
+
+            std::println("{} ends at record {}, the other one goes on", hasA ? pathB : pathA, index);
+            return 1;
+        }
+
+        if (recordA == recordB) {
+            history.push_back(std::format("{:>10}  {}", index, festation::formatTraceRecord(recordA)));
+
+            if (history.size() > context)
+                history.pop_front();
+
+            continue;
+        }
+
+        std::println("Traces diverge at record {}", index);
+
+        for (const std::string& line : history) {
+            std::println("  {}", line);
+        }
+
+        std::println("A {:>10}  {}", index, festation::formatTraceRecord(recordA));
+        std::println("B {:>10}  {}", index, festation::formatTraceRecord(recordB));
+        return 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::println(stderr, "Usage: {} dump <trace> [--from N] [--count N]", argv[0]);
+        std::println(stderr, "       {} diff <traceA> <traceB> [--context N]", argv[0]);
+        return 2;
+    }
+
+    const std::string_view command = argv[1];
+    uint64_t from = 0;
+    uint64_t count = UINT64_MAX - 1;
+    uint64_t context = DEFAULT_DIFF_CONTEXT;
+
+    for (int i = 3; i + 1 < argc; i++) {
+        const std::string_view argument = argv[i];
+
+        if (argument == "--from")
+            from = parseNumber(argv[++i]);
+        else if (argument == "--count")
+            count = parseNumber(argv[++i]);
+        else if (argument == "--context")
+            context = parseNumber(argv[++i]);
+    }
+
+    count = std::min(count, UINT64_MAX - from);
+
+    if (command == "dump")
+        return dumpTrace(argv[2], from, count);
+
+    if (command == "diff" && argc >= 4)
+        return diffTraces(argv[2], argv[3], context);
+
+    std::println(stderr, "Unknown command {}", command);
+    return 2;
+}
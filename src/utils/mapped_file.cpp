@@ -0,0 +1,151 @@
+#include "mapped_file.hpp"
+
+#if defined(__linux__) || defined(__unix__) || defined(__FreeBSD__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#elif defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+
+festation::MappedFile::~MappedFile()
+{
+    close();
+}
+
+festation::MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+festation::MappedFile& festation::MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_isOpen = std::exchange(other.m_isOpen, false);
+#if defined(_WIN32)
+        m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+        m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#endif
+    }
+
+    return *this;
+}
+
+auto festation::MappedFile::open(const std::filesystem::path& path) -> bool
+{
+    close();
+
+#if defined(__linux__) || defined(__unix__) || defined(__FreeBSD__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat{};
+
+    if (fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_size = static_cast<size_t>(fileStat.st_size);
+
+    if (m_size > 0) {
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            m_size = 0;
+            return false;
+        }
+
+        /** @brief Disc and ROM images are mostly read front to back */
+        madvise(mapping, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const std::byte*>(mapping);
+    }
+
+    /** @brief The mapping keeps its own reference to the file */
+    ::close(fd);
+#elif defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize{};
+    GetFileSizeEx(file, &fileSize);
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    m_fileHandle = file;
+
+    if (m_size > 0) {
+        m_mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (!m_mappingHandle) {
+            close();
+            return false;
+        }
+
+        m_data = static_cast<const std::byte*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+        if (!m_data) {
+            close();
+            return false;
+        }
+    }
+#else
+    return false;
+#endif
+
+    m_isOpen = true;
+    return true;
+}
+
+auto festation::MappedFile::close() -> void
+{
+#if defined(__linux__) || defined(__unix__) || defined(__FreeBSD__) || defined(__APPLE__)
+    if (m_data) {
+        munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+#elif defined(_WIN32)
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mappingHandle) {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = nullptr;
+    }
+
+    if (m_fileHandle) {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = nullptr;
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+auto festation::MappedFile::willNeed(size_t offset, size_t length) const -> void
+{
+    if (!m_data || offset >= m_size)
+        return;
+
+#if defined(__linux__) || defined(__unix__) || defined(__FreeBSD__) || defined(__APPLE__)
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t alignedOffset = offset & ~(pageSize - 1);
+    const size_t end = std::min(offset + length, m_size);
+
+    madvise(const_cast<std::byte*>(m_data) + alignedOffset, end - alignedOffset, MADV_WILLNEED);
+#endif
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace festation {
+    /** @brief Read-only memory mapping of a whole file, pages are loaded lazily by the OS */
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        auto open(const std::filesystem::path& path) -> bool;
+        auto close() -> void;
+
+        auto isOpen() const -> bool { return m_isOpen; }
+        auto size() const -> size_t { return m_size; }
+        auto data() const -> std::span<const std::byte> { return { m_data, m_size }; }
+
+        /** @brief Hints the OS to read ahead the given range (no-op where unsupported) */
+        auto willNeed(size_t offset, size_t length) const -> void;
+
+    private:
+        const std::byte* m_data{};
+        size_t m_size{};
+        bool m_isOpen{};
+#if defined(_WIN32)
+        void* m_fileHandle{};
+        void* m_mappingHandle{};
+#endif
+    };
+};